@@ -48,6 +48,9 @@
 #define CMD_READ_SECTOR_RETRY 0x20	/* READ SECTOR with retries. */
 #define CMD_WRITE_SECTOR_RETRY 0x30 /* WRITE SECTOR with retries. */
 
+/* Most sectors one READ or WRITE SECTOR command can move. */
+#define MAX_CMD_SECTORS 256
+
 /* An ATA device. */
 struct disk {
 	char name[8];			 /* Name, e.g. "hd0:1". */
@@ -59,6 +62,7 @@ struct disk {
 
 	long long read_cnt;	 /* Number of sectors read. */
 	long long write_cnt; /* Number of sectors written. */
+	long long cmd_cnt;	 /* Number of read and write commands. */
 };
 
 /* An ATA channel (aka controller).
@@ -84,7 +88,9 @@ static void reset_channel(struct channel *);
 static bool check_device_type(struct disk *);
 static void identify_ata_device(struct disk *);
 
-static void select_sector(struct disk *, disk_sector_t);
+static void select_sector(struct disk *, disk_sector_t, size_t cnt);
+static void transfer(struct disk *, disk_sector_t, const struct disk_iovec *, size_t iov_cnt,
+					 bool write);
 static void issue_pio_command(struct channel *, uint8_t command);
 static void input_sector(struct channel *, void *);
 static void output_sector(struct channel *, const void *);
@@ -133,7 +139,7 @@ void disk_init(void)
 			d->is_ata = false;
 			d->capacity = 0;
 
-			d->read_cnt = d->write_cnt = 0;
+			d->read_cnt = d->write_cnt = d->cmd_cnt = 0;
 		}
 
 		/* Register interrupt handler. */
@@ -167,7 +173,8 @@ void disk_print_stats(void)
 		for (dev_no = 0; dev_no < 2; dev_no++) {
 			struct disk *d = disk_get(chan_no, dev_no);
 			if (d != NULL && d->is_ata)
-				printf("%s: %lld reads, %lld writes\n", d->name, d->read_cnt, d->write_cnt);
+				printf("%s: %lld reads, %lld writes, %lld commands\n", d->name, d->read_cnt,
+					   d->write_cnt, d->cmd_cnt);
 		}
 	}
 }
@@ -208,21 +215,9 @@ disk_sector_t disk_size(struct disk *d)
    per-disk locking is unneeded. */
 void disk_read(struct disk *d, disk_sector_t sec_no, void *buffer)
 {
-	struct channel *c;
-
-	ASSERT(d != NULL);
-	ASSERT(buffer != NULL);
+	struct disk_iovec iov = {buffer, 1};
 
-	c = d->channel;
-	lock_acquire(&c->lock);
-	select_sector(d, sec_no);
-	issue_pio_command(c, CMD_READ_SECTOR_RETRY);
-	sema_down(&c->completion_wait);
-	if (!wait_while_busy(d))
-		PANIC("%s: disk read failed, sector=%" PRDSNu, d->name, sec_no);
-	input_sector(c, buffer);
-	d->read_cnt++;
-	lock_release(&c->lock);
+	disk_readv(d, sec_no, &iov, 1);
 }
 
 /* Write sector SEC_NO to disk D from BUFFER, which must contain
@@ -231,21 +226,94 @@ void disk_read(struct disk *d, disk_sector_t sec_no, void *buffer)
    Internally synchronizes accesses to disks, so external
    per-disk locking is unneeded. */
 void disk_write(struct disk *d, disk_sector_t sec_no, const void *buffer)
+{
+	struct disk_iovec iov = {(void *)buffer, 1};
+
+	disk_writev(d, sec_no, &iov, 1);
+}
+
+/* Reads consecutive sectors from disk D, starting at SEC_NO, into
+   the IOV_CNT buffers in IOV, filling each before moving on to
+   the next.  Takes one command per MAX_CMD_SECTORS sectors rather
+   than one per sector.
+   Internally synchronizes accesses to disks, so external
+   per-disk locking is unneeded. */
+void disk_readv(struct disk *d, disk_sector_t sec_no, const struct disk_iovec *iov,
+				size_t iov_cnt)
+{
+	transfer(d, sec_no, iov, iov_cnt, false);
+}
+
+/* Writes consecutive sectors to disk D, starting at SEC_NO, from
+   the IOV_CNT buffers in IOV, as disk_readv() reads them.
+   Returns after the disk has acknowledged receiving the data.
+   Internally synchronizes accesses to disks, so external
+   per-disk locking is unneeded. */
+void disk_writev(struct disk *d, disk_sector_t sec_no, const struct disk_iovec *iov,
+				 size_t iov_cnt)
+{
+	transfer(d, sec_no, iov, iov_cnt, true);
+}
+
+/* Moves the sectors described by IOV and IOV_CNT between memory
+   and disk D, starting at SEC_NO, writing them to the disk if
+   WRITE is true and reading them otherwise. */
+static void transfer(struct disk *d, disk_sector_t sec_no, const struct disk_iovec *iov,
+					 size_t iov_cnt, bool write)
 {
 	struct channel *c;
+	size_t left = 0;
+	size_t i;
+	size_t ofs = 0; /* Sectors of IOV[I] already done. */
 
 	ASSERT(d != NULL);
-	ASSERT(buffer != NULL);
+	ASSERT(iov != NULL);
+
+	for (i = 0; i < iov_cnt; i++)
+		left += iov[i].sec_cnt;
 
 	c = d->channel;
 	lock_acquire(&c->lock);
-	select_sector(d, sec_no);
-	issue_pio_command(c, CMD_WRITE_SECTOR_RETRY);
-	if (!wait_while_busy(d))
-		PANIC("%s: disk write failed, sector=%" PRDSNu, d->name, sec_no);
-	output_sector(c, buffer);
-	sema_down(&c->completion_wait);
-	d->write_cnt++;
+	for (i = 0; left > 0;) {
+		size_t cnt = left < MAX_CMD_SECTORS ? left : MAX_CMD_SECTORS;
+		size_t k;
+
+		select_sector(d, sec_no, cnt);
+		issue_pio_command(c, write ? CMD_WRITE_SECTOR_RETRY : CMD_READ_SECTOR_RETRY);
+		for (k = 0; k < cnt; k++) {
+			uint8_t *buffer;
+
+			while (ofs == iov[i].sec_cnt) {
+				i++;
+				ofs = 0;
+			}
+			buffer = (uint8_t *)iov[i].buf + ofs++ * DISK_SECTOR_SIZE;
+
+			/* The disk interrupts once each sector is ready to be
+			   read, or once it has taken each sector written. */
+			if (write) {
+				if (!wait_while_busy(d))
+					PANIC("%s: disk write failed, sector=%" PRDSNu, d->name,
+						  (disk_sector_t)(sec_no + k));
+				output_sector(c, buffer);
+				sema_down(&c->completion_wait);
+			} else {
+				sema_down(&c->completion_wait);
+				if (!wait_while_busy(d))
+					PANIC("%s: disk read failed, sector=%" PRDSNu, d->name,
+						  (disk_sector_t)(sec_no + k));
+				input_sector(c, buffer);
+			}
+		}
+
+		if (write)
+			d->write_cnt += cnt;
+		else
+			d->read_cnt += cnt;
+		d->cmd_cnt++;
+		sec_no += cnt;
+		left -= cnt;
+	}
 	lock_release(&c->lock);
 }
 
@@ -398,17 +466,18 @@ static void print_ata_string(char *string, size_t size)
 }
 
 /* Selects device D, waiting for it to become ready, and then
-   writes SEC_NO to the disk's sector selection registers.  (We
-   use LBA mode.) */
-static void select_sector(struct disk *d, disk_sector_t sec_no)
+   writes SEC_NO and CNT to the disk's sector selection and
+   sector count registers.  (We use LBA mode.) */
+static void select_sector(struct disk *d, disk_sector_t sec_no, size_t cnt)
 {
 	struct channel *c = d->channel;
 
-	ASSERT(sec_no < d->capacity);
-	ASSERT(sec_no < (1UL << 28));
+	ASSERT(cnt > 0 && cnt <= MAX_CMD_SECTORS);
+	ASSERT(sec_no + cnt <= d->capacity);
+	ASSERT(sec_no + cnt <= (1UL << 28));
 
 	select_device_wait(d);
-	outb(reg_nsect(c), 1);
+	outb(reg_nsect(c), cnt % MAX_CMD_SECTORS); /* 0 means 256. */
 	outb(reg_lbal(c), sec_no);
 	outb(reg_lbam(c), sec_no >> 8);
 	outb(reg_lbah(c), (sec_no >> 16));
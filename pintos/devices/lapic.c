@@ -0,0 +1,138 @@
+#include "devices/lapic.h"
+
+#include <debug.h>
+
+#include "intrinsic.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/mmu.h"
+#include "threads/pte.h"
+#include "threads/vaddr.h"
+
+/* Local APIC.  Each CPU has one, at the same physical address,
+   through which it receives interrupts from other CPUs and sends
+   them.  See [IA32-v3a] chapter 10 "Advanced Programmable
+   Interrupt Controller (APIC)". */
+
+/* Registers, as byte offsets from the base. */
+#define LAPIC_ID 0x020		/* Local APIC ID. */
+#define LAPIC_TPR 0x080		/* Task priority. */
+#define LAPIC_EOI 0x0b0		/* End of interrupt. */
+#define LAPIC_SVR 0x0f0		/* Spurious interrupt vector. */
+#define LAPIC_ESR 0x280		/* Error status. */
+#define LAPIC_ICR_LO 0x300	/* Interrupt command, bits 0...31. */
+#define LAPIC_ICR_HI 0x310	/* Interrupt command, bits 32...63. */
+#define LAPIC_TIMER 0x320	/* Local vector table: timer. */
+#define LAPIC_LINT0 0x350	/* Local vector table: LINT0 pin. */
+#define LAPIC_LINT1 0x360	/* Local vector table: LINT1 pin. */
+#define LAPIC_ERROR 0x370	/* Local vector table: error. */
+
+#define SVR_ENABLE 0x100	/* APIC software enable. */
+#define LVT_MASKED 0x10000	/* Interrupt masked. */
+#define LVT_NMI 0x400		/* Delivered as NMI. */
+#define LVT_EXTINT 0x700	/* Delivered as if from the 8259A PIC. */
+#define ICR_INIT 0x500		/* INIT delivery mode. */
+#define ICR_STARTUP 0x600	/* Start-up delivery mode. */
+#define ICR_PENDING 0x1000	/* Delivery status: send pending. */
+#define ICR_ASSERT 0x4000	/* Level: assert. */
+#define ICR_LEVEL 0x8000	/* Trigger mode: level. */
+
+/* Kernel virtual address of the registers. */
+static volatile uint32_t *lapic;
+
+static uint32_t lapic_read(int reg)
+{
+	return lapic[reg / 4];
+}
+
+static void lapic_write(int reg, uint32_t value)
+{
+	lapic[reg / 4] = value;
+	(void)lapic_read(LAPIC_ID); /* Wait for the write to finish. */
+}
+
+/* Maps the local APIC registers, at physical address PADDR, into
+   the kernel's address space, uncached.  Called once, by the
+   BSP, before any other CPU is started. */
+void lapic_map(uint64_t paddr)
+{
+	uint64_t va = (uint64_t)ptov(paddr);
+	uint64_t *pte = pml4e_walk(base_pml4, va, 1);
+
+	ASSERT(pte != NULL);
+	*pte = paddr | PTE_P | PTE_W | PTE_PCD | PTE_PWT;
+	invlpg(va);
+	lapic = (volatile uint32_t *)va;
+}
+
+/* Enables this CPU's local APIC.  The 8259A PIC stays wired to
+   the BSP's LINT0 pin, so it keeps taking the timer and device
+   interrupts; the other CPUs only take interrupts from CPUs. */
+void lapic_init(bool bsp)
+{
+	ASSERT(lapic != NULL);
+
+	lapic_write(LAPIC_SVR, SVR_ENABLE | LAPIC_SPURIOUS);
+	lapic_write(LAPIC_TIMER, LVT_MASKED);
+	lapic_write(LAPIC_LINT0, bsp ? LVT_EXTINT : LVT_MASKED);
+	lapic_write(LAPIC_LINT1, bsp ? LVT_NMI : LVT_MASKED);
+	lapic_write(LAPIC_ERROR, LVT_MASKED);
+
+	/* Clear errors (the register must be written twice), any
+	   interrupt left in service, and the task priority. */
+	lapic_write(LAPIC_ESR, 0);
+	lapic_write(LAPIC_ESR, 0);
+	lapic_write(LAPIC_EOI, 0);
+	lapic_write(LAPIC_TPR, 0);
+}
+
+/* Returns this CPU's local APIC ID. */
+uint8_t lapic_id(void)
+{
+	return lapic_read(LAPIC_ID) >> 24;
+}
+
+/* Acknowledges the interrupt being handled. */
+void lapic_eoi(void)
+{
+	lapic_write(LAPIC_EOI, 0);
+}
+
+/* Sends the interrupt command ICR to the CPU with local APIC ID
+   APIC_ID and waits for it to be delivered. */
+static void lapic_send(uint8_t apic_id, uint32_t icr)
+{
+	/* An interrupt handler that sent one in between would
+	   overwrite the destination. */
+	enum intr_level old_level = intr_disable();
+
+	lapic_write(LAPIC_ICR_HI, (uint32_t)apic_id << 24);
+	lapic_write(LAPIC_ICR_LO, icr);
+	while (lapic_read(LAPIC_ICR_LO) & ICR_PENDING)
+		asm volatile("pause");
+	intr_set_level(old_level);
+}
+
+/* Sends interrupt VEC to the CPU with local APIC ID APIC_ID. */
+void lapic_send_ipi(uint8_t apic_id, uint8_t vec)
+{
+	lapic_send(apic_id, vec);
+}
+
+/* Sends an INIT to the CPU with local APIC ID APIC_ID, resetting
+   it to wait for a start-up IPI. */
+void lapic_send_init(uint8_t apic_id)
+{
+	lapic_send(apic_id, ICR_INIT | ICR_LEVEL | ICR_ASSERT);
+	lapic_send(apic_id, ICR_INIT | ICR_LEVEL);
+}
+
+/* Sends a start-up IPI to the CPU with local APIC ID APIC_ID,
+   which starts it in real mode at PADDR.  PADDR must be
+   page-aligned and below 1 MB. */
+void lapic_send_startup(uint8_t apic_id, uint64_t paddr)
+{
+	ASSERT(paddr % PGSIZE == 0 && paddr < 0x100000);
+
+	lapic_send(apic_id, ICR_STARTUP | (paddr >> 12));
+}
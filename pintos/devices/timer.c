@@ -5,6 +5,7 @@
 #include <round.h>
 #include <stdio.h>
 
+#include "intrinsic.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
 #include "threads/synch.h"
@@ -19,14 +20,47 @@
 #error TIMER_FREQ <= 1000 recommended
 #endif
 
+/* 8254 input frequency divided by TIMER_FREQ, rounded to
+   nearest: the number of PIT counts in one timer tick. */
+#define PIT_TICK_COUNT ((1193180 + TIMER_FREQ / 2) / TIMER_FREQ)
+
+/* Longest one-shot period the 16-bit PIT counter can express:
+   65535 counts, about 54.9 ms, or 5 ticks at 100 Hz.  A longer
+   idle period is covered by a chain of one-shots, since the idle
+   loop arms a new one after each expires, so an idle CPU still
+   takes about 20 timer interrupts per second instead of 100. */
+#define PIT_MAX_TICKS (0xffff / PIT_TICK_COUNT)
+
 /* Number of timer ticks since OS booted. */
 static int64_t ticks;
 
+/* If true, stop the periodic tick while the CPU is idle.
+   Controlled by kernel command-line option "-tickless". */
+bool timer_tickless;
+
+/* One-shot state.  While ONESHOT_TICKS is nonzero the PIT is in
+   mode 0 and its next interrupt stands for that many ticks.
+   ONESHOT_COUNT is the count it was loaded with and ONESHOT_BASE
+   the PIT counts that had already elapsed in the current tick
+   when it was armed. */
+static int oneshot_ticks;
+static unsigned oneshot_count;
+static unsigned oneshot_base;
+
+/* TSC cycles spent in the timer interrupt handler, and the number
+   of interrupts measured, since the last timer_reset_intr_cost(). */
+static uint64_t intr_cycles;
+static uint64_t intr_cnt;
+
 /* Number of loops per timer tick.
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
 static intr_handler_func timer_interrupt;
+static void pit_set_periodic(void);
+static void pit_set_oneshot(unsigned count, int tick_cnt, unsigned base);
+static unsigned pit_read_count(bool *expired);
+static void timer_advance(int64_t tick_cnt);
 static bool too_many_loops(unsigned loops);
 static void busy_wait(int64_t loops);
 static void real_time_sleep(int64_t num, int32_t denom);
@@ -36,14 +70,7 @@ static void real_time_sleep(int64_t num, int32_t denom);
    corresponding interrupt. */
 void timer_init(void)
 {
-	/* 8254 input frequency divided by TIMER_FREQ, rounded to
-	   nearest. */
-	uint16_t count = (1193180 + TIMER_FREQ / 2) / TIMER_FREQ;
-
-	outb(0x43, 0x34); /* CW: counter 0, LSB then MSB, mode 2, binary. */
-	outb(0x40, count & 0xff);
-	outb(0x40, count >> 8);
-
+	pit_set_periodic();
 	intr_register_ext(0x20, timer_interrupt, "8254 Timer");
 }
 
@@ -92,7 +119,7 @@ int64_t timer_elapsed(int64_t then)
 /* Suspends execution for approximately TICKS timer ticks. */
 void timer_sleep(int64_t sleep_tick)
 {
-	if (ticks <= 0)
+	if (sleep_tick <= 0)
 		return;
 	thread_sleep(timer_ticks() + sleep_tick);
 }
@@ -115,6 +142,83 @@ void timer_nsleep(int64_t ns)
 	real_time_sleep(ns, 1000 * 1000 * 1000);
 }
 
+/* Called by the idle thread, with interrupts off, right before it
+   halts.  If the next TICK_CNT ticks need no processing, switches
+   the PIT to one-shot mode so that it interrupts only once, at
+   the end of that period, instead of every tick.  The period is
+   cut to PIT_MAX_TICKS; the idle loop calls us again once it
+   ends.  Returns the number of ticks the CPU may now sleep. */
+int timer_idle_enter(int tick_cnt)
+{
+	bool expired;
+	unsigned elapsed;
+
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	if (tick_cnt > PIT_MAX_TICKS)
+		tick_cnt = PIT_MAX_TICKS;
+	if (!timer_tickless || oneshot_ticks != 0 || tick_cnt <= 1)
+		return 1;
+
+	/* Let a periodic tick that is already pending be handled
+	   first. */
+	outb(0x20, 0x0a); /* OCW3: read the master PIC's IRR. */
+	if (inb(0x20) & 0x01)
+		return 1;
+
+	/* Keep the part of the current tick that already elapsed, so
+	   that the one-shot fires exactly on a tick boundary. */
+	elapsed = PIT_TICK_COUNT - pit_read_count(&expired);
+	if (elapsed >= PIT_TICK_COUNT)
+		return 1;
+	pit_set_oneshot(tick_cnt * PIT_TICK_COUNT - elapsed, tick_cnt, elapsed);
+	return tick_cnt;
+}
+
+/* Called at the start of every external interrupt other than the
+   timer's.  If the interrupt cut a tickless idle period short,
+   catches timer_ticks() up with the ticks that really elapsed and
+   re-arms the PIT for the rest of the current tick, so that the
+   tick count never drifts from real time. */
+void timer_idle_exit(void)
+{
+	bool expired;
+	unsigned remaining, total;
+
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	if (oneshot_ticks == 0)
+		return;
+
+	/* If the one-shot already fired, its interrupt is pending and
+	   timer_interrupt() will account for the whole period. */
+	remaining = pit_read_count(&expired);
+	if (expired || remaining > oneshot_count)
+		return;
+
+	total = oneshot_base + (oneshot_count - remaining);
+	pit_set_oneshot(PIT_TICK_COUNT - total % PIT_TICK_COUNT, 1, total % PIT_TICK_COUNT);
+	timer_advance(total / PIT_TICK_COUNT);
+}
+
+/* Restarts the measurement reported by timer_intr_cost(). */
+void timer_reset_intr_cost(void)
+{
+	enum intr_level old_level = intr_disable();
+	intr_cycles = intr_cnt = 0;
+	intr_set_level(old_level);
+}
+
+/* Returns the average number of TSC cycles spent in the timer
+   interrupt handler since the last timer_reset_intr_cost(). */
+uint64_t timer_intr_cost(void)
+{
+	enum intr_level old_level = intr_disable();
+	uint64_t cost = intr_cnt ? intr_cycles / intr_cnt : 0;
+	intr_set_level(old_level);
+	return cost;
+}
+
 /* Prints timer statistics. */
 void timer_print_stats(void)
 {
@@ -124,9 +228,70 @@ void timer_print_stats(void)
 /* Timer interrupt handler. */
 static void timer_interrupt(struct intr_frame *args UNUSED)
 {
-	ticks++;
-	wake_sleeping_threads(timer_ticks());
-	thread_tick();
+	uint64_t start = rdtsc();
+	int tick_cnt = 1;
+
+	if (oneshot_ticks != 0) {
+		tick_cnt = oneshot_ticks;
+		pit_set_periodic();
+	}
+	timer_advance(tick_cnt);
+
+	intr_cycles += rdtsc() - start;
+	intr_cnt++;
+}
+
+/* Advances the tick count by TICK_CNT, running the per-tick work
+   for each tick in turn.  Must run in an external interrupt. */
+static void timer_advance(int64_t tick_cnt)
+{
+	ASSERT(intr_context());
+
+	while (tick_cnt-- > 0) {
+		ticks++;
+		wake_sleeping_threads(ticks);
+		thread_tick();
+	}
+}
+
+/* Programs PIT counter 0 to interrupt every PIT_TICK_COUNT counts,
+   that is, TIMER_FREQ times per second. */
+static void pit_set_periodic(void)
+{
+	outb(0x43, 0x34); /* CW: counter 0, LSB then MSB, mode 2, binary. */
+	outb(0x40, PIT_TICK_COUNT & 0xff);
+	outb(0x40, PIT_TICK_COUNT >> 8);
+	oneshot_ticks = 0;
+}
+
+/* Programs PIT counter 0 to interrupt once after COUNT counts.
+   That interrupt will account for TICK_CNT ticks; BASE counts of
+   the first of them had elapsed before arming. */
+static void pit_set_oneshot(unsigned count, int tick_cnt, unsigned base)
+{
+	ASSERT(count > 0 && count <= 0xffff);
+
+	outb(0x43, 0x30); /* CW: counter 0, LSB then MSB, mode 0, binary. */
+	outb(0x40, count & 0xff);
+	outb(0x40, count >> 8);
+	oneshot_ticks = tick_cnt;
+	oneshot_count = count;
+	oneshot_base = base;
+}
+
+/* Returns the current value of PIT counter 0.  Sets *EXPIRED to
+   the state of its OUT pin, which in mode 0 goes high once the
+   count has run out. */
+static unsigned pit_read_count(bool *expired)
+{
+	unsigned lo, hi, status;
+
+	outb(0x43, 0xc2); /* Read-back: latch count and status of counter 0. */
+	status = inb(0x40);
+	lo = inb(0x40);
+	hi = inb(0x40);
+	*expired = (status & 0x80) != 0;
+	return lo | (hi << 8);
 }
 
 /* Returns true if LOOPS iterations waits for more than one timer
@@ -2,6 +2,7 @@
 #include <debug.h>
 #include "filesys/inode.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
 
 /* An open file. */
 struct file {
@@ -11,12 +12,21 @@ struct file {
 	int ref_cnt;
 };
 
+/* Cache of open files. */
+static struct kmem_cache *file_slab;
+
+/* Initializes the open file module. */
+void file_init(void)
+{
+	file_slab = kmem_cache_create("file", sizeof(struct file), NULL);
+}
+
 /* Opens a file for the given INODE, of which it takes ownership,
  * and returns the new file.  Returns a null pointer if an
  * allocation fails or if INODE is null. */
 struct file *file_open(struct inode *inode)
 {
-	struct file *file = calloc(1, sizeof *file);
+	struct file *file = kmem_cache_zalloc(file_slab);
 	if (inode != NULL && file != NULL) {
 		file->inode = inode;
 		file->pos = 0;
@@ -25,7 +35,7 @@ struct file *file_open(struct inode *inode)
 		return file;
 	} else {
 		inode_close(inode);
-		free(file);
+		kmem_cache_free(file_slab, file);
 		return NULL;
 	}
 }
@@ -56,7 +66,7 @@ void file_close(struct file *file)
 	if (file != NULL && --file->ref_cnt == 0) {
 		file_allow_write(file);
 		inode_close(file->inode);
-		free(file);
+		kmem_cache_free(file_slab, file);
 	}
 }
 
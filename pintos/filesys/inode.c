@@ -6,6 +6,8 @@
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
+#include "threads/synch.h"
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
@@ -33,6 +35,7 @@ struct inode {
 	int open_cnt;			/* Number of openers. */
 	bool removed;			/* True if deleted, false otherwise. */
 	int deny_write_cnt;		/* 0: writes ok, >0: deny writes. */
+	uint64_t write_gen;		/* Bumped by every write. */
 	struct inode_disk data; /* Inode content. */
 };
 
@@ -53,10 +56,19 @@ static disk_sector_t byte_to_sector(const struct inode *inode, off_t pos)
  * returns the same `struct inode'. */
 static struct list open_inodes;
 
+/* Protects open_inodes and the open_cnt of every open inode, so
+ * that directory lookups running in parallel may open inodes. */
+static struct lock open_inodes_lock;
+
+/* Cache of in-memory inodes. */
+static struct kmem_cache *inode_slab;
+
 /* Initializes the inode module. */
 void inode_init(void)
 {
 	list_init(&open_inodes);
+	lock_init(&open_inodes_lock);
+	inode_slab = kmem_cache_create("inode", sizeof(struct inode), NULL);
 }
 
 /* Initializes an inode with LENGTH bytes of data and
@@ -96,43 +108,74 @@ bool inode_create(disk_sector_t sector, off_t length)
 	return success;
 }
 
-/* Reads an inode from SECTOR
- * and returns a `struct inode' that contains it.
- * Returns a null pointer if memory allocation fails. */
-struct inode *inode_open(disk_sector_t sector)
+/* Returns the open inode for SECTOR with its open count bumped,
+ * or a null pointer if it is not open.  open_inodes_lock must be
+ * held. */
+static struct inode *inode_find_open(disk_sector_t sector)
 {
 	struct list_elem *e;
-	struct inode *inode;
 
-	/* Check whether this inode is already open. */
 	for (e = list_begin(&open_inodes); e != list_end(&open_inodes); e = list_next(e)) {
-		inode = list_entry(e, struct inode, elem);
+		struct inode *inode = list_entry(e, struct inode, elem);
 		if (inode->sector == sector) {
-			inode_reopen(inode);
+			inode->open_cnt++;
 			return inode;
 		}
 	}
+	return NULL;
+}
+
+/* Reads an inode from SECTOR
+ * and returns a `struct inode' that contains it.
+ * Returns a null pointer if memory allocation fails. */
+struct inode *inode_open(disk_sector_t sector)
+{
+	struct inode *inode, *new_inode;
+
+	/* Check whether this inode is already open. */
+	lock_acquire(&open_inodes_lock);
+	inode = inode_find_open(sector);
+	lock_release(&open_inodes_lock);
+	if (inode != NULL)
+		return inode;
 
 	/* Allocate memory. */
-	inode = malloc(sizeof *inode);
-	if (inode == NULL)
+	new_inode = kmem_cache_alloc(inode_slab);
+	if (new_inode == NULL)
 		return NULL;
 
-	/* Initialize. */
-	list_push_front(&open_inodes, &inode->elem);
-	inode->sector = sector;
-	inode->open_cnt = 1;
-	inode->deny_write_cnt = 0;
-	inode->removed = false;
-	disk_read(filesys_disk, inode->sector, &inode->data);
-	return inode;
+	/* Initialize.  The disk read happens without the lock, so
+	 * that opening an inode that is already open never waits for
+	 * the disk. */
+	new_inode->sector = sector;
+	new_inode->open_cnt = 1;
+	new_inode->deny_write_cnt = 0;
+	new_inode->removed = false;
+	new_inode->write_gen = 0;
+	disk_read(filesys_disk, new_inode->sector, &new_inode->data);
+
+	/* Another thread may have opened the same inode meanwhile. */
+	lock_acquire(&open_inodes_lock);
+	inode = inode_find_open(sector);
+	if (inode == NULL)
+		list_push_front(&open_inodes, &new_inode->elem);
+	lock_release(&open_inodes_lock);
+
+	if (inode != NULL) {
+		kmem_cache_free(inode_slab, new_inode);
+		return inode;
+	}
+	return new_inode;
 }
 
 /* Reopens and returns INODE. */
 struct inode *inode_reopen(struct inode *inode)
 {
-	if (inode != NULL)
+	if (inode != NULL) {
+		lock_acquire(&open_inodes_lock);
 		inode->open_cnt++;
+		lock_release(&open_inodes_lock);
+	}
 	return inode;
 }
 
@@ -152,9 +195,13 @@ void inode_close(struct inode *inode)
 		return;
 
 	/* Release resources if this was the last opener. */
-	if (--inode->open_cnt == 0) {
-		/* Remove from inode list and release lock. */
+	lock_acquire(&open_inodes_lock);
+	bool last = --inode->open_cnt == 0;
+	if (last)
 		list_remove(&inode->elem);
+	lock_release(&open_inodes_lock);
+
+	if (last) {
 
 		/* Deallocate blocks if removed. */
 		if (inode->removed) {
@@ -162,7 +209,7 @@ void inode_close(struct inode *inode)
 			free_map_release(inode->data.start, bytes_to_sectors(inode->data.length));
 		}
 
-		free(inode);
+		kmem_cache_free(inode_slab, inode);
 	}
 }
 
@@ -236,6 +283,7 @@ off_t inode_write_at(struct inode *inode, const void *buffer_, off_t size, off_t
 
 	if (inode->deny_write_cnt)
 		return 0;
+	inode->write_gen++;
 
 	while (size > 0) {
 		/* Sector to write, starting byte offset within sector. */
@@ -302,6 +350,14 @@ void inode_allow_write(struct inode *inode)
 	inode->deny_write_cnt--;
 }
 
+/* Returns INODE's write generation, which changes whenever INODE
+ * is written, so that a copy of its data taken at one generation
+ * is known to be stale at another. */
+uint64_t inode_write_gen(const struct inode *inode)
+{
+	return inode->write_gen;
+}
+
 /* Returns the length, in bytes, of INODE's data. */
 off_t inode_length(const struct inode *inode)
 {
@@ -0,0 +1,18 @@
+#ifndef DEVICES_LAPIC_H
+#define DEVICES_LAPIC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Vector of the local APIC's spurious interrupt. */
+#define LAPIC_SPURIOUS 0xff
+
+void lapic_map(uint64_t paddr);
+void lapic_init(bool bsp);
+uint8_t lapic_id(void);
+void lapic_eoi(void);
+void lapic_send_ipi(uint8_t apic_id, uint8_t vec);
+void lapic_send_init(uint8_t apic_id);
+void lapic_send_startup(uint8_t apic_id, uint64_t paddr);
+
+#endif /* devices/lapic.h */
@@ -2,11 +2,16 @@
 #define DEVICES_TIMER_H
 
 #include <round.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 /* Number of timer interrupts per second. */
 #define TIMER_FREQ 100
 
+/* If true, stop the periodic tick while the CPU is idle.
+   Controlled by kernel command-line option "-tickless". */
+extern bool timer_tickless;
+
 void timer_init(void);
 void timer_calibrate(void);
 
@@ -18,6 +23,12 @@ void timer_msleep(int64_t milliseconds);
 void timer_usleep(int64_t microseconds);
 void timer_nsleep(int64_t nanoseconds);
 
+int timer_idle_enter(int ticks);
+void timer_idle_exit(void);
+
+void timer_reset_intr_cost(void);
+uint64_t timer_intr_cost(void);
+
 void timer_print_stats(void);
 
 #endif /* devices/timer.h */
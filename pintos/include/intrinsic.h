@@ -1,4 +1,5 @@
 #ifndef INSTRINSIC_H
+#define INSTRINSIC_H
 #include "threads/mmu.h"
 
 /* Store the physical address of the page directory into CR3
@@ -43,6 +44,21 @@ __attribute__((always_inline)) static __inline uint64_t read_eflags(void)
 	return rflags;
 }
 
+/* CR0 bit that makes ring 0 honor read-only pages. */
+#define CR0_WP 0x00010000
+
+__attribute__((always_inline)) static __inline void lcr0(uint64_t val)
+{
+	__asm __volatile("movq %0, %%cr0" : : "r"(val));
+}
+
+__attribute__((always_inline)) static __inline uint64_t rcr0(void)
+{
+	uint64_t val;
+	__asm __volatile("movq %%cr0,%0" : "=r"(val));
+	return val;
+}
+
 __attribute__((always_inline)) static __inline uint64_t rcr3(void)
 {
 	uint64_t val;
@@ -119,6 +135,39 @@ __attribute__((always_inline)) static __inline uint64_t rcr2(void)
 	return val;
 }
 
+/* Reads the CPU's time-stamp counter.  See [IA32-v2b] "RDTSC". */
+__attribute__((always_inline)) static __inline uint64_t rdtsc(void)
+{
+	uint32_t lo, hi;
+	__asm __volatile("rdtsc" : "=a"(lo), "=d"(hi));
+	return ((uint64_t)hi << 32) | lo;
+}
+
+/* Atomically stores NEW into *ADDR if it still holds OLD.
+   Returns the value *ADDR held before the operation, so the
+   exchange happened iff the return value equals OLD. */
+__attribute__((always_inline)) static __inline uint64_t cmpxchg(volatile uint64_t *addr, uint64_t old,
+																uint64_t new)
+{
+	uint64_t prev;
+	__asm __volatile("lock cmpxchgq %2, %1"
+					 : "=a"(prev), "+m"(*addr)
+					 : "r"(new), "0"(old)
+					 : "memory");
+	return prev;
+}
+
+/* Executes CPUID for LEAF and SUBLEAF, storing the results in
+   the four registers. */
+__attribute__((always_inline)) static __inline void cpuid(uint32_t leaf, uint32_t subleaf,
+														  uint32_t *eax, uint32_t *ebx,
+														  uint32_t *ecx, uint32_t *edx)
+{
+	__asm __volatile("cpuid"
+					 : "=a"(*eax), "=b"(*ebx), "=c"(*ecx), "=d"(*edx)
+					 : "a"(leaf), "c"(subleaf));
+}
+
 __attribute__((always_inline)) static __inline void write_msr(uint32_t ecx, uint64_t val)
 {
 	uint32_t edx, eax;
@@ -0,0 +1,32 @@
+#ifndef __LIB_KERNEL_LZ_H
+#define __LIB_KERNEL_LZ_H
+
+/* LZ77-family block compressor.
+
+   Blocks use the LZ4 block layout: a run of sequences, each a
+   token byte holding a literal count and a match length, the
+   literals, and a two-byte little-endian match offset.  The last
+   sequence has literals only.  Compression is a single greedy
+   pass with a hash table of recent positions, so it trades ratio
+   for speed; decompression is a plain copy loop.
+
+   Blocks are at most LZ_MAX_INPUT bytes, so that offsets fit in
+   two bytes. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Largest block lz_compress() takes. */
+#define LZ_MAX_INPUT 65535
+
+/* log2 of the number of hash table entries. */
+#define LZ_HASH_BITS 12
+
+/* Bytes of scratch memory lz_compress() needs. */
+#define LZ_WORK_SIZE (sizeof(uint16_t) << LZ_HASH_BITS)
+
+size_t lz_compress(const void *src, size_t src_len, void *dst, size_t dst_cap, void *work);
+bool lz_decompress(const void *src, size_t src_len, void *dst, size_t dst_len);
+
+#endif /* lib/kernel/lz.h */
@@ -1,6 +1,7 @@
 #ifndef __LIB_STRING_H
 #define __LIB_STRING_H
 
+#include <stdbool.h>
 #include <stddef.h>
 
 /* Standard. */
@@ -25,6 +26,9 @@ size_t strlcat(char *, const char *, size_t);
 char *strtok_r(char *, const char *, char **);
 size_t strnlen(const char *, size_t);
 
+/* Set if the CPU has fast REP MOVSB/STOSB.  See string.c. */
+extern bool string_erms;
+
 /* Try to be helpful. */
 #define strcpy dont_use_strcpy_use_strlcpy
 #define strncpy dont_use_strncpy_use_strlcpy
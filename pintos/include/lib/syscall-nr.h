@@ -36,6 +36,9 @@ enum {
 
 	SYS_MOUNT,
 	SYS_UMOUNT,
+
+	/* Memory groups. */
+	SYS_MEMGROUP, /* Move into a new memory group. */
 };
 
 #endif /* lib/syscall-nr.h */
@@ -41,6 +41,7 @@ int dup2(int oldfd, int newfd);
 /* Project 3 and optionally project 4. */
 void *mmap(void *addr, size_t length, int writable, int fd, off_t offset);
 void munmap(void *addr);
+bool memgroup(size_t frame_limit, size_t swap_limit);
 
 /* Project 4 only. */
 bool chdir(const char *dir);
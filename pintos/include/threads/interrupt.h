@@ -66,7 +66,9 @@ struct intr_frame {
 typedef void intr_handler_func(struct intr_frame *);
 
 void intr_init(void);
+void intr_init_ap(void);
 void intr_register_ext(uint8_t vec, intr_handler_func *, const char *name);
+void intr_register_ipi(uint8_t vec, intr_handler_func *, const char *name);
 void intr_register_int(uint8_t vec, int dpl, enum intr_level, intr_handler_func *,
 					   const char *name);
 bool intr_context(void);
@@ -75,4 +77,5 @@ void intr_yield_on_return(void);
 void intr_dump_frame(const struct intr_frame *);
 const char *intr_name(uint8_t vec);
 
+void register_ud_hack(intr_handler_func *);
 #endif /* threads/interrupt.h */
@@ -20,6 +20,10 @@
 #define E820_MAP MULTIBOOT_INFO + 52
 #define E820_MAP4 MULTIBOOT_INFO + 56
 
+/* Physical address the application processors start at, in real
+   mode.  Must be page-aligned and below 1 MB (see threads/smp.c). */
+#define AP_TRAMPOLINE 0x8000
+
 /* Important loader physical addresses. */
 #define LOADER_SIG (LOADER_END - LOADER_SIG_LEN)		  /* 0xaa55 BIOS signature. */
 #define LOADER_ARGS (LOADER_SIG - LOADER_ARGS_LEN)		  /* Command-line args. */
@@ -15,9 +15,12 @@ enum palloc_flags {
 extern size_t user_page_limit;
 
 uint64_t palloc_init(void);
+void palloc_init_high(void);
 void *palloc_get_page(enum palloc_flags);
 void *palloc_get_multiple(enum palloc_flags, size_t page_cnt);
 void palloc_free_page(void *);
 void palloc_free_multiple(void *, size_t page_cnt);
+void palloc_print_stats(void);
+void palloc_prezero_start(void);
 
 #endif /* threads/palloc.h */
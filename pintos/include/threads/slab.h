@@ -0,0 +1,20 @@
+#ifndef THREADS_SLAB_H
+#define THREADS_SLAB_H
+
+#include <stddef.h>
+
+/* Object cache: allocates objects of one fixed size.  See
+   slab.c. */
+struct kmem_cache;
+
+/* Sets up a newly allocated object. */
+typedef void kmem_ctor(void *obj);
+
+void kmem_init(void);
+struct kmem_cache *kmem_cache_create(const char *name, size_t size, kmem_ctor *);
+void *kmem_cache_alloc(struct kmem_cache *);
+void *kmem_cache_zalloc(struct kmem_cache *);
+void kmem_cache_free(struct kmem_cache *, void *);
+void kmem_print_stats(void);
+
+#endif /* threads/slab.h */
@@ -0,0 +1,51 @@
+#ifndef THREADS_SMP_H
+#define THREADS_SMP_H
+
+#include <debug.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Maximum number of CPUs brought up. */
+#define CPU_MAX 8
+
+/* Inter-processor interrupt vectors.  See threads/smp.c. */
+#define IPI_RESCHEDULE 0x50 /* Run the scheduler on return. */
+#define IPI_TICK 0x51		/* Timer tick, forwarded by the BSP. */
+#define IPI_TLB_FLUSH 0x52	/* Flush the TLB (see smp_flush_tlb()). */
+
+/* A processor. */
+struct cpu {
+	/* Used by userprog/syscall-entry.S through %gs, so these must
+	   stay first and in this order. */
+	uint64_t scratch[2];	 /* Saved user registers. */
+	struct task_state *tss;	 /* This CPU's task-state segment. */
+
+	int id;					 /* Index in cpus[]; 0 is the BSP. */
+	uint8_t lapic_id;		 /* Local APIC ID. */
+	volatile bool started;	 /* Set by the CPU once it is up. */
+	struct thread *idle;	 /* This CPU's idle thread. */
+	struct thread *curr;	 /* Thread this CPU is running. */
+	volatile bool flush_pending; /* TLB flush requested, not yet done. */
+	uint64_t kernel_tlb_gen; /* Kernel TLB generation last flushed. */
+};
+
+/* Started CPUs, of which there are cpu_cnt.  cpus[0] is the
+   bootstrap processor (BSP) that runs main(). */
+extern struct cpu cpus[CPU_MAX];
+extern int cpu_cnt;
+
+struct cpu *this_cpu(void);
+
+void smp_init(void);
+void ap_main(void) NO_RETURN;
+
+void smp_send_ipi(struct cpu *, uint8_t vec);
+void smp_flush_tlb(uint64_t *pml4);
+void smp_flush_kernel_tlb(void);
+void smp_flush_tlb_ipi(void);
+
+void kernel_lock_acquire(void);
+void kernel_lock_release(void);
+bool kernel_lock_held(void);
+
+#endif /* threads/smp.h */
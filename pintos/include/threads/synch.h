@@ -3,11 +3,25 @@
 
 #include <list.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include "threads/waitq.h"
 
-/* A counting semaphore. */
+/* A counting semaphore.
+
+   VALUE and WAITING share one 64-bit word so that both can be
+   updated with a single compare-and-swap.  WAITING counts the
+   threads that have committed to the slow path of sema_down() and
+   may be on WAITERS; while it is zero, sema_up() only has to bump
+   VALUE.  Otherwise it wakes the highest-priority waiter. */
 struct semaphore {
-	unsigned value;		 /* Current value. */
-	struct list waiters; /* List of waiting threads. */
+	union {
+		struct {
+			unsigned value;	  /* Current value. */
+			unsigned waiting; /* # of threads in the slow path. */
+		};
+		uint64_t state; /* Both of the above, for cmpxchg. */
+	};
+	struct waitq waiters; /* Waiting threads. */
 };
 
 void sema_init(struct semaphore *, unsigned value);
@@ -16,10 +30,17 @@ bool sema_try_down(struct semaphore *);
 void sema_up(struct semaphore *);
 void sema_self_test(void);
 
-/* Lock. */
+/* Lock.
+
+   HOLDER is the word that acquiring and releasing the lock
+   compare-and-swap, so it is set in the same step as the lock is
+   taken.  While threads wait for the lock, its low bit is set
+   (use lock_holder() to read it) and DONATION_ELEM is on the
+   holder's donations queue at the highest waiter's priority. */
 struct lock {
-	struct thread *holder;		/* Thread holding lock (for debugging). */
-	struct semaphore semaphore; /* Binary semaphore controlling access. */
+	struct thread *holder;			/* Thread holding lock, or NULL. */
+	struct waitq waiters;			/* Threads waiting for the lock. */
+	struct waitq_elem donation_elem; /* Element in holder's donations. */
 };
 
 void lock_init(struct lock *);
@@ -27,10 +48,11 @@ void lock_acquire(struct lock *);
 bool lock_try_acquire(struct lock *);
 void lock_release(struct lock *);
 bool lock_held_by_current_thread(const struct lock *);
+struct thread *lock_holder(const struct lock *);
 
 /* Condition variable. */
 struct condition {
-	struct list waiters; /* List of waiting threads. */
+	struct waitq waiters; /* Waiting threads, as semaphore_elems. */
 };
 
 void cond_init(struct condition *);
@@ -38,6 +60,64 @@ void cond_wait(struct condition *, struct lock *);
 void cond_signal(struct condition *, struct lock *);
 void cond_broadcast(struct condition *, struct lock *);
 
+/* Reader-writer lock.
+
+   Any number of readers or a single writer may hold an rwlock at
+   a time.  Writers are preferred: once a writer is waiting, new
+   readers wait behind it.  A thread that blocks on an rwlock
+   donates its priority to the writer or to every reader holding
+   it.  Ownership is handed directly to the threads being woken,
+   so a release never lets a newcomer barge in ahead of them. */
+struct rwlock {
+	int readers;			   /* # of threads holding read access. */
+	struct thread *writer;	   /* Thread holding write access, or NULL. */
+	struct thread *upgrader;   /* Reader waiting in rwlock_upgrade(). */
+	struct list holds;		   /* struct rwlock_hold of each holder and waiter. */
+	struct waitq read_waiters;  /* Threads waiting for read access. */
+	struct waitq write_waiters; /* Threads waiting for write access. */
+};
+
+/* One thread's hold on, or wait for, an rwlock.  Every thread has
+   one of these built in, which covers the first rwlock it holds,
+   so acquiring a single rwlock allocates nothing.  Records for any
+   further rwlocks held at the same time come from a slab cache
+   and are freed on release. */
+struct rwlock_hold {
+	struct rwlock *rwlock;			 /* Rwlock held or awaited, or NULL. */
+	struct thread *thread;			 /* Holding or waiting thread. */
+	bool held;						 /* False while THREAD still waits. */
+	struct list_elem elem;			 /* Element in rwlock's holds. */
+	struct list_elem thread_elem;	 /* Element in thread's rwlock_holds. */
+	struct waitq_elem donation_elem; /* Element in thread's donations. */
+};
+
+void synch_init(void);
+void rwlock_init(struct rwlock *);
+void rwlock_acquire_read(struct rwlock *);
+void rwlock_acquire_write(struct rwlock *);
+void rwlock_release_read(struct rwlock *);
+void rwlock_release_write(struct rwlock *);
+bool rwlock_upgrade(struct rwlock *);
+void rwlock_downgrade(struct rwlock *);
+bool rwlock_held_by_current_thread(const struct rwlock *);
+
+/* Spin lock.
+
+   For the few places where one CPU must wait for another without
+   sleeping, such as the kernel lock (see threads/smp.c).  It is
+   held by a CPU rather than by a thread, and a CPU that finds it
+   taken busy-waits until it is released. */
+struct spinlock {
+	volatile uint64_t locked; /* 1 while held, for cmpxchg. */
+	struct cpu *holder;		  /* CPU holding the lock, or NULL. */
+};
+
+void spinlock_init(struct spinlock *);
+void spinlock_acquire(struct spinlock *);
+bool spinlock_try_acquire(struct spinlock *);
+void spinlock_release(struct spinlock *);
+bool spinlock_held_by_current_cpu(const struct spinlock *);
+
 /* Optimization barrier.
  *
  * The compiler will not reorder operations across an
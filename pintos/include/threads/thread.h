@@ -81,31 +81,37 @@ typedef int tid_t;
  * the `magic' member of the running thread's `struct thread' is
  * set to THREAD_MAGIC.  Stack overflow will normally change this
  * value, triggering the assertion. */
-/* The `elem' member has a dual purpose.  It can be an element in
- * the run queue (thread.c), or it can be an element in a
- * semaphore wait list (synch.c).  It can be used these two ways
- * only because they are mutually exclusive: only a thread in the
- * ready state is on the run queue, whereas only a thread in the
- * blocked state is on a semaphore wait list. */
+/* The `elem' member puts a thread on the run queue or the sleep
+ * list (thread.c); `wait_elem' puts it on the wait queue of a
+ * semaphore or rwlock (synch.c).  A thread in cond_wait() is also
+ * on the condition variable's wait queue through `cond_elem', so
+ * that a change to its priority can move it there as well (see
+ * waitq_set_priority()). */
 struct thread {
 	/* Owned by thread.c. */
 	tid_t tid;				   /* Thread identifier. */
 	enum thread_status status; /* Thread state. */
 	char name[16];			   /* Name (for debugging purposes). */
 	int priority;			   /* Priority. */
+	struct cpu *cpu;		   /* CPU it runs, waits or last ran on. */
 
 	int base_priority;
 	struct lock *waiting_lock;
-	struct list donor_list;
-	struct list_elem donor_elem;
+	struct rwlock *waiting_rwlock; /* rwlock being waited for (synch.c). */
+	struct waitq donations; /* Held locks and rwlocks with waiters (synch.c). */
+	struct list rwlock_holds;		/* Rwlocks held or awaited (synch.c). */
+	struct rwlock_hold rwlock_hold; /* Built-in record for one of them. */
 
 	/* Shared between thread.c and synch.c. */
-	struct list_elem elem; /* List element. */
+	struct list_elem elem;			/* List element. */
+	struct waitq_elem wait_elem;	/* Element in a wait queue. */
+	struct waitq_elem *cond_elem;	/* Condition variable wait, if any. */
 	struct list_elem allelem;
 	int64_t wakeup_tick;
 
 	int nice;
 	fixed_t recent_cpu;
+	int64_t mlfqs_epoch; /* Last recent_cpu decay applied (thread.c). */
 
 #ifdef USERPROG
 	/* Owned by userprog/process.c. */
@@ -122,6 +128,7 @@ struct thread {
 	/* Table for whole virtual memory owned by thread. */
 	struct supplemental_page_table spt;
 	uint64_t *user_rsp;
+	struct memgroup *memgroup; /* Memory group (vm/memgroup.c). */
 #endif
 
 	/* Owned by thread.c. */
@@ -144,6 +151,8 @@ extern bool thread_mlfqs;
 
 void thread_init(void);
 void thread_start(void);
+struct thread *thread_init_ap(struct cpu *);
+void thread_start_ap(void) NO_RETURN;
 
 void thread_tick(void);
 void thread_print_stats(void);
@@ -166,13 +175,14 @@ void wake_sleeping_threads(int64_t tick);
 
 int thread_get_priority(void);
 void thread_set_priority(int);
+void thread_update_priority(struct thread *, int);
 int thread_get_nice(void);
 void thread_set_nice(int);
 int thread_get_recent_cpu(void);
 int thread_get_load_avg(void);
+int64_t thread_mlfqs_epoch(void);
+void thread_mlfqs_catch_up(struct thread *);
 
 void do_iret(struct intr_frame *tf);
 
-bool thread_priority_max(const struct list_elem *e1, const struct list_elem *e2, void *aux);
-
 #endif /* threads/thread.h */
@@ -0,0 +1,26 @@
+#ifndef THREADS_VMALLOC_H
+#define THREADS_VMALLOC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Kernel virtual region for vmalloc().  It lies in the same
+   page map level 4 entry as the direct mapping of physical
+   memory at KERN_BASE, which every page table shares, so its
+   mappings are visible in every process. */
+#define VMALLOC_START 0xff00000000
+#define VMALLOC_SIZE (64 * 1024 * 1024)
+#define VMALLOC_END (VMALLOC_START + VMALLOC_SIZE)
+
+/* Returns true if VADDR lies in the vmalloc() region. */
+#define is_vmalloc_vaddr(vaddr)                                                                    \
+	((uint64_t)(vaddr) >= VMALLOC_START && (uint64_t)(vaddr) < VMALLOC_END)
+
+void vmalloc_init(void);
+void *vmalloc(size_t) __attribute__((malloc));
+void vfree(void *);
+size_t vmalloc_size(const void *);
+void vmalloc_print_stats(void);
+
+#endif /* threads/vmalloc.h */
@@ -0,0 +1,59 @@
+#ifndef THREADS_WAITQ_H
+#define THREADS_WAITQ_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Priority wait queue.
+
+   Holds elements ordered by priority, highest first, and in
+   arrival order among equal priorities.  Usually each element is
+   a blocked thread, queued at the thread's priority.  The queue
+   is a pairing heap threaded through the elements themselves, so
+   it needs no allocation: inserting is O(1), and popping,
+   removing or reprioritizing an element is O(log n) amortized.
+
+   A waiting thread's priority must only be changed through
+   waitq_set_priority(), which moves the thread's elements to
+   their new places.  The exception is the MLFQS's once-a-second
+   recent_cpu decay, which leaves waiters alone: waitq_pop()
+   re-keys a queue's waiting threads the first time it runs after
+   a decay, so the cost of keeping waiters in order falls on the
+   threads that wake them, not on the timer interrupt.  All
+   operations that change a queue must be called with interrupts
+   off. */
+struct waitq {
+	struct waitq_elem *root; /* Highest-priority waiter, or NULL. */
+	uint64_t next_seq;		 /* Sequence number for the next push. */
+	int64_t mlfqs_epoch;	 /* Decay the waiters were last keyed at. */
+};
+
+/* Wait queue element. */
+struct waitq_elem {
+	struct waitq_elem *child; /* Leftmost child. */
+	struct waitq_elem *next;  /* Next sibling. */
+	struct waitq_elem *prev;  /* Previous sibling, or parent if leftmost. */
+	struct waitq *queue;	  /* Queue this element is on, or NULL. */
+	struct thread *thread;	  /* Waiting thread, if any. */
+	int priority;			  /* Key. */
+	uint64_t seq;			  /* Arrival order, to break ties. */
+};
+
+/* Converts pointer to wait queue element WAITQ_ELEM into a
+   pointer to the structure that WAITQ_ELEM is embedded inside. */
+#define waitq_entry(WAITQ_ELEM, STRUCT, MEMBER) \
+	((STRUCT *)((uint8_t *)(WAITQ_ELEM) - offsetof(STRUCT, MEMBER)))
+
+void waitq_init(struct waitq *);
+bool waitq_empty(const struct waitq *);
+void waitq_push(struct waitq *, struct waitq_elem *, struct thread *);
+void waitq_insert(struct waitq *, struct waitq_elem *, int priority);
+struct waitq_elem *waitq_front(const struct waitq *);
+struct waitq_elem *waitq_pop(struct waitq *);
+void waitq_remove(struct waitq_elem *);
+void waitq_update(struct waitq_elem *, int priority);
+
+void waitq_set_priority(struct thread *, int priority);
+
+#endif /* threads/waitq.h */
@@ -6,5 +6,6 @@
 extern struct lock file_lock;
 
 void syscall_init(void);
+void syscall_init_ap(void);
 
 #endif /* userprog/syscall.h */
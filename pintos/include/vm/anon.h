@@ -5,10 +5,19 @@ struct page;
 enum vm_type;
 
 struct anon_page {
-    int swap_table_index;
+    int swap_table_index;           /* Swap slot, set once written. */
+    struct memgroup *swap_memgroup; /* Group charged for the swap slot. */
+    struct swap_cache_entry *cached; /* Slot contents read ahead, if any. */
+    struct zswap_entry *zswap;      /* Compressed contents, if in zswap. */
+    bool zero;                      /* Swapped out as a page of zeros? */
 };
 
 void vm_anon_init(void);
+void vm_anon_print_stats(void);
 bool anon_initializer(struct page *page, enum vm_type type, void *kva);
+bool anon_copy_swapped(struct page *page, void *kva);
+bool anon_swap_reserve(struct page *page);
+void anon_swap_out_cluster(struct page *pages[], size_t cnt);
+bool anon_swap_cache_shrink(struct memgroup *target);
 
 #endif
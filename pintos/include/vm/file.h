@@ -1,6 +1,7 @@
 #ifndef VM_FILE_H
 #define VM_FILE_H
 #include "filesys/file.h"
+#include "threads/slab.h"
 #include "vm/vm.h"
 
 struct page;
@@ -22,8 +23,13 @@ struct mmap_aux {
 	uint32_t mmap_length;
 };
 
+/* Cache of struct mmap_aux. */
+extern struct kmem_cache *mmap_aux_slab;
+
 void vm_file_init(void);
 bool file_backed_initializer(struct page *page, enum vm_type type, void *kva);
 void *do_mmap(void *addr, size_t length, int writable, struct file *file, off_t offset);
 void do_munmap(void *va);
+void file_backed_readahead(struct page *page);
+void file_backed_cancel_readahead(struct page *page);
 #endif
@@ -0,0 +1,37 @@
+#ifndef VM_MEMGROUP_H
+#define VM_MEMGROUP_H
+#include <stdbool.h>
+#include <stddef.h>
+
+/* A memory group.
+ *
+ * Groups form a tree that follows the process hierarchy: a forked
+ * process starts in its parent's group, and a process may move
+ * itself into a new child group with the memgroup system call.
+ * Each group bounds the resident frames and swap slots of all the
+ * processes in its subtree.  When a group reaches its frame limit,
+ * the next frame is reclaimed from within that group instead of
+ * from unrelated processes. */
+struct memgroup {
+	struct memgroup *parent; /* Enclosing group, NULL for the root. */
+	size_t frame_limit;		 /* Max resident frames, 0 for no limit. */
+	size_t swap_limit;		 /* Max swap slots, 0 for no limit. */
+	size_t frame_cnt;		 /* Frames charged to this subtree. */
+	size_t swap_cnt;		 /* Swap slots charged to this subtree. */
+	int refcnt;				 /* Members, child groups and charges. */
+};
+
+void memgroup_init(void);
+struct memgroup *memgroup_root(void);
+struct memgroup *memgroup_create(struct memgroup *parent, size_t frame_limit, size_t swap_limit);
+struct memgroup *memgroup_get(struct memgroup *);
+void memgroup_put(struct memgroup *);
+
+bool memgroup_contains(const struct memgroup *group, const struct memgroup *mg);
+struct memgroup *memgroup_reclaim_target(struct memgroup *);
+void memgroup_charge_frame(struct memgroup *);
+void memgroup_uncharge_frame(struct memgroup *);
+bool memgroup_try_charge_swap(struct memgroup *);
+void memgroup_uncharge_swap(struct memgroup *);
+
+#endif /* vm/memgroup.h */
@@ -0,0 +1,40 @@
+#ifndef VM_READAHEAD_H
+#define VM_READAHEAD_H
+#include <stdbool.h>
+#include <stddef.h>
+#include "filesys/off_t.h"
+
+struct file;
+struct memgroup;
+
+/* Readahead for mmapped files.
+ *
+ * Each mapping's faults are watched for a sequential pattern.  Once
+ * one shows up, the pages ahead of it are read by a background
+ * thread into a small cache, in windows that double with every
+ * window the mapping runs into, so that later faults find their
+ * contents already in memory.  A fault that breaks the pattern
+ * stops readahead for the mapping until it is seen again.
+ *
+ * Patterns and cached pages are kept per inode, so that every
+ * mapping of a file (each with its own struct file, as do_mmap()
+ * reopens it) sees the same pages.  A cached page remembers the
+ * inode's write generation it was read at and is thrown away if the
+ * inode has been written since, whether through a mapping or with
+ * write().  It is charged as a frame to the memory group of the
+ * process whose fault read it ahead, until it is used or dropped;
+ * a process's readahead is cancelled when it exits, as on munmap. */
+
+/* Pages in the first and the largest readahead windows. */
+#define READAHEAD_MIN 4
+#define READAHEAD_MAX 32
+
+void readahead_init(void);
+size_t readahead_fault(struct file *, off_t ofs, off_t gap, off_t *start);
+void readahead_submit(struct file *, const off_t ofs[], const size_t len[], size_t cnt);
+int readahead_take(struct file *, off_t ofs, void *kva);
+void readahead_cancel(struct file *);
+bool readahead_shrink(struct memgroup *target);
+void readahead_print_stats(void);
+
+#endif /* vm/readahead.h */
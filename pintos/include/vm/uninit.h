@@ -1,5 +1,6 @@
 #ifndef VM_UNINIT_H
 #define VM_UNINIT_H
+#include "threads/slab.h"
 #include "vm/vm.h"
 
 struct page;
@@ -23,6 +24,9 @@ struct vm_load_aux {
 	uint32_t page_read_bytes; // 페이지에서 읽어야 하는 바이트의 개수
 };
 
+/* Cache of struct vm_load_aux. */
+extern struct kmem_cache *vm_load_aux_slab;
+
 void uninit_new(struct page *page, void *va, vm_initializer *init, enum vm_type type, void *aux,
 				bool (*initializer)(struct page *, enum vm_type, void *kva));
 #endif
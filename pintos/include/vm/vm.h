@@ -2,6 +2,7 @@
 #define VM_VM_H
 #include <stdbool.h>
 #include "threads/palloc.h"
+#include "threads/synch.h"
 #include "hash.h"
 
 enum vm_type {
@@ -25,6 +26,7 @@ enum vm_type {
 	VM_MARKER_END = (1 << 31),
 };
 
+#include "vm/memgroup.h"
 #include "vm/uninit.h"
 #include "vm/anon.h"
 #include "vm/file.h"
@@ -50,6 +52,8 @@ struct page {
 	struct hash_elem spt_hash_elem;
 	bool writable;
 	struct thread *owner_thread;
+	uint64_t ghost_seq; /* Eviction from 2Q's A1in, or 0 if none. */
+	struct list_elem share_elem; /* Element in frame's sharers. */
 
 	/* Per-type data are binded into the union.
 	 * Each function automatically detects the current union */
@@ -68,6 +72,12 @@ struct frame {
 	void *kva;
 	struct page *page;
 	struct list_elem frame_elem;
+	struct memgroup *memgroup; /* Group this frame is charged to. */
+	uint8_t age;			   /* Clock sweeps since last referenced. */
+	bool in_a1in;			   /* On 2Q's A1in rather than the clock ring? */
+	bool evicting;			   /* Being written out by vm_evict_frame()? */
+	bool pinned;			   /* Kept from eviction while PAGE is loaded or destroyed? */
+	struct list sharers;	   /* Pages other than PAGE sharing this frame. */
 };
 
 /* The function table for page operations.
@@ -92,6 +102,7 @@ struct page_operations {
  * All designs up to you for this. */
 struct supplemental_page_table {
 	struct hash spt_hash;
+	struct rwlock rwlock; /* Lookups read, insertions and removals write. */
 };
 
 #include "threads/thread.h"
@@ -100,10 +111,22 @@ bool supplemental_page_table_copy(struct supplemental_page_table *dst,
 								  struct supplemental_page_table *src);
 void supplemental_page_table_kill(struct supplemental_page_table *spt);
 struct page *spt_find_page(struct supplemental_page_table *spt, void *va);
+struct page *spt_find_page_locked(struct supplemental_page_table *spt, void *va);
 bool spt_insert_page(struct supplemental_page_table *spt, struct page *page);
 void spt_remove_page(struct supplemental_page_table *spt, struct page *page);
 
+/* Frame replacement policies. */
+enum vm_evict_policy {
+	VM_EVICT_CLOCK, /* Second-chance clock over the whole table. */
+	VM_EVICT_2Q,	/* 2Q: FIFO for new pages in front of the clock. */
+};
+
+extern enum vm_evict_policy vm_evict_policy;
+extern unsigned vm_clock_age;
+extern unsigned vm_fault_around;
+
 void vm_init(void);
+void vm_print_stats(void);
 bool vm_try_handle_fault(struct intr_frame *f, void *addr, bool user, bool write, bool not_present);
 
 #define vm_alloc_page(type, upage, writable)                                                       \
@@ -112,6 +135,8 @@ bool vm_alloc_page_with_initializer(enum vm_type type, void *upage, bool writabl
 									vm_initializer *init, void *aux);
 void vm_dealloc_page(struct page *page);
 bool vm_claim_page(void *va);
+bool vm_pin_frame(struct page *page);
+void vm_release_frame(struct page *page);
 enum vm_type page_get_type(struct page *page);
 
 #endif /* VM_VM_H */
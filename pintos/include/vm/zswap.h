@@ -0,0 +1,26 @@
+#ifndef VM_ZSWAP_H
+#define VM_ZSWAP_H
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Compressed swap pool.
+ *
+ * Sits in front of the swap disk: an evicted anonymous page is
+ * compressed into kernel memory if it shrinks enough and the pool
+ * has room, and goes to the disk otherwise.  The pool's size is
+ * bounded by zswap_max_kb, set with -zswap=KB; 0 turns it off. */
+struct zswap_entry;
+
+/* Largest pool -zswap takes, in kB.  The pool comes out of the
+ * kernel's memory, which is never anywhere near this big. */
+#define ZSWAP_LIMIT_KB (64 * 1024)
+
+extern size_t zswap_max_kb;
+
+void zswap_init(void);
+struct zswap_entry *zswap_store(const void *page);
+void zswap_load(const struct zswap_entry *, void *page);
+void zswap_free(struct zswap_entry *);
+void zswap_print_stats(void);
+
+#endif /* vm/zswap.h */
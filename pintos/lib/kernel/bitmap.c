@@ -27,6 +27,7 @@ typedef unsigned long elem_type;
 struct bitmap {
 	size_t bit_cnt;	 /* Number of bits. */
 	elem_type *bits; /* Elements that represent bits. */
+	size_t next_fit; /* Where bitmap_scan_and_flip_next() starts. */
 };
 
 /* Returns the index of the element that contains the bit
@@ -63,6 +64,55 @@ static inline elem_type last_mask(const struct bitmap *b)
 	return last_bits ? ((elem_type)1 << last_bits) - 1 : (elem_type)-1;
 }
 
+/* Returns a bit mask in which the bits of element ELEM_IDX that
+   represent bits START through END - 1 are set to 1 and the rest
+   are set to 0. */
+static inline elem_type range_mask(size_t elem_idx, size_t start, size_t end)
+{
+	size_t lo = elem_idx * ELEM_BITS;
+	elem_type mask = (elem_type)-1;
+
+	if (start > lo)
+		mask &= ~(((elem_type)1 << (start - lo)) - 1);
+	if (end < lo + ELEM_BITS)
+		mask &= ((elem_type)1 << (end - lo)) - 1;
+	return mask;
+}
+
+/* Returns the number of bits set to 1 in ELEM. */
+static inline size_t elem_popcount(elem_type elem)
+{
+	elem = elem - ((elem >> 1) & 0x5555555555555555UL);
+	elem = (elem & 0x3333333333333333UL) + ((elem >> 2) & 0x3333333333333333UL);
+	elem = (elem + (elem >> 4)) & 0x0f0f0f0f0f0f0f0fUL;
+	return (elem * 0x0101010101010101UL) >> 56;
+}
+
+/* Returns the index of the first bit in B between START and END,
+   exclusive, that is set to VALUE, or END if there is none.
+   Elements with no such bit are skipped with a single compare,
+   and the bit is located within its element with a
+   count-trailing-zeros instruction. */
+static size_t find_next(const struct bitmap *b, size_t start, size_t end, bool value)
+{
+	elem_type flip = value ? 0 : (elem_type)-1;
+	size_t idx, last;
+	elem_type elem;
+
+	if (start >= end)
+		return end;
+
+	idx = elem_idx(start);
+	last = elem_idx(end - 1);
+	elem = (b->bits[idx] ^ flip) & range_mask(idx, start, end);
+	while (elem == 0) {
+		if (++idx > last)
+			return end;
+		elem = (b->bits[idx] ^ flip) & range_mask(idx, start, end);
+	}
+	return idx * ELEM_BITS + __builtin_ctzl(elem);
+}
+
 /* Creation and destruction. */
 
 /* Initializes B to be a bitmap of BIT_CNT bits
@@ -74,6 +124,7 @@ struct bitmap *bitmap_create(size_t bit_cnt)
 	struct bitmap *b = malloc(sizeof *b);
 	if (b != NULL) {
 		b->bit_cnt = bit_cnt;
+		b->next_fit = 0;
 		b->bits = malloc(byte_cnt(bit_cnt));
 		if (b->bits != NULL || bit_cnt == 0) {
 			bitmap_set_all(b, false);
@@ -94,6 +145,7 @@ struct bitmap *bitmap_create_in_buf(size_t bit_cnt, void *block, size_t block_si
 	ASSERT(block_size >= bitmap_buf_size(bit_cnt));
 
 	b->bit_cnt = bit_cnt;
+	b->next_fit = 0;
 	b->bits = (elem_type *)(b + 1);
 	bitmap_set_all(b, false);
 	return b;
@@ -194,50 +246,58 @@ void bitmap_set_all(struct bitmap *b, bool value)
 	bitmap_set_multiple(b, 0, bitmap_size(b), value);
 }
 
-/* Sets the CNT bits starting at START in B to VALUE. */
+/* Sets the CNT bits starting at START in B to VALUE.  Each
+   element is updated atomically, but the whole range is not. */
 void bitmap_set_multiple(struct bitmap *b, size_t start, size_t cnt, bool value)
 {
-	size_t i;
+	size_t end = start + cnt;
+	size_t idx;
 
 	ASSERT(b != NULL);
 	ASSERT(start <= b->bit_cnt);
 	ASSERT(start + cnt <= b->bit_cnt);
 
-	for (i = 0; i < cnt; i++)
-		bitmap_set(b, start + i, value);
+	if (cnt == 0)
+		return;
+	for (idx = elem_idx(start); idx <= elem_idx(end - 1); idx++) {
+		elem_type mask = range_mask(idx, start, end);
+
+		/* See bitmap_mark() and bitmap_reset(). */
+		if (value)
+			asm("lock orq %1, %0" : "=m"(b->bits[idx]) : "r"(mask) : "cc");
+		else
+			asm("lock andq %1, %0" : "=m"(b->bits[idx]) : "r"(~mask) : "cc");
+	}
 }
 
 /* Returns the number of bits in B between START and START + CNT,
    exclusive, that are set to VALUE. */
 size_t bitmap_count(const struct bitmap *b, size_t start, size_t cnt, bool value)
 {
-	size_t i, value_cnt;
+	size_t end = start + cnt;
+	size_t idx, true_cnt;
 
 	ASSERT(b != NULL);
 	ASSERT(start <= b->bit_cnt);
 	ASSERT(start + cnt <= b->bit_cnt);
 
-	value_cnt = 0;
-	for (i = 0; i < cnt; i++)
-		if (bitmap_test(b, start + i) == value)
-			value_cnt++;
-	return value_cnt;
+	if (cnt == 0)
+		return 0;
+	true_cnt = 0;
+	for (idx = elem_idx(start); idx <= elem_idx(end - 1); idx++)
+		true_cnt += elem_popcount(b->bits[idx] & range_mask(idx, start, end));
+	return value ? true_cnt : cnt - true_cnt;
 }
 
 /* Returns true if any bits in B between START and START + CNT,
    exclusive, are set to VALUE, and false otherwise. */
 bool bitmap_contains(const struct bitmap *b, size_t start, size_t cnt, bool value)
 {
-	size_t i;
-
 	ASSERT(b != NULL);
 	ASSERT(start <= b->bit_cnt);
 	ASSERT(start + cnt <= b->bit_cnt);
 
-	for (i = 0; i < cnt; i++)
-		if (bitmap_test(b, start + i) == value)
-			return true;
-	return false;
+	return find_next(b, start, start + cnt, value) < start + cnt;
 }
 
 /* Returns true if any bits in B between START and START + CNT,
@@ -266,20 +326,34 @@ bool bitmap_all(const struct bitmap *b, size_t start, size_t cnt)
 /* Finds and returns the starting index of the first group of CNT
    consecutive bits in B at or after START that are all set to
    VALUE.
-   If there is no such group, returns BITMAP_ERROR. */
+   If there is no such group, returns BITMAP_ERROR.
+
+   Jumps from each candidate run straight past the first bit that
+   ends it, so each element is looked at only a few times however
+   large CNT is. */
 size_t bitmap_scan(const struct bitmap *b, size_t start, size_t cnt, bool value)
 {
+	size_t i = start;
+
 	ASSERT(b != NULL);
 	ASSERT(start <= b->bit_cnt);
 
-	if (cnt <= b->bit_cnt) {
-		size_t last = b->bit_cnt - cnt;
-		size_t i;
-		for (i = start; i <= last; i++)
-			if (!bitmap_contains(b, i, cnt, !value))
-				return i;
+	if (cnt == 0)
+		return start;
+	if (cnt > b->bit_cnt)
+		return BITMAP_ERROR;
+
+	for (;;) {
+		size_t end;
+
+		i = find_next(b, i, b->bit_cnt, value);
+		if (i > b->bit_cnt - cnt)
+			return BITMAP_ERROR;
+		end = find_next(b, i, i + cnt, !value);
+		if (end == i + cnt)
+			return i;
+		i = end;
 	}
-	return BITMAP_ERROR;
 }
 
 /* Finds the first group of CNT consecutive bits in B at or after
@@ -297,6 +371,24 @@ size_t bitmap_scan_and_flip(struct bitmap *b, size_t start, size_t cnt, bool val
 	return idx;
 }
 
+/* Like bitmap_scan_and_flip(), but starts where the previous call
+   on B left off instead of at a fixed index, wrapping around to
+   the start of B once, so that repeated allocations do not scan
+   the same used bits over and over ("next fit"). */
+size_t bitmap_scan_and_flip_next(struct bitmap *b, size_t cnt, bool value)
+{
+	size_t start = b->next_fit <= b->bit_cnt ? b->next_fit : 0;
+	size_t idx = bitmap_scan(b, start, cnt, value);
+
+	if (idx == BITMAP_ERROR && start > 0)
+		idx = bitmap_scan(b, 0, cnt, value);
+	if (idx != BITMAP_ERROR) {
+		bitmap_set_multiple(b, idx, cnt, !value);
+		b->next_fit = idx + cnt < b->bit_cnt ? idx + cnt : 0;
+	}
+	return idx;
+}
+
 /* File input and output. */
 
 #ifdef FILESYS
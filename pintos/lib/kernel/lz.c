@@ -0,0 +1,190 @@
+/* LZ77-family block compressor.
+
+   See lz.h for the block format. */
+
+#include "lz.h"
+#include <string.h>
+#include "../debug.h"
+
+/* Shortest match worth encoding. */
+#define MIN_MATCH 4
+
+/* Largest value a token nibble holds before the count spills
+   into extra bytes. */
+#define NIBBLE_MAX 15
+
+static uint32_t read32(const uint8_t *);
+static uint32_t hash(uint32_t);
+static uint8_t *put_count(uint8_t *op, uint8_t *op_end, size_t cnt);
+
+/* Compresses the SRC_LEN bytes at SRC into DST, which has room
+   for DST_CAP bytes, using WORK, which must be LZ_WORK_SIZE
+   bytes, as scratch.  Returns the compressed length, or 0 if it
+   would exceed DST_CAP. */
+size_t lz_compress(const void *src_, size_t src_len, void *dst_, size_t dst_cap, void *work)
+{
+	const uint8_t *src = src_;
+	uint8_t *dst = dst_;
+	uint8_t *op = dst;
+	uint8_t *op_end = dst + dst_cap;
+	uint16_t *table = work;
+	size_t ip = 0, anchor = 0;
+	size_t lit_cnt;
+
+	ASSERT(src_len <= LZ_MAX_INPUT);
+
+	memset(table, 0, LZ_WORK_SIZE);
+	while (ip + MIN_MATCH <= src_len) {
+		uint32_t v = read32(src + ip);
+		uint32_t h = hash(v);
+		size_t ref = table[h];
+		size_t match_len;
+		uint8_t *token;
+
+		table[h] = ip;
+		if (ref >= ip || read32(src + ref) != v) {
+			/* Step faster the longer we go without a match, so that
+			   data that does not compress is passed over quickly. */
+			ip += 1 + ((ip - anchor) >> 6);
+			continue;
+		}
+
+		match_len = MIN_MATCH;
+		while (ip + match_len < src_len && src[ref + match_len] == src[ip + match_len])
+			match_len++;
+
+		/* Token, literals, offset, match length. */
+		lit_cnt = ip - anchor;
+		if (op >= op_end)
+			return 0;
+		token = op++;
+		*token = ((lit_cnt < NIBBLE_MAX ? lit_cnt : NIBBLE_MAX) << 4 |
+				  (match_len - MIN_MATCH < NIBBLE_MAX ? match_len - MIN_MATCH : NIBBLE_MAX));
+		if (lit_cnt >= NIBBLE_MAX && (op = put_count(op, op_end, lit_cnt - NIBBLE_MAX)) == NULL)
+			return 0;
+		if ((size_t)(op_end - op) < lit_cnt + 2)
+			return 0;
+		memcpy(op, src + anchor, lit_cnt);
+		op += lit_cnt;
+		*op++ = (ip - ref) & 0xff;
+		*op++ = (ip - ref) >> 8;
+		if (match_len - MIN_MATCH >= NIBBLE_MAX &&
+			(op = put_count(op, op_end, match_len - MIN_MATCH - NIBBLE_MAX)) == NULL)
+			return 0;
+
+		ip += match_len;
+		anchor = ip;
+	}
+
+	/* Last sequence: the remaining literals. */
+	lit_cnt = src_len - anchor;
+	if (op >= op_end)
+		return 0;
+	*op++ = (lit_cnt < NIBBLE_MAX ? lit_cnt : NIBBLE_MAX) << 4;
+	if (lit_cnt >= NIBBLE_MAX && (op = put_count(op, op_end, lit_cnt - NIBBLE_MAX)) == NULL)
+		return 0;
+	if ((size_t)(op_end - op) < lit_cnt)
+		return 0;
+	memcpy(op, src + anchor, lit_cnt);
+	op += lit_cnt;
+
+	return op - dst;
+}
+
+/* Decompresses the SRC_LEN-byte block at SRC into DST.  Returns
+   true if the block is well formed and decompresses to exactly
+   DST_LEN bytes, false otherwise.  Never reads or writes outside
+   the given buffers, even if SRC is corrupt. */
+bool lz_decompress(const void *src_, size_t src_len, void *dst_, size_t dst_len)
+{
+	const uint8_t *ip = src_;
+	const uint8_t *ip_end = ip + src_len;
+	uint8_t *dst = dst_;
+	uint8_t *op = dst;
+	uint8_t *op_end = dst + dst_len;
+
+	for (;;) {
+		size_t lit_cnt, match_len, offset;
+		uint8_t token;
+
+		if (ip >= ip_end)
+			return false;
+		token = *ip++;
+
+		lit_cnt = token >> 4;
+		if (lit_cnt == NIBBLE_MAX) {
+			uint8_t b;
+			do {
+				if (ip >= ip_end)
+					return false;
+				b = *ip++;
+				lit_cnt += b;
+			} while (b == 255);
+		}
+		if ((size_t)(ip_end - ip) < lit_cnt || (size_t)(op_end - op) < lit_cnt)
+			return false;
+		memcpy(op, ip, lit_cnt);
+		ip += lit_cnt;
+		op += lit_cnt;
+
+		/* The last sequence ends the block. */
+		if (ip == ip_end)
+			return op == op_end;
+
+		if (ip_end - ip < 2)
+			return false;
+		offset = ip[0] | ip[1] << 8;
+		ip += 2;
+		if (offset == 0 || offset > (size_t)(op - dst))
+			return false;
+
+		match_len = (token & NIBBLE_MAX) + MIN_MATCH;
+		if ((token & NIBBLE_MAX) == NIBBLE_MAX) {
+			uint8_t b;
+			do {
+				if (ip >= ip_end)
+					return false;
+				b = *ip++;
+				match_len += b;
+			} while (b == 255);
+		}
+		if ((size_t)(op_end - op) < match_len)
+			return false;
+
+		/* The match may overlap what it produces, so copy it a byte
+		   at a time. */
+		for (; match_len > 0; match_len--, op++)
+			*op = op[-offset];
+	}
+}
+
+/* Reads 4 unaligned bytes at P. */
+static uint32_t read32(const uint8_t *p)
+{
+	uint32_t v;
+	memcpy(&v, p, sizeof v);
+	return v;
+}
+
+/* Returns the hash table index for the 4 bytes V. */
+static uint32_t hash(uint32_t v)
+{
+	return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/* Writes the extra bytes of a count that overflowed its nibble by
+   CNT to OP, stopping short of OP_END.  Returns the new OP, or a
+   null pointer if there is no room. */
+static uint8_t *put_count(uint8_t *op, uint8_t *op_end, size_t cnt)
+{
+	for (;;) {
+		if (op >= op_end)
+			return NULL;
+		if (cnt < 255) {
+			*op++ = cnt;
+			return op;
+		}
+		*op++ = 255;
+		cnt -= 255;
+	}
+}
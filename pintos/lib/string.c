@@ -1,5 +1,35 @@
 #include <string.h>
 #include <debug.h>
+#include <stdint.h>
+
+/* Block copies and fills use the x86-64 string instructions,
+   which modern CPUs run in cache-line-sized chunks, instead of
+   moving a byte at a time.  By default they move quadwords with
+   REP MOVSQ and REP STOSQ and finish any odd bytes with REP MOVSB
+   and REP STOSB.  On CPUs with "enhanced REP MOVSB/STOSB" (ERMS),
+   the byte forms are at least as fast for any size, so the kernel
+   sets string_erms at boot and a single REP MOVSB or REP STOSB
+   does the whole job.  Whole pages, being aligned and a multiple
+   of 8 bytes long, always take a single REP MOVSQ or REP STOSQ on
+   CPUs without ERMS.
+
+   SSE is not used: the kernel is built with -mno-sse and does not
+   save the user's SSE registers on entry. */
+
+/* True if the CPU has ERMS.  Set by the kernel at boot. */
+bool string_erms;
+
+/* A quadword that may be unaligned and may alias anything. */
+typedef uint64_t __attribute__((__may_alias__, __aligned__(1))) unaligned_u64;
+
+/* Copies CNT quadwords, then CNT_BYTES bytes, from *SRC to *DST,
+   advancing both. */
+static inline void rep_movs(unsigned char **dst, const unsigned char **src, size_t cnt,
+							size_t cnt_bytes)
+{
+	asm volatile("rep movsq" : "+D"(*dst), "+S"(*src), "+c"(cnt) : : "memory");
+	asm volatile("rep movsb" : "+D"(*dst), "+S"(*src), "+c"(cnt_bytes) : : "memory");
+}
 
 /* Copies SIZE bytes from SRC to DST, which must not overlap.
    Returns DST. */
@@ -11,8 +41,10 @@ void *memcpy(void *dst_, const void *src_, size_t size)
 	ASSERT(dst != NULL || size == 0);
 	ASSERT(src != NULL || size == 0);
 
-	while (size-- > 0)
-		*dst++ = *src++;
+	if (string_erms)
+		rep_movs(&dst, &src, 0, size);
+	else
+		rep_movs(&dst, &src, size / 8, size % 8);
 
 	return dst_;
 }
@@ -27,17 +59,23 @@ void *memmove(void *dst_, const void *src_, size_t size)
 	ASSERT(dst != NULL || size == 0);
 	ASSERT(src != NULL || size == 0);
 
-	if (dst < src) {
-		while (size-- > 0)
-			*dst++ = *src++;
+	if (dst <= src || dst >= src + size) {
+		/* A forward copy never overwrites source bytes it has
+		   yet to read. */
+		memcpy(dst, src, size);
 	} else {
 		dst += size;
 		src += size;
+		for (; size >= 8; size -= 8) {
+			dst -= 8;
+			src -= 8;
+			*(unaligned_u64 *)dst = *(const unaligned_u64 *)src;
+		}
 		while (size-- > 0)
 			*--dst = *--src;
 	}
 
-	return dst;
+	return dst_;
 }
 
 /* Find the first differing byte in the two blocks of SIZE bytes
@@ -52,6 +90,10 @@ int memcmp(const void *a_, const void *b_, size_t size)
 	ASSERT(a != NULL || size == 0);
 	ASSERT(b != NULL || size == 0);
 
+	/* Skip equal quadwords, then find the differing byte. */
+	for (; size >= 8; size -= 8, a += 8, b += 8)
+		if (*(const unaligned_u64 *)a != *(const unaligned_u64 *)b)
+			break;
 	for (; size-- > 0; a++, b++)
 		if (*a != *b)
 			return *a > *b ? +1 : -1;
@@ -257,11 +299,14 @@ char *strtok_r(char *s, const char *delimiters, char **save_ptr)
 void *memset(void *dst_, int value, size_t size)
 {
 	unsigned char *dst = dst_;
+	uint64_t pattern = (unsigned char)value * 0x0101010101010101ULL;
+	size_t cnt = string_erms ? 0 : size / 8;
+	size_t cnt_bytes = string_erms ? size : size % 8;
 
 	ASSERT(dst != NULL || size == 0);
 
-	while (size-- > 0)
-		*dst++ = value;
+	asm volatile("rep stosq" : "+D"(dst), "+c"(cnt) : "a"(pattern) : "memory");
+	asm volatile("rep stosb" : "+D"(dst), "+c"(cnt_bytes) : "a"(pattern) : "memory");
 
 	return dst_;
 }
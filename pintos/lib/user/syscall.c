@@ -23,7 +23,7 @@ __attribute__((always_inline)) static __inline int64_t syscall(uint64_t num_, ui
 					 "mov %5, %%r10\n"
 					 "mov %6, %%r8\n"
 					 "mov %7, %%r9\n"
-					 "syscall\n"
+					 "ud2\n"
 					 : "=a"(ret)
 					 : "g"(num), "g"(a1), "g"(a2), "g"(a3), "g"(a4), "g"(a5), "g"(a6)
 					 : "cc", "memory");
@@ -139,6 +139,11 @@ void munmap(void *addr)
 	syscall1(SYS_MUNMAP, addr);
 }
 
+bool memgroup(size_t frame_limit, size_t swap_limit)
+{
+	return syscall2(SYS_MEMGROUP, frame_limit, swap_limit);
+}
+
 bool chdir(const char *dir)
 {
 	return syscall1(SYS_CHDIR, dir);
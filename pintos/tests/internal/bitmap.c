@@ -0,0 +1,172 @@
+/* Test program and micro-benchmark for lib/kernel/bitmap.c.
+
+   First checks bitmap_scan(), bitmap_count(), bitmap_contains()
+   and bitmap_set_multiple() against a plain array of bools on
+   random bitmaps.  Then times scans of a large, mostly full
+   bitmap against a bit-by-bit reference scan, and single-bit
+   allocations with first fit against next fit, and prints the
+   cycle counts.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <bitmap.h>
+#include <debug.h>
+#include <random.h>
+#include <stdio.h>
+#include "intrinsic.h"
+#include "threads/test.h"
+
+/* Largest bitmap checked against the reference. */
+#define MAX_BITS 1024
+
+/* Size of the benchmark bitmap. */
+#define BIG_BITS (1024 * 1024)
+
+/* Number of timed operations of each kind. */
+#define BENCH_OPS 64
+
+static bool ref[MAX_BITS];
+
+static void check_random (void);
+static void bench (void);
+static size_t ref_scan (const struct bitmap *, size_t start, size_t cnt,
+                        bool value);
+
+void
+test (void) 
+{
+  check_random ();
+  bench ();
+  printf ("bitmap: PASS\n");
+}
+
+/* Checks the bitmap operations against REF on random bitmaps of
+   random density. */
+static void
+check_random (void) 
+{
+  int round;
+
+  printf ("testing random bitmaps:");
+  for (round = 0; round < 100; round++) 
+    {
+      size_t bit_cnt = random_ulong () % MAX_BITS + 1;
+      struct bitmap *b = bitmap_create (bit_cnt);
+      int density = random_ulong () % 100;
+      size_t i, q;
+
+      ASSERT (b != NULL);
+      for (i = 0; i < bit_cnt; i++) 
+        {
+          ref[i] = (int) (random_ulong () % 100) < density;
+          bitmap_set (b, i, ref[i]);
+        }
+
+      for (q = 0; q < 100; q++) 
+        {
+          size_t start = random_ulong () % (bit_cnt + 1);
+          size_t cnt = random_ulong () % (q % 2 ? 8 : 130);
+          bool value = random_ulong () % 2;
+          size_t expect = BITMAP_ERROR, value_cnt = 0;
+
+          /* Reference scan. */
+          for (i = start; i + cnt <= bit_cnt && expect == BITMAP_ERROR; i++) 
+            {
+              size_t j;
+              for (j = 0; j < cnt && ref[i + j] == value; j++)
+                continue;
+              if (j == cnt)
+                expect = i;
+            }
+          ASSERT (bitmap_scan (b, start, cnt, value) == expect);
+
+          if (start + cnt > bit_cnt)
+            continue;
+          for (i = start; i < start + cnt; i++)
+            value_cnt += ref[i] == value;
+          ASSERT (bitmap_count (b, start, cnt, value) == value_cnt);
+          ASSERT (bitmap_contains (b, start, cnt, value) == (value_cnt > 0));
+
+          if (q % 4 == 0) 
+            {
+              bitmap_set_multiple (b, start, cnt, value);
+              for (i = start; i < start + cnt; i++)
+                ref[i] = value;
+              for (i = 0; i < bit_cnt; i++)
+                ASSERT (bitmap_test (b, i) == ref[i]);
+            }
+        }
+      bitmap_destroy (b);
+      if (round % 10 == 0)
+        printf (" %d", round);
+    }
+  printf (" done\n");
+}
+
+/* Times operations on a bitmap of BIG_BITS bits in which only
+   every 61st bit is free and a single run of 64 free bits sits
+   at the very end. */
+static void
+bench (void) 
+{
+  struct bitmap *b = bitmap_create (BIG_BITS);
+  uint64_t start, ref_cycles, scan_cycles, first_cycles, next_cycles;
+  size_t i, idx;
+
+  ASSERT (b != NULL);
+  bitmap_set_all (b, true);
+  for (i = 0; i < BIG_BITS; i += 61)
+    bitmap_reset (b, i);
+  bitmap_set_multiple (b, BIG_BITS - 64, 64, false);
+
+  start = rdtsc ();
+  idx = ref_scan (b, 0, 64, false);
+  ref_cycles = rdtsc () - start;
+  ASSERT (idx == BIG_BITS - 64);
+
+  start = rdtsc ();
+  for (i = 0; i < BENCH_OPS; i++)
+    ASSERT (bitmap_scan (b, 0, 64, false) == BIG_BITS - 64);
+  scan_cycles = (rdtsc () - start) / BENCH_OPS;
+  printf ("64-bit run in %d bits: %llu cycles bit by bit, "
+          "%llu cycles by words\n",
+          BIG_BITS, ref_cycles, scan_cycles);
+
+  /* Allocate the single free bits one by one, first with first
+     fit, then again with next fit. */
+  start = rdtsc ();
+  for (i = 0; i < BENCH_OPS * 16; i++)
+    ASSERT (bitmap_scan_and_flip (b, 0, 1, false) != BITMAP_ERROR);
+  first_cycles = (rdtsc () - start) / (BENCH_OPS * 16);
+  for (i = 0; i < BENCH_OPS * 16; i++)
+    bitmap_reset (b, i * 61);
+
+  start = rdtsc ();
+  for (i = 0; i < BENCH_OPS * 16; i++)
+    ASSERT (bitmap_scan_and_flip_next (b, 1, false) != BITMAP_ERROR);
+  next_cycles = (rdtsc () - start) / (BENCH_OPS * 16);
+  printf ("single-bit allocation: %llu cycles first fit, "
+          "%llu cycles next fit\n", first_cycles, next_cycles);
+
+  bitmap_destroy (b);
+}
+
+/* Bit-by-bit scan, as bitmap_scan() used to do it. */
+static size_t
+ref_scan (const struct bitmap *b, size_t start, size_t cnt, bool value) 
+{
+  size_t i, j;
+
+  for (i = start; i + cnt <= bitmap_size (b); i++) 
+    {
+      for (j = 0; j < cnt; j++)
+        if (bitmap_test (b, i + j) != value)
+          break;
+      if (j == cnt)
+        return i;
+    }
+  return BITMAP_ERROR;
+}
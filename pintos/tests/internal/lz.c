@@ -0,0 +1,131 @@
+/* Test program for lib/kernel/lz.c.
+
+   Compresses and decompresses pages with the kinds of contents
+   zswap sees: incompressible random bytes, all zeros, short
+   repeated patterns, and mixes of these.  Checks that every page
+   comes back unchanged, that a page which does not fit the output
+   buffer is refused rather than truncated, and that a truncated
+   block is rejected.  Prints the compressed size of each kind.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <lz.h>
+#include <random.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/test.h"
+#include "threads/vaddr.h"
+
+/* Room for the worst case: every byte a literal, plus the token
+   and count bytes for them. */
+#define OUT_CAP (PGSIZE + PGSIZE / 255 + 16)
+
+static uint8_t page[PGSIZE];
+static uint8_t out[OUT_CAP];
+static uint8_t back[PGSIZE];
+static uint8_t work[LZ_WORK_SIZE];
+
+static size_t round_trip (const char *name);
+static void fill_pattern (size_t period);
+
+void
+test (void)
+{
+  size_t len, period;
+  int round;
+
+  /* Random bytes: nothing to match, so the block is slightly
+     larger than the page, and a buffer no larger than the page
+     is refused. */
+  random_bytes (page, PGSIZE);
+  len = round_trip ("incompressible");
+  ASSERT (len > PGSIZE);
+  ASSERT (lz_compress (page, PGSIZE, out, PGSIZE, work) == 0);
+  ASSERT (lz_compress (page, PGSIZE, out, PGSIZE * 3 / 4, work) == 0);
+
+  /* All zeros: one long match. */
+  memset (page, 0, PGSIZE);
+  len = round_trip ("all-zero");
+  ASSERT (len < 64);
+
+  /* Repeated patterns, including periods shorter than a match and
+     ones that do not divide the page. */
+  for (period = 1; period <= 257; period = period * 2 + 1)
+    {
+      char name[32];
+
+      fill_pattern (period);
+      snprintf (name, sizeof name, "pattern/%zu", period);
+      len = round_trip (name);
+      ASSERT (len < PGSIZE / 4);
+    }
+
+  /* Mixes: random runs of random length between zeros and
+     patterns, at random offsets. */
+  for (round = 0; round < 100; round++)
+    {
+      size_t ofs = 0;
+
+      fill_pattern (random_ulong () % 64 + 1);
+      while (ofs < PGSIZE)
+        {
+          size_t run = random_ulong () % 512 + 1;
+          if (run > PGSIZE - ofs)
+            run = PGSIZE - ofs;
+          switch (random_ulong () % 3)
+            {
+            case 0:
+              random_bytes (page + ofs, run);
+              break;
+            case 1:
+              memset (page + ofs, 0, run);
+              break;
+            }
+          ofs += run;
+        }
+      round_trip (NULL);
+    }
+  printf ("mixed: 100 pages\n");
+
+  /* A block cut short, or decompressed into the wrong size, is
+     rejected. */
+  fill_pattern (7);
+  len = lz_compress (page, PGSIZE, out, OUT_CAP, work);
+  ASSERT (len > 1);
+  ASSERT (!lz_decompress (out, len - 1, back, PGSIZE));
+  ASSERT (!lz_decompress (out, len, back, PGSIZE - 1));
+
+  printf ("lz: PASS\n");
+}
+
+/* Compresses PAGE, checks that it decompresses to the same bytes,
+   and returns the compressed size.  Prints it under NAME unless
+   NAME is null. */
+static size_t
+round_trip (const char *name)
+{
+  size_t len = lz_compress (page, PGSIZE, out, OUT_CAP, work);
+
+  ASSERT (len > 0);
+  memset (back, 0xcc, PGSIZE);
+  ASSERT (lz_decompress (out, len, back, PGSIZE));
+  ASSERT (!memcmp (page, back, PGSIZE));
+  if (name != NULL)
+    printf ("%s: %zu bytes\n", name, len);
+  return len;
+}
+
+/* Fills PAGE with random bytes repeating every PERIOD bytes. */
+static void
+fill_pattern (size_t period)
+{
+  size_t i;
+
+  random_bytes (page, period);
+  for (i = period; i < PGSIZE; i++)
+    page[i] = page[i - period];
+}
@@ -0,0 +1,97 @@
+/* Puts threads to sleep for durations on both sides of the
+   boundaries between the timer wheel's root level, which has one
+   slot per tick for 256 ticks, and the slots of the next level,
+   which cover 256 ticks each.  Those sleepers are only woken after
+   their slot has been cascaded down to the root, once or twice.
+   Starts them once just after the root wraps and once just before,
+   and checks that every sleeper wakes on its own tick. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Ticks covered by the root level of the timer wheel. */
+#define ROOT_TICKS 256
+
+static const int durations[] = {1, 5, 255, 256, 257, 300,
+                                511, 512, 513, 767, 768, 1000};
+#define SLEEPER_CNT ((int) (sizeof durations / sizeof *durations))
+
+struct sleeper
+  {
+    int duration;               /* Ticks to sleep. */
+    int64_t slept;              /* Ticks actually slept. */
+    struct semaphore *done;     /* Upped when the sleeper wakes. */
+  };
+
+static void run_round (int phase);
+static thread_func sleeper;
+
+void
+test_alarm_cascade (void)
+{
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  msg ("Starting %d sleepers 1 tick after the root wheel wraps.",
+       SLEEPER_CNT);
+  run_round (1);
+  msg ("Starting %d sleepers 6 ticks before the root wheel wraps.",
+       SLEEPER_CNT);
+  run_round (ROOT_TICKS - 6);
+}
+
+/* Waits for a tick whose offset into the root wheel is PHASE,
+   then starts the sleepers and waits for all of them to wake. */
+static void
+run_round (int phase)
+{
+  struct sleeper sleepers[SLEEPER_CNT];
+  struct semaphore done;
+  int i;
+
+  timer_sleep ((phase - timer_ticks () % ROOT_TICKS + ROOT_TICKS)
+               % ROOT_TICKS);
+
+  sema_init (&done, 0);
+  for (i = 0; i < SLEEPER_CNT; i++)
+    {
+      struct sleeper *s = &sleepers[i];
+      char name[16];
+
+      s->duration = durations[i];
+      s->slept = -1;
+      s->done = &done;
+      snprintf (name, sizeof name, "sleeper%d", i);
+
+      /* Higher priority than ours, so that it starts sleeping
+         before we create the next one. */
+      thread_create (name, PRI_DEFAULT + 1, sleeper, s);
+    }
+
+  for (i = 0; i < SLEEPER_CNT; i++)
+    sema_down (&done);
+
+  /* A tick may pass between the sleeper's reading of the tick
+     count and timer_sleep()'s own. */
+  for (i = 0; i < SLEEPER_CNT; i++)
+    if (sleepers[i].slept < sleepers[i].duration
+        || sleepers[i].slept > sleepers[i].duration + 1)
+      fail ("sleeper for %d ticks woke after %lld ticks",
+            sleepers[i].duration, (long long) sleepers[i].slept);
+  msg ("All woke on time.");
+}
+
+static void
+sleeper (void *s_)
+{
+  struct sleeper *s = s_;
+  int64_t start = timer_ticks ();
+
+  timer_sleep (s->duration);
+  s->slept = timer_elapsed (start);
+  sema_up (s->done);
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(alarm-cascade) begin
+(alarm-cascade) Starting 12 sleepers 1 tick after the root wheel wraps.
+(alarm-cascade) All woke on time.
+(alarm-cascade) Starting 12 sleepers 6 ticks before the root wheel wraps.
+(alarm-cascade) All woke on time.
+(alarm-cascade) end
+EOF
+pass;
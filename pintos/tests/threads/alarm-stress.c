@@ -0,0 +1,93 @@
+/* Puts thousands of threads to sleep at once, with wake-up times
+   spread over more than two turns of the timer wheel's root level,
+   and reports the average cost of a timer interrupt for each
+   population.  The cost grows with the threads each tick wakes
+   and with the sleepers each cascade moves down a level, but it
+   must not grow with every sleeper on every tick: the .ck file
+   fails if any population costs more than ten times as much per
+   tick as 10 sleepers, which walking a list of 3000 sleepers on
+   each tick would.  Each sleeper is a thread and needs a page of
+   kernel pool, so the test runs with 64 MB of memory (see
+   Make.tests). */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Longest sleep, in ticks. */
+#define MAX_SLEEP 600
+
+struct sleeper 
+  {
+    int64_t duration;           /* Ticks to sleep. */
+    bool early;                 /* Woke before DURATION elapsed? */
+    struct semaphore *done;     /* Upped when the sleeper wakes. */
+  };
+
+static void stress (int thread_cnt);
+static thread_func sleeper;
+
+void
+test_alarm_stress (void) 
+{
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  stress (10);
+  stress (100);
+  stress (1000);
+  stress (3000);
+}
+
+static void
+stress (int thread_cnt) 
+{
+  struct sleeper *sleepers;
+  struct semaphore done;
+  int i;
+
+  sleepers = malloc (sizeof *sleepers * thread_cnt);
+  if (sleepers == NULL)
+    fail ("couldn't allocate memory for test");
+  sema_init (&done, 0);
+
+  for (i = 0; i < thread_cnt; i++) 
+    {
+      struct sleeper *s = &sleepers[i];
+      char name[16];
+
+      s->duration = 1 + (i * 37) % MAX_SLEEP;
+      s->early = false;
+      s->done = &done;
+      snprintf (name, sizeof name, "sleeper%d", i);
+      if (thread_create (name, PRI_DEFAULT, sleeper, s) == TID_ERROR)
+        fail ("thread_create failed at thread %d", i);
+    }
+
+  /* The sleepers start sleeping once we block below. */
+  timer_reset_intr_cost ();
+  for (i = 0; i < thread_cnt; i++)
+    sema_down (&done);
+  msg ("%d sleepers: %llu cycles per tick.",
+       thread_cnt, (unsigned long long) timer_intr_cost ());
+
+  for (i = 0; i < thread_cnt; i++)
+    if (sleepers[i].early)
+      fail ("sleeper %d woke up early", i);
+  free (sleepers);
+}
+
+static void
+sleeper (void *s_) 
+{
+  struct sleeper *s = s_;
+  int64_t start = timer_ticks ();
+
+  timer_sleep (s->duration);
+  s->early = timer_elapsed (start) < s->duration;
+  sema_up (s->done);
+}
@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+my (@core) = get_core_output ("run", @output);
+my (%cost);
+for my $cnt (10, 100, 1000, 3000) {
+    my ($cycles) = map (/^\(alarm-stress\) $cnt sleepers: (\d+) cycles per tick\.$/, @core);
+    fail "missing timing line for $cnt sleepers\n" if !defined $cycles;
+    $cost{$cnt} = $cycles;
+}
+for my $cnt (100, 1000, 3000) {
+    fail "$cnt sleepers cost $cost{$cnt} cycles per tick, "
+      . "more than 10 times the $cost{10} of 10 sleepers\n"
+      if $cost{$cnt} > $cost{10} * 10;
+}
+pass;
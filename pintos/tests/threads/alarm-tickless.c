@@ -0,0 +1,141 @@
+/* Runs with -tickless.  Sleeps for a series of durations, most
+   of them longer than the 5 ticks one PIT one-shot can cover, so
+   that the idle thread has to chain one-shots.  Meanwhile the
+   CMOS real-time clock interrupts 64 times a second, at times
+   that have nothing to do with the timer tick, so that many
+   one-shots are cut short and timer_idle_exit() has to account
+   for part of a period.  Checks that each sleep ends on time,
+   that timer_ticks() never goes backward, and that the ticks
+   counted over all the sleeps agree with the time the TSC
+   measured.  The TSC is calibrated over a tickless sleep without
+   the RTC, so that both sides include the same latency of
+   chaining one-shots.  Under virtualization late ticks may be
+   delivered in a burst, so a single sleep can measure well off,
+   but over the whole run they must agree to within TSC_SLACK
+   percent. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/io.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+#include "intrinsic.h"
+
+/* Ticks over which TSC cycles per tick are measured. */
+#define CALIBRATE_TICKS 100
+
+/* Percentage by which the ticks counted may differ from the ticks
+   the TSC measured. */
+#define TSC_SLACK 20
+
+/* CMOS RTC registers, and the rate selector for 64 Hz
+   periodic interrupts, 32768 >> (RTC_RATE - 1). */
+#define CMOS_INDEX 0x70
+#define CMOS_DATA 0x71
+#define RTC_REG_A 0x0a
+#define RTC_REG_B 0x0b
+#define RTC_REG_C 0x0c
+#define RTC_B_PIE 0x40
+#define RTC_RATE 10
+
+static const int durations[] = {1, 2, 5, 6, 10, 13, 37, 100};
+
+static volatile int rtc_cnt;
+
+static uint64_t cycles_per_tick (void);
+static void rtc_set_periodic (bool on);
+static intr_handler_func rtc_interrupt;
+
+void
+test_alarm_tickless (void)
+{
+  uint64_t tick_cycles, tsc_total = 0;
+  int64_t last, counted = 0, measured;
+  size_t i;
+
+  ASSERT (timer_tickless);
+
+  tick_cycles = cycles_per_tick ();
+  intr_register_ext (0x28, rtc_interrupt, "RTC");
+  rtc_set_periodic (true);
+
+  last = timer_ticks ();
+  for (i = 0; i < sizeof durations / sizeof *durations; i++)
+    {
+      int d = durations[i];
+      int64_t start, elapsed;
+      uint64_t tsc;
+
+      msg ("Sleeping %d ticks.", d);
+      start = timer_ticks ();
+      if (start < last)
+        fail ("tick count went back from %lld to %lld",
+              (long long) last, (long long) start);
+      tsc = rdtsc ();
+      timer_sleep (d);
+      tsc_total += rdtsc () - tsc;
+      elapsed = timer_elapsed (start);
+      last = start + elapsed;
+      counted += elapsed;
+
+      /* timer_sleep() reads the tick count again, so a tick may
+         pass between our reading and its own. */
+      if (elapsed < d || elapsed > d + 1)
+        fail ("woke after %lld ticks instead of %d", (long long) elapsed, d);
+    }
+
+  rtc_set_periodic (false);
+  if (rtc_cnt == 0)
+    fail ("no RTC interrupts arrived");
+
+  measured = (tsc_total + tick_cycles / 2) / tick_cycles;
+  if (measured * 100 < counted * (100 - TSC_SLACK)
+      || measured * 100 > counted * (100 + TSC_SLACK))
+    fail ("counted %lld ticks while the TSC measured %lld",
+          (long long) counted, (long long) measured);
+  msg ("Tick count kept up with the TSC.");
+}
+
+/* Returns the number of TSC cycles in one timer tick, measured
+   over a sleep that starts on a tick boundary. */
+static uint64_t
+cycles_per_tick (void)
+{
+  uint64_t tsc;
+
+  timer_sleep (1);
+  tsc = rdtsc ();
+  timer_sleep (CALIBRATE_TICKS);
+  return (rdtsc () - tsc) / CALIBRATE_TICKS;
+}
+
+/* Turns the RTC's periodic interrupt on or off. */
+static void
+rtc_set_periodic (bool on)
+{
+  enum intr_level old_level = intr_disable ();
+  uint8_t b;
+
+  outb (CMOS_INDEX, RTC_REG_A);
+  outb (CMOS_DATA, (inb (CMOS_DATA) & 0xf0) | RTC_RATE);
+  outb (CMOS_INDEX, RTC_REG_B);
+  b = inb (CMOS_DATA);
+  outb (CMOS_INDEX, RTC_REG_B);
+  outb (CMOS_DATA, on ? b | RTC_B_PIE : b & ~RTC_B_PIE);
+
+  /* Reading register C acknowledges any pending interrupt. */
+  outb (CMOS_INDEX, RTC_REG_C);
+  inb (CMOS_DATA);
+  intr_set_level (old_level);
+}
+
+/* RTC interrupt handler. */
+static void
+rtc_interrupt (struct intr_frame *f UNUSED)
+{
+  outb (CMOS_INDEX, RTC_REG_C);
+  inb (CMOS_DATA);
+  rtc_cnt++;
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(alarm-tickless) begin
+(alarm-tickless) Sleeping 1 ticks.
+(alarm-tickless) Sleeping 2 ticks.
+(alarm-tickless) Sleeping 5 ticks.
+(alarm-tickless) Sleeping 6 ticks.
+(alarm-tickless) Sleeping 10 ticks.
+(alarm-tickless) Sleeping 13 ticks.
+(alarm-tickless) Sleeping 37 ticks.
+(alarm-tickless) Sleeping 100 ticks.
+(alarm-tickless) Tick count kept up with the TSC.
+(alarm-tickless) end
+EOF
+pass;
@@ -0,0 +1,100 @@
+/* A low-priority thread acquires and releases a lock in a tight
+   loop, while a high-priority thread wakes up on every timer tick
+   and preempts it wherever it happens to be, often in the middle
+   of lock_acquire() or lock_release().  Each time, the
+   high-priority thread checks that a taken lock names the hammer
+   as its holder: a contender that found no holder would have
+   nobody to donate its priority to.  Then, if the lock is taken,
+   it contends for it, and checks that the holder's priority is
+   back to normal once the lock is handed over. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Number of timer ticks the checker wakes up on. */
+#define WAKE_CNT 300
+
+struct race
+  {
+    struct lock lock;             /* Lock being raced for. */
+    struct semaphore done;        /* Upped by each thread at exit. */
+    volatile bool stop;           /* Tells the hammer to stop. */
+  };
+
+static thread_func hammer_thread;
+static thread_func checker_thread;
+
+void
+test_lock_holder_preempt (void)
+{
+  struct race r;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  lock_init (&r.lock);
+  sema_init (&r.done, 0);
+  r.stop = false;
+
+  thread_create ("hammer", PRI_DEFAULT - 1, hammer_thread, &r);
+  thread_create ("checker", PRI_DEFAULT + 10, checker_thread, &r);
+  sema_down (&r.done);
+  sema_down (&r.done);
+  msg ("Both threads finished.");
+
+  if (!lock_try_acquire (&r.lock))
+    fail ("lock is not free at the end");
+  lock_release (&r.lock);
+}
+
+static void
+hammer_thread (void *r_)
+{
+  struct race *r = r_;
+
+  while (!r->stop)
+    {
+      lock_acquire (&r->lock);
+      lock_release (&r->lock);
+    }
+  sema_up (&r->done);
+}
+
+static void
+checker_thread (void *r_)
+{
+  struct race *r = r_;
+  int i;
+
+  msg ("Checker preempting the hammer %d times.", WAKE_CNT);
+  for (i = 0; i < WAKE_CNT; i++)
+    {
+      struct thread *holder;
+
+      timer_sleep (1);
+
+      /* We preempted the hammer.  It cannot run again until we
+         block, so the lock's state is frozen. */
+      holder = lock_holder (&r->lock);
+      if (holder == NULL)
+        continue;
+      if (strcmp (holder->name, "hammer"))
+        fail ("lock held by \"%s\" after %d wakeups", holder->name, i);
+
+      /* Contend.  The hammer must run at our priority until it
+         lets go. */
+      lock_acquire (&r->lock);
+      lock_release (&r->lock);
+      if (holder->priority != PRI_DEFAULT - 1)
+        fail ("hammer kept priority %d after releasing",
+              holder->priority);
+    }
+  r->stop = true;
+  msg ("Checker done.");
+  sema_up (&r->done);
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(lock-holder-preempt) begin
+(lock-holder-preempt) Checker preempting the hammer 300 times.
+(lock-holder-preempt) Checker done.
+(lock-holder-preempt) Both threads finished.
+(lock-holder-preempt) end
+EOF
+pass;
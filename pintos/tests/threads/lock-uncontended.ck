@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+my (@core) = get_core_output ("run", @output);
+fail "missing lock timing line\n"
+  if !grep (/^\(lock-uncontended\) lock: \d+ acquire\/release pairs per second\.$/, @core);
+fail "missing semaphore timing line\n"
+  if !grep (/^\(lock-uncontended\) semaphore: \d+ down\/up pairs per second\.$/, @core);
+pass;
@@ -0,0 +1,69 @@
+/* Checks malloc() for blocks too big for its descriptors, which
+   come from the vmalloc region.  Allocates blocks of many sizes
+   between 1 kB and 64 kB, fills each with its own pattern and
+   checks that no block overwrote another.  Then frees every
+   other block, grows the rest with realloc(), and checks that
+   their contents survived. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/malloc.h"
+#include "threads/vmalloc.h"
+
+/* Number of blocks. */
+#define BLOCK_CNT 64
+
+static uint8_t *blocks[BLOCK_CNT];
+static size_t sizes[BLOCK_CNT];
+
+static void
+check_block (int i, size_t size) 
+{
+  size_t j;
+
+  for (j = 0; j < size; j++)
+    if (blocks[i][j] != (uint8_t) (i + j))
+      fail ("block %d of %zu bytes corrupted at byte %zu", i, size, j);
+}
+
+void
+test_malloc_large (void) 
+{
+  int i;
+
+  for (i = 0; i < BLOCK_CNT; i++) 
+    {
+      size_t j;
+
+      sizes[i] = 1025 + (size_t) i * i * 16;
+      blocks[i] = malloc (sizes[i]);
+      if (blocks[i] == NULL)
+        fail ("malloc of %zu bytes failed", sizes[i]);
+      if (!is_vmalloc_vaddr (blocks[i]))
+        fail ("block of %zu bytes at %p is not in the vmalloc region",
+              sizes[i], blocks[i]);
+      for (j = 0; j < sizes[i]; j++)
+        blocks[i][j] = i + j;
+    }
+  for (i = 0; i < BLOCK_CNT; i++)
+    check_block (i, sizes[i]);
+  msg ("%d blocks of 1 to 64 kB do not overlap.", BLOCK_CNT);
+
+  for (i = 0; i < BLOCK_CNT; i += 2)
+    free (blocks[i]);
+  for (i = 1; i < BLOCK_CNT; i += 2) 
+    {
+      blocks[i] = realloc (blocks[i], sizes[i] * 2);
+      if (blocks[i] == NULL)
+        fail ("realloc to %zu bytes failed", sizes[i] * 2);
+      memset (blocks[i] + sizes[i], 0, sizes[i]);
+    }
+  for (i = 1; i < BLOCK_CNT; i += 2)
+    check_block (i, sizes[i]);
+  msg ("Grown blocks kept their contents.");
+
+  for (i = 1; i < BLOCK_CNT; i += 2)
+    free (blocks[i]);
+}
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(malloc-large) begin
+(malloc-large) 64 blocks of 1 to 64 kB do not overlap.
+(malloc-large) Grown blocks kept their contents.
+(malloc-large) end
+EOF
+pass;
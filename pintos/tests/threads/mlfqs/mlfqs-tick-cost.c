@@ -0,0 +1,83 @@
+/* Blocks 10, 100, and then 1000 threads on a semaphore and
+   measures the average cost of a timer interrupt while the main
+   thread spins for a few seconds.  The once-a-second MLFQS update
+   in the timer interrupt walks only the ready threads; a blocked
+   thread's recent_cpu and priority catch up when it is woken, so
+   the cost should not grow with the number of blocked threads.
+   The .ck file fails if 100 or 1000 blocked threads cost half as
+   much again per tick as 10 do. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Seconds to spin while measuring. */
+#define SPIN_SECONDS 3
+
+struct tick_cost_info 
+  {
+    struct semaphore started;   /* Upped by each thread as it starts. */
+    struct semaphore go;        /* Blocks threads during the measurement. */
+    struct semaphore done;      /* Upped by each thread as it exits. */
+  };
+
+static void measure (int thread_cnt);
+static thread_func blocked_thread;
+
+void
+test_mlfqs_tick_cost (void) 
+{
+  ASSERT (thread_mlfqs);
+
+  measure (10);
+  measure (100);
+  measure (1000);
+}
+
+static void
+measure (int thread_cnt) 
+{
+  struct tick_cost_info info;
+  int64_t start;
+  int i;
+
+  sema_init (&info.started, 0);
+  sema_init (&info.go, 0);
+  sema_init (&info.done, 0);
+
+  for (i = 0; i < thread_cnt; i++) 
+    {
+      char name[16];
+      snprintf (name, sizeof name, "blk%d", i);
+      if (thread_create (name, PRI_DEFAULT, blocked_thread, &info) == TID_ERROR)
+        fail ("thread_create failed at thread %d", i);
+    }
+  for (i = 0; i < thread_cnt; i++)
+    sema_down (&info.started);
+
+  timer_reset_intr_cost ();
+  start = timer_ticks ();
+  while (timer_elapsed (start) < SPIN_SECONDS * TIMER_FREQ)
+    continue;
+  msg ("%d blocked threads: %llu cycles per tick.",
+       thread_cnt, (unsigned long long) timer_intr_cost ());
+
+  for (i = 0; i < thread_cnt; i++)
+    sema_up (&info.go);
+  for (i = 0; i < thread_cnt; i++)
+    sema_down (&info.done);
+}
+
+static void
+blocked_thread (void *info_) 
+{
+  struct tick_cost_info *info = info_;
+
+  sema_up (&info->started);
+  sema_down (&info->go);
+  sema_up (&info->done);
+}
@@ -0,0 +1,82 @@
+/* Checks that a semaphore wakes its waiters in the order of their
+   current priorities, not the ones they had when they blocked.
+
+   Thread A spins for most of a second, so that it blocks on the
+   semaphore with a high recent_cpu and a low priority.  Thread B
+   sets its nice value to 5 and blocks on the semaphore at once,
+   with a priority that stays in the low 50s.  While both wait,
+   A's recent_cpu decays toward 0 and its priority rises above
+   B's.  When the main thread ups the semaphore, one waiter at a
+   time, A must wake first. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Ticks thread A spins before blocking. */
+#define SPIN_TICKS 90
+
+struct wake_info
+  {
+    struct semaphore sema;      /* Both threads wait on this. */
+    struct semaphore done;      /* Upped by each thread once awake. */
+  };
+
+static thread_func a_thread;
+static thread_func b_thread;
+
+void
+test_mlfqs_wake_order (void)
+{
+  struct wake_info info;
+
+  ASSERT (thread_mlfqs);
+
+  sema_init (&info.sema, 0);
+  sema_init (&info.done, 0);
+
+  msg ("Main thread creating threads A and B, sleeping 4 seconds...");
+  thread_create ("A", PRI_DEFAULT, a_thread, &info);
+  thread_create ("B", PRI_DEFAULT, b_thread, &info);
+  timer_sleep (4 * TIMER_FREQ);
+
+  msg ("Main thread waking one waiter.");
+  sema_up (&info.sema);
+  sema_down (&info.done);
+  msg ("Main thread waking the other waiter.");
+  sema_up (&info.sema);
+  sema_down (&info.done);
+}
+
+static void
+a_thread (void *info_)
+{
+  struct wake_info *info = info_;
+  int64_t start = timer_ticks ();
+
+  /* Start spinning right after a once-per-second recent_cpu
+     decay, so that the next one does not catch us spinning. */
+  while (timer_ticks () / TIMER_FREQ == start / TIMER_FREQ)
+    continue;
+  start = timer_ticks ();
+  while (timer_elapsed (start) < SPIN_TICKS)
+    continue;
+
+  sema_down (&info->sema);
+  msg ("Thread A woke up.");
+  sema_up (&info->done);
+}
+
+static void
+b_thread (void *info_)
+{
+  struct wake_info *info = info_;
+
+  thread_set_nice (5);
+  sema_down (&info->sema);
+  msg ("Thread B woke up.");
+  sema_up (&info->done);
+}
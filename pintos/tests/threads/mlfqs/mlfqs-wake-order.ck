@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(mlfqs-wake-order) begin
+(mlfqs-wake-order) Main thread creating threads A and B, sleeping 4 seconds...
+(mlfqs-wake-order) Main thread waking one waiter.
+(mlfqs-wake-order) Thread A woke up.
+(mlfqs-wake-order) Main thread waking the other waiter.
+(mlfqs-wake-order) Thread B woke up.
+(mlfqs-wake-order) end
+EOF
+pass;
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+my (@core) = get_core_output ("run", @output);
+fail "missing single-page timing line\n"
+  if !grep (/^\(palloc-bench-2gb\) single pages: \d+ get\/free pairs per second\.$/, @core);
+fail "missing mixed-size timing line\n"
+  if !grep (/^\(palloc-bench-2gb\) mixed sizes: \d+ pages per second\.$/, @core);
+fail "missing fill timing line\n"
+  if !grep (/^\(palloc-bench-2gb\) fill: \d+ pages in \d+ ms\.$/, @core);
+pass;
@@ -0,0 +1,94 @@
+/* Measures page allocator throughput with 256 MB and 2 GB of
+   guest memory.  Reports single-page get/free pairs per second,
+   pages per second for blocks of mixed sizes, and how long it
+   takes to allocate the whole user pool one page at a time and
+   free it again.  With a buddy allocator none of these should
+   depend much on the size of the pool. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/palloc.h"
+#include "devices/timer.h"
+
+/* Number of operations between checks of the clock. */
+#define BATCH 256
+
+/* Number of blocks held at once in the mixed-size run. */
+#define MIXED_CNT 64
+
+static void measure_palloc (void);
+
+void
+test_palloc_bench_256mb (void) 
+{
+  measure_palloc ();
+}
+
+void
+test_palloc_bench_2gb (void) 
+{
+  measure_palloc ();
+}
+
+static void
+measure_palloc (void) 
+{
+  static void *mixed[MIXED_CNT];
+  long long pairs, pages;
+  size_t fill_cnt;
+  void **list;
+  int64_t start;
+  int i;
+
+  pairs = 0;
+  start = timer_ticks ();
+  while (timer_elapsed (start) < TIMER_FREQ) 
+    {
+      for (i = 0; i < BATCH; i++)
+        palloc_free_page (palloc_get_page (PAL_USER | PAL_ASSERT));
+      pairs += BATCH;
+    }
+  msg ("single pages: %lld get/free pairs per second.", pairs);
+
+  /* Blocks of 1, 2, 3, ..., 8 pages, freed in a different order
+     than they were allocated. */
+  pages = 0;
+  start = timer_ticks ();
+  while (timer_elapsed (start) < TIMER_FREQ) 
+    {
+      for (i = 0; i < MIXED_CNT; i++) 
+        {
+          mixed[i] = palloc_get_multiple (PAL_USER | PAL_ASSERT, i % 8 + 1);
+          pages += i % 8 + 1;
+        }
+      for (i = 0; i < MIXED_CNT; i++) 
+        {
+          int j = (i * 7) % MIXED_CNT;
+          palloc_free_multiple (mixed[j], j % 8 + 1);
+        }
+    }
+  msg ("mixed sizes: %lld pages per second.", pages);
+
+  /* Chain every page of the user pool through its first word. */
+  list = NULL;
+  fill_cnt = 0;
+  start = timer_ticks ();
+  for (;;) 
+    {
+      void **page = palloc_get_page (PAL_USER);
+      if (page == NULL)
+        break;
+      *page = list;
+      list = page;
+      fill_cnt++;
+    }
+  while (list != NULL) 
+    {
+      void **next = *list;
+      palloc_free_page (list);
+      list = next;
+    }
+  msg ("fill: %zu pages in %lld ms.", fill_cnt,
+       (long long) timer_elapsed (start) * 1000 / TIMER_FREQ);
+}
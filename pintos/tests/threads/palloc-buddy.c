@@ -0,0 +1,119 @@
+/* Checks the buddy page allocator.  Blocks of 1 to 7 pages are
+   allocated from the user pool until it runs out and must not
+   overlap.  Every other block is freed and the pool refilled,
+   then everything is freed, after which the free pages must have
+   coalesced again so that a large block can be allocated. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* Size of the large block, in pages. */
+#define BIG_PAGES 256
+
+/* Maximum number of blocks held at once. */
+#define BLOCK_MAX 4096
+
+struct block 
+  {
+    uint8_t *pages;             /* First page, or NULL. */
+    size_t page_cnt;            /* Number of pages. */
+  };
+
+static struct block blocks[BLOCK_MAX];
+
+static void fill (void);
+static void check (void);
+static void release (int step);
+
+void
+test_palloc_buddy (void) 
+{
+  void *big;
+
+  big = palloc_get_multiple (PAL_USER, BIG_PAGES);
+  if (big == NULL)
+    fail ("could not allocate %d pages", BIG_PAGES);
+  palloc_free_multiple (big, BIG_PAGES);
+  msg ("%d-page block allocated.", BIG_PAGES);
+
+  fill ();
+  check ();
+  msg ("Blocks of 1 to 7 pages fill the user pool without overlap.");
+
+  release (2);
+  fill ();
+  check ();
+  msg ("Refilled holes without overlap.");
+
+  release (1);
+  big = palloc_get_multiple (PAL_USER, BIG_PAGES);
+  if (big == NULL)
+    fail ("could not allocate %d pages after freeing everything",
+          BIG_PAGES);
+  palloc_free_multiple (big, BIG_PAGES);
+  msg ("%d-page block allocated after freeing everything.", BIG_PAGES);
+}
+
+/* Allocates blocks into the empty slots of BLOCKS until the user
+   pool runs out, stamping each page with its block's index. */
+static void
+fill (void) 
+{
+  int i;
+
+  for (i = 0; i < BLOCK_MAX; i++) 
+    {
+      struct block *b = &blocks[i];
+      size_t j;
+
+      if (b->pages != NULL)
+        continue;
+      b->page_cnt = i % 7 + 1;
+      b->pages = palloc_get_multiple (PAL_USER, b->page_cnt);
+      if (b->pages == NULL)
+        return;
+      for (j = 0; j < b->page_cnt; j++)
+        *(int *) (b->pages + j * PGSIZE) = i;
+    }
+  fail ("user pool did not run out after %d blocks", BLOCK_MAX);
+}
+
+/* Checks that no block's pages were overwritten by another's. */
+static void
+check (void) 
+{
+  int i;
+
+  for (i = 0; i < BLOCK_MAX; i++) 
+    {
+      struct block *b = &blocks[i];
+      size_t j;
+
+      if (b->pages == NULL)
+        continue;
+      for (j = 0; j < b->page_cnt; j++)
+        if (*(int *) (b->pages + j * PGSIZE) != i)
+          fail ("page %zu of block %d overlaps another block", j, i);
+    }
+}
+
+/* Frees every STEP'th block. */
+static void
+release (int step) 
+{
+  int i;
+
+  for (i = 0; i < BLOCK_MAX; i += step) 
+    {
+      struct block *b = &blocks[i];
+
+      if (b->pages != NULL) 
+        {
+          palloc_free_multiple (b->pages, b->page_cnt);
+          b->pages = NULL;
+        }
+    }
+}
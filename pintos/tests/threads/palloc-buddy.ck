@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(palloc-buddy) begin
+(palloc-buddy) 256-page block allocated.
+(palloc-buddy) Blocks of 1 to 7 pages fill the user pool without overlap.
+(palloc-buddy) Refilled holes without overlap.
+(palloc-buddy) 256-page block allocated after freeing everything.
+(palloc-buddy) end
+EOF
+pass;
@@ -0,0 +1,78 @@
+/* The main thread sets its priority to PRI_MIN and acquires lock
+   0.  It then creates CHAIN_LENGTH threads, thread i having
+   priority PRI_MIN + i.  Thread i acquires lock i, then blocks on
+   lock i - 1, which is held by thread i - 1 (or the main thread),
+   so each new thread's priority must be donated down the whole
+   chain of CHAIN_LENGTH threads, well past the depth of 8 that
+   the original Pintos assignment asks for.
+
+   When the main thread releases lock 0, each thread in turn gets
+   its lock while still donated the priority of the last thread,
+   hands the chain on, and finishes at its own priority. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+#define CHAIN_LENGTH 16
+
+struct lock_pair
+  {
+    struct lock *first;         /* Acquired first, NULL for the last. */
+    struct lock *second;        /* Held by the previous thread. */
+  };
+
+static thread_func chain_thread_func;
+
+void
+test_priority_donate_deep (void) 
+{
+  struct lock locks[CHAIN_LENGTH];
+  struct lock_pair lock_pairs[CHAIN_LENGTH + 1];
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  thread_set_priority (PRI_MIN);
+
+  for (i = 0; i < CHAIN_LENGTH; i++)
+    lock_init (&locks[i]);
+  lock_acquire (&locks[0]);
+
+  for (i = 1; i <= CHAIN_LENGTH; i++)
+    {
+      char name[16];
+
+      snprintf (name, sizeof name, "thread %d", i);
+      lock_pairs[i].first = i < CHAIN_LENGTH ? &locks[i] : NULL;
+      lock_pairs[i].second = &locks[i - 1];
+      thread_create (name, PRI_MIN + i, chain_thread_func, &lock_pairs[i]);
+      msg ("%s should have priority %d.  Actual priority: %d.",
+           thread_name (), PRI_MIN + i, thread_get_priority ());
+    }
+
+  lock_release (&locks[0]);
+  msg ("%s finishing with priority %d.", thread_name (),
+       thread_get_priority ());
+}
+
+static void
+chain_thread_func (void *lock_pair_) 
+{
+  struct lock_pair *lock_pair = lock_pair_;
+
+  if (lock_pair->first != NULL)
+    lock_acquire (lock_pair->first);
+  lock_acquire (lock_pair->second);
+  msg ("%s got lock with priority %d.", thread_name (),
+       thread_get_priority ());
+
+  lock_release (lock_pair->second);
+  if (lock_pair->first != NULL)
+    lock_release (lock_pair->first);
+  msg ("%s finishing with priority %d.", thread_name (),
+       thread_get_priority ());
+}
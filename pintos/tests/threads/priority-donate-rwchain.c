@@ -0,0 +1,91 @@
+/* Donation passes through an rwlock in the middle of a chain of
+   locks.  The main thread holds lock A.  A reader of rwlock R
+   waits for lock A, a writer holding lock B waits for R, and a
+   high-priority thread waits for lock B.  Each new waiter's
+   priority must reach the main thread at the end of the chain,
+   including the last one, whose donation has to cross R. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+struct chain_data 
+  {
+    struct lock a;
+    struct rwlock r;
+    struct lock b;
+  };
+
+static thread_func reader_thread_func;
+static thread_func writer_thread_func;
+static thread_func high_thread_func;
+
+void
+test_priority_donate_rwchain (void) 
+{
+  struct chain_data data;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  lock_init (&data.a);
+  rwlock_init (&data.r);
+  lock_init (&data.b);
+  lock_acquire (&data.a);
+
+  thread_create ("reader", PRI_DEFAULT + 1, reader_thread_func, &data);
+  msg ("Main thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 1, thread_get_priority ());
+  thread_create ("writer", PRI_DEFAULT + 2, writer_thread_func, &data);
+  msg ("Main thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 2, thread_get_priority ());
+  thread_create ("high", PRI_DEFAULT + 4, high_thread_func, &data);
+  msg ("Main thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 4, thread_get_priority ());
+
+  lock_release (&data.a);
+  msg ("Main thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT, thread_get_priority ());
+}
+
+static void
+reader_thread_func (void *data_) 
+{
+  struct chain_data *data = data_;
+
+  rwlock_acquire_read (&data->r);
+  lock_acquire (&data->a);
+  msg ("reader: got lock A with priority %d", thread_get_priority ());
+  lock_release (&data->a);
+  rwlock_release_read (&data->r);
+  msg ("reader: done");
+}
+
+static void
+writer_thread_func (void *data_) 
+{
+  struct chain_data *data = data_;
+
+  lock_acquire (&data->b);
+  rwlock_acquire_write (&data->r);
+  msg ("writer: got write access with priority %d", thread_get_priority ());
+  rwlock_release_write (&data->r);
+  lock_release (&data->b);
+  msg ("writer: done");
+}
+
+static void
+high_thread_func (void *data_) 
+{
+  struct chain_data *data = data_;
+
+  lock_acquire (&data->b);
+  msg ("high: got lock B");
+  lock_release (&data->b);
+  msg ("high: done");
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(priority-donate-rwchain) begin
+(priority-donate-rwchain) Main thread should have priority 32.  Actual priority: 32.
+(priority-donate-rwchain) Main thread should have priority 33.  Actual priority: 33.
+(priority-donate-rwchain) Main thread should have priority 35.  Actual priority: 35.
+(priority-donate-rwchain) reader: got lock A with priority 35
+(priority-donate-rwchain) writer: got write access with priority 35
+(priority-donate-rwchain) high: got lock B
+(priority-donate-rwchain) high: done
+(priority-donate-rwchain) writer: done
+(priority-donate-rwchain) reader: done
+(priority-donate-rwchain) Main thread should have priority 31.  Actual priority: 31.
+(priority-donate-rwchain) end
+EOF
+pass;
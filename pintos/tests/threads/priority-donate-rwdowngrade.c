@@ -0,0 +1,49 @@
+/* The main thread holds an rwlock for writing while a
+   higher-priority reader waits for it, donating its priority.
+   When the main thread downgrades to read access, the reader
+   joins it as a reader and no longer donates anything, so the
+   main thread must drop back to its own priority right away and
+   let the reader run. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func reader_thread_func;
+
+void
+test_priority_donate_rwdowngrade (void)
+{
+  struct rwlock rwlock;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rwlock_init (&rwlock);
+  rwlock_acquire_write (&rwlock);
+  thread_create ("reader", PRI_DEFAULT + 5, reader_thread_func, &rwlock);
+  msg ("Main thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 5, thread_get_priority ());
+
+  rwlock_downgrade (&rwlock);
+  msg ("Main thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT, thread_get_priority ());
+  rwlock_release_read (&rwlock);
+  msg ("Main thread done.");
+}
+
+static void
+reader_thread_func (void *rwlock_)
+{
+  struct rwlock *rwlock = rwlock_;
+
+  rwlock_acquire_read (rwlock);
+  msg ("reader: got read access with priority %d", thread_get_priority ());
+  rwlock_release_read (rwlock);
+  msg ("reader: done");
+}
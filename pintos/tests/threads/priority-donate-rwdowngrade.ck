@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(priority-donate-rwdowngrade) begin
+(priority-donate-rwdowngrade) Main thread should have priority 36.  Actual priority: 36.
+(priority-donate-rwdowngrade) reader: got read access with priority 36
+(priority-donate-rwdowngrade) reader: done
+(priority-donate-rwdowngrade) Main thread should have priority 31.  Actual priority: 31.
+(priority-donate-rwdowngrade) Main thread done.
+(priority-donate-rwdowngrade) end
+EOF
+pass;
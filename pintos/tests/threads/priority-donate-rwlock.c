@@ -0,0 +1,96 @@
+/* The main thread and a higher-priority reader both hold an
+   rwlock for reading.  A writer then blocks on it, donating its
+   priority to both readers, and a still higher-priority reader
+   queues up behind the writer instead of joining the readers,
+   donating its priority to them as well.  Once the readers leave,
+   the writer gets the rwlock and inherits the waiting reader's
+   priority until it releases it.  Finally, the main thread
+   upgrades and downgrades an uncontended rwlock. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+struct rwlock_data 
+  {
+    struct rwlock rwlock;
+    struct semaphore sema;
+  };
+
+static thread_func reader1_thread_func;
+static thread_func reader2_thread_func;
+static thread_func writer_thread_func;
+
+void
+test_priority_donate_rwlock (void) 
+{
+  struct rwlock_data data;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rwlock_init (&data.rwlock);
+  sema_init (&data.sema, 0);
+  rwlock_acquire_read (&data.rwlock);
+
+  thread_create ("reader1", PRI_DEFAULT + 1, reader1_thread_func, &data);
+  thread_create ("writer", PRI_DEFAULT + 3, writer_thread_func, &data);
+  msg ("Main thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 3, thread_get_priority ());
+  thread_create ("reader2", PRI_DEFAULT + 5, reader2_thread_func, &data);
+  msg ("Main thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 5, thread_get_priority ());
+
+  rwlock_release_read (&data.rwlock);
+  msg ("Main thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT, thread_get_priority ());
+
+  sema_up (&data.sema);
+  msg ("Readers and writer must already have finished.");
+
+  rwlock_acquire_read (&data.rwlock);
+  if (!rwlock_upgrade (&data.rwlock))
+    fail ("upgrade of sole reader failed");
+  rwlock_downgrade (&data.rwlock);
+  rwlock_release_read (&data.rwlock);
+  msg ("Upgrade and downgrade done.");
+}
+
+static void
+reader1_thread_func (void *data_) 
+{
+  struct rwlock_data *data = data_;
+
+  rwlock_acquire_read (&data->rwlock);
+  msg ("reader1: got read access");
+  sema_down (&data->sema);
+  rwlock_release_read (&data->rwlock);
+  msg ("reader1: done");
+}
+
+static void
+reader2_thread_func (void *data_) 
+{
+  struct rwlock_data *data = data_;
+
+  rwlock_acquire_read (&data->rwlock);
+  msg ("reader2: got read access");
+  rwlock_release_read (&data->rwlock);
+  msg ("reader2: done");
+}
+
+static void
+writer_thread_func (void *data_) 
+{
+  struct rwlock_data *data = data_;
+
+  rwlock_acquire_write (&data->rwlock);
+  msg ("writer: got write access with priority %d", thread_get_priority ());
+  rwlock_release_write (&data->rwlock);
+  msg ("writer: done");
+}
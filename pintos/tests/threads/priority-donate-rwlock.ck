@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(priority-donate-rwlock) begin
+(priority-donate-rwlock) reader1: got read access
+(priority-donate-rwlock) Main thread should have priority 34.  Actual priority: 34.
+(priority-donate-rwlock) Main thread should have priority 36.  Actual priority: 36.
+(priority-donate-rwlock) Main thread should have priority 31.  Actual priority: 31.
+(priority-donate-rwlock) writer: got write access with priority 36
+(priority-donate-rwlock) reader2: got read access
+(priority-donate-rwlock) reader2: done
+(priority-donate-rwlock) writer: done
+(priority-donate-rwlock) reader1: done
+(priority-donate-rwlock) Readers and writer must already have finished.
+(priority-donate-rwlock) Upgrade and downgrade done.
+(priority-donate-rwlock) end
+EOF
+pass;
@@ -0,0 +1,122 @@
+/* A low-priority thread holding a lock blocks on a semaphore
+   behind two medium-priority threads.  A high-priority thread
+   then blocks on the lock, donating its priority to the waiting
+   lock holder, which must move ahead of the others and be the
+   first to wake up.  The same is then checked for a thread
+   waiting on a condition variable. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+struct waiter_data 
+  {
+    struct lock lock;           /* Held by the low-priority waiter. */
+    struct semaphore sema;      /* Waited on in the first part. */
+    struct lock mutex;          /* Protects COND. */
+    struct condition cond;      /* Waited on in the second part. */
+  };
+
+static thread_func sema_holder_func;
+static thread_func sema_waiter_func;
+static thread_func cond_holder_func;
+static thread_func cond_waiter_func;
+static thread_func donor_func;
+
+void
+test_priority_donate_waiter (void) 
+{
+  struct waiter_data data;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  lock_init (&data.lock);
+  sema_init (&data.sema, 0);
+  lock_init (&data.mutex);
+  cond_init (&data.cond);
+
+  thread_create ("sema-holder", PRI_DEFAULT + 1, sema_holder_func, &data);
+  thread_create ("sema-a", PRI_DEFAULT + 3, sema_waiter_func, &data);
+  thread_create ("sema-b", PRI_DEFAULT + 4, sema_waiter_func, &data);
+  thread_create ("sema-donor", PRI_DEFAULT + 9, donor_func, &data);
+  for (i = 0; i < 3; i++) 
+    {
+      msg ("Upping semaphore.");
+      sema_up (&data.sema);
+    }
+
+  thread_create ("cond-holder", PRI_DEFAULT + 1, cond_holder_func, &data);
+  thread_create ("cond-a", PRI_DEFAULT + 3, cond_waiter_func, &data);
+  thread_create ("cond-b", PRI_DEFAULT + 4, cond_waiter_func, &data);
+  thread_create ("cond-donor", PRI_DEFAULT + 9, donor_func, &data);
+  for (i = 0; i < 3; i++) 
+    {
+      lock_acquire (&data.mutex);
+      msg ("Signaling condition.");
+      cond_signal (&data.cond, &data.mutex);
+      lock_release (&data.mutex);
+    }
+}
+
+static void
+sema_holder_func (void *data_) 
+{
+  struct waiter_data *data = data_;
+
+  lock_acquire (&data->lock);
+  sema_down (&data->sema);
+  msg ("%s woke up with priority %d.", thread_name (), thread_get_priority ());
+  lock_release (&data->lock);
+  msg ("%s done.", thread_name ());
+}
+
+static void
+sema_waiter_func (void *data_) 
+{
+  struct waiter_data *data = data_;
+
+  sema_down (&data->sema);
+  msg ("%s woke up.", thread_name ());
+}
+
+static void
+cond_holder_func (void *data_) 
+{
+  struct waiter_data *data = data_;
+
+  lock_acquire (&data->lock);
+  lock_acquire (&data->mutex);
+  cond_wait (&data->cond, &data->mutex);
+  msg ("%s woke up with priority %d.", thread_name (), thread_get_priority ());
+  lock_release (&data->mutex);
+  lock_release (&data->lock);
+  msg ("%s done.", thread_name ());
+}
+
+static void
+cond_waiter_func (void *data_) 
+{
+  struct waiter_data *data = data_;
+
+  lock_acquire (&data->mutex);
+  cond_wait (&data->cond, &data->mutex);
+  msg ("%s woke up.", thread_name ());
+  lock_release (&data->mutex);
+}
+
+static void
+donor_func (void *data_) 
+{
+  struct waiter_data *data = data_;
+
+  lock_acquire (&data->lock);
+  msg ("%s got the lock.", thread_name ());
+  lock_release (&data->lock);
+}
@@ -0,0 +1,25 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(priority-donate-waiter) begin
+(priority-donate-waiter) Upping semaphore.
+(priority-donate-waiter) sema-holder woke up with priority 40.
+(priority-donate-waiter) sema-donor got the lock.
+(priority-donate-waiter) sema-holder done.
+(priority-donate-waiter) Upping semaphore.
+(priority-donate-waiter) sema-b woke up.
+(priority-donate-waiter) Upping semaphore.
+(priority-donate-waiter) sema-a woke up.
+(priority-donate-waiter) Signaling condition.
+(priority-donate-waiter) cond-holder woke up with priority 40.
+(priority-donate-waiter) cond-donor got the lock.
+(priority-donate-waiter) cond-holder done.
+(priority-donate-waiter) Signaling condition.
+(priority-donate-waiter) cond-b woke up.
+(priority-donate-waiter) Signaling condition.
+(priority-donate-waiter) cond-a woke up.
+(priority-donate-waiter) end
+EOF
+pass;
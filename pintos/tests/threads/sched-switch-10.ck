@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+my (@core) = get_core_output ("run", @output);
+fail "missing timing line\n"
+  if !grep (/^\(sched-switch-10\) 10 threads: \d+ switches, \d+ cycles per switch\.$/, @core);
+pass;
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+my (@core) = get_core_output ("run", @output);
+my (%cost);
+for my $cnt (10, 100) {
+    my ($cycles) = map (/^\(sched-switch-100\) $cnt threads: \d+ switches, (\d+) cycles per switch\.$/, @core);
+    fail "missing timing line for $cnt threads\n" if !defined $cycles;
+    $cost{$cnt} = $cycles;
+}
+fail "100 threads cost $cost{100} cycles per switch, "
+  . "more than twice the $cost{10} of 10\n"
+  if $cost{100} > $cost{10} * 2;
+pass;
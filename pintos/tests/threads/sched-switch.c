@@ -0,0 +1,89 @@
+/* Measures context-switch latency with 10, 100, and 1000 ready
+   threads at the same priority.  Each thread yields ITER_CNT
+   times, so every yield picks the next thread from a run queue
+   holding THREAD_CNT entries.  With a constant-time run queue the
+   cycles per switch should not grow with THREAD_CNT, so the 100-
+   and 1000-thread tests first take the 10-thread cost in the same
+   boot and their .ck files compare the two. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "intrinsic.h"
+
+#define ITER_CNT 100
+
+static void measure_switch (int thread_cnt);
+static thread_func yield_thread;
+
+void
+test_sched_switch_10 (void) 
+{
+  measure_switch (10);
+}
+
+void
+test_sched_switch_100 (void) 
+{
+  measure_switch (10);
+  measure_switch (100);
+}
+
+void
+test_sched_switch_1000 (void) 
+{
+  measure_switch (10);
+  measure_switch (1000);
+}
+
+static void
+measure_switch (int thread_cnt) 
+{
+  struct semaphore done;
+  uint64_t start, cycles;
+  long long switch_cnt;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  sema_init (&done, 0);
+
+  /* Keep the workers from running until all of them are ready. */
+  thread_set_priority (PRI_MAX);
+  for (i = 0; i < thread_cnt; i++) 
+    {
+      char name[16];
+      snprintf (name, sizeof name, "yield%d", i);
+      if (thread_create (name, PRI_DEFAULT + 1, yield_thread, &done) == TID_ERROR)
+        fail ("thread_create failed at thread %d", i);
+    }
+
+  /* Dropping below the workers lets them run until all exit. */
+  start = rdtsc ();
+  thread_set_priority (PRI_DEFAULT);
+  for (i = 0; i < thread_cnt; i++)
+    sema_down (&done);
+  cycles = rdtsc () - start;
+
+  switch_cnt = (long long) thread_cnt * ITER_CNT;
+  msg ("%d threads: %lld switches, %lld cycles per switch.",
+       thread_cnt, switch_cnt, (long long) (cycles / switch_cnt));
+}
+
+static void
+yield_thread (void *done_) 
+{
+  struct semaphore *done = done_;
+  int i;
+
+  for (i = 0; i < ITER_CNT; i++)
+    thread_yield ();
+  sema_up (done);
+}
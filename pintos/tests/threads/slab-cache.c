@@ -0,0 +1,94 @@
+/* Checks the slab allocator.  Allocates many objects from a
+   cache with a constructor and checks that they do not overlap,
+   are aligned, were constructed, and that different slabs are
+   colored differently.  Then frees them all, with their
+   constructed state restored, and checks that the objects
+   handed out again are still in that state. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/slab.h"
+#include "threads/vaddr.h"
+
+/* Number of objects allocated. */
+#define OBJ_CNT 1000
+
+/* Constructed state. */
+#define OBJ_MAGIC 0x0b1ec7
+
+struct obj 
+  {
+    int magic;                  /* OBJ_MAGIC while constructed. */
+    int idx;                    /* Index in OBJS, while allocated. */
+    char data[292];             /* Makes slabs leave room for colors. */
+  };
+
+static struct obj *objs[OBJ_CNT];
+static int ctor_cnt;
+
+static void
+obj_ctor (void *obj_) 
+{
+  struct obj *obj = obj_;
+
+  obj->magic = OBJ_MAGIC;
+  ctor_cnt++;
+}
+
+static void
+alloc_all (struct kmem_cache *cache) 
+{
+  int i;
+
+  for (i = 0; i < OBJ_CNT; i++) 
+    {
+      objs[i] = kmem_cache_alloc (cache);
+      if (objs[i] == NULL)
+        fail ("allocation %d failed", i);
+      if ((uintptr_t) objs[i] % 8 != 0)
+        fail ("object %d at %p is misaligned", i, objs[i]);
+      if (objs[i]->magic != OBJ_MAGIC)
+        fail ("object %d is not constructed", i);
+      objs[i]->idx = i;
+    }
+  for (i = 0; i < OBJ_CNT; i++)
+    if (objs[i]->idx != i)
+      fail ("object %d overlaps object %d", i, objs[i]->idx);
+}
+
+void
+test_slab_cache (void) 
+{
+  struct kmem_cache *cache;
+  bool colored = false;
+  int i;
+
+  cache = kmem_cache_create ("slab-cache", sizeof (struct obj), obj_ctor);
+
+  alloc_all (cache);
+  msg ("Allocated %d objects without overlap.", OBJ_CNT);
+  if (ctor_cnt < OBJ_CNT)
+    fail ("only %d constructor calls for %d objects", ctor_cnt, OBJ_CNT);
+  msg ("Every object was constructed.");
+
+  /* The first object of each slab starts at the slab's color, so
+     with two or more colors the objects cannot all lie at the
+     same offset modulo their size. */
+  for (i = 1; i < OBJ_CNT; i++)
+    if (pg_ofs (objs[i]) % sizeof (struct obj)
+        != pg_ofs (objs[0]) % sizeof (struct obj))
+      colored = true;
+  if (!colored)
+    fail ("all slabs have the same color");
+  msg ("Slabs are colored.");
+
+  for (i = 0; i < OBJ_CNT; i++)
+    kmem_cache_free (cache, objs[i]);
+  alloc_all (cache);
+  msg ("Reused objects are still constructed.");
+
+  for (i = 0; i < OBJ_CNT; i++)
+    kmem_cache_free (cache, objs[i]);
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(slab-cache) begin
+(slab-cache) Allocated 1000 objects without overlap.
+(slab-cache) Every object was constructed.
+(slab-cache) Slabs are colored.
+(slab-cache) Reused objects are still constructed.
+(slab-cache) end
+EOF
+pass;
@@ -0,0 +1,88 @@
+/* Measures how fast memcpy() copies and memset() zeroes whole
+   pages, next to a byte-at-a-time loop doing the same, and
+   reports each in MB per second.  Also reports whether the
+   string routines are using the ERMS forms. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+
+/* Number of pages worked on between checks of the clock. */
+#define BATCH 64
+
+static long long measure (void (*) (void *, void *), void *, void *);
+static void copy_page (void *, void *);
+static void zero_page (void *, void *);
+static void copy_page_bytes (void *, void *);
+static void zero_page_bytes (void *, void *);
+
+void
+test_string_bench (void) 
+{
+  void *a = palloc_get_page (PAL_ASSERT);
+  void *b = palloc_get_page (PAL_ASSERT);
+
+  msg ("ERMS %s.", string_erms ? "in use" : "not available");
+  msg ("page copy: %lld MB/s (byte loop: %lld MB/s).",
+       measure (copy_page, a, b), measure (copy_page_bytes, a, b));
+  msg ("page zero: %lld MB/s (byte loop: %lld MB/s).",
+       measure (zero_page, a, b), measure (zero_page_bytes, a, b));
+
+  palloc_free_page (a);
+  palloc_free_page (b);
+}
+
+/* Runs FN on pages A and B for one second and returns the
+   throughput in MB per second. */
+static long long
+measure (void (*fn) (void *, void *), void *a, void *b) 
+{
+  long long pages = 0;
+  int64_t start = timer_ticks ();
+  int i;
+
+  while (timer_elapsed (start) < TIMER_FREQ) 
+    {
+      for (i = 0; i < BATCH; i++)
+        fn (a, b);
+      pages += BATCH;
+    }
+  return pages * PGSIZE / (1024 * 1024);
+}
+
+static void
+copy_page (void *a, void *b) 
+{
+  memcpy (a, b, PGSIZE);
+}
+
+static void
+zero_page (void *a, void *b UNUSED) 
+{
+  memset (a, 0, PGSIZE);
+}
+
+static void
+copy_page_bytes (void *a_, void *b_) 
+{
+  volatile unsigned char *a = a_;
+  const unsigned char *b = b_;
+  size_t i;
+
+  for (i = 0; i < PGSIZE; i++)
+    a[i] = b[i];
+}
+
+static void
+zero_page_bytes (void *a_, void *b UNUSED) 
+{
+  volatile unsigned char *a = a_;
+  size_t i;
+
+  for (i = 0; i < PGSIZE; i++)
+    a[i] = 0;
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+my (@core) = get_core_output ("run", @output);
+fail "missing ERMS line\n"
+  if !grep (/^\(string-bench\) ERMS (in use|not available)\.$/, @core);
+fail "missing page copy timing line\n"
+  if !grep (/^\(string-bench\) page copy: \d+ MB\/s \(byte loop: \d+ MB\/s\)\.$/, @core);
+fail "missing page zero timing line\n"
+  if !grep (/^\(string-bench\) page zero: \d+ MB\/s \(byte loop: \d+ MB\/s\)\.$/, @core);
+pass;
@@ -17,6 +17,9 @@ static const struct test tests[] =
     {"alarm-priority", test_alarm_priority},
     {"alarm-zero", test_alarm_zero},
     {"alarm-negative", test_alarm_negative},
+    {"alarm-stress", test_alarm_stress},
+    {"alarm-cascade", test_alarm_cascade},
+    {"alarm-tickless", test_alarm_tickless},
     {"priority-change", test_priority_change},
     {"priority-donate-one", test_priority_donate_one},
     {"priority-donate-multiple", test_priority_donate_multiple},
@@ -25,10 +28,26 @@ static const struct test tests[] =
     {"priority-donate-sema", test_priority_donate_sema},
     {"priority-donate-lower", test_priority_donate_lower},
     {"priority-donate-chain", test_priority_donate_chain},
+    {"priority-donate-deep", test_priority_donate_deep},
+    {"priority-donate-rwlock", test_priority_donate_rwlock},
+    {"priority-donate-rwchain", test_priority_donate_rwchain},
+    {"priority-donate-rwdowngrade", test_priority_donate_rwdowngrade},
+    {"priority-donate-waiter", test_priority_donate_waiter},
     {"priority-fifo", test_priority_fifo},
     {"priority-preempt", test_priority_preempt},
     {"priority-sema", test_priority_sema},
     {"priority-condvar", test_priority_condvar},
+    {"sched-switch-10", test_sched_switch_10},
+    {"sched-switch-100", test_sched_switch_100},
+    {"sched-switch-1000", test_sched_switch_1000},
+    {"lock-uncontended", test_lock_uncontended},
+    {"lock-holder-preempt", test_lock_holder_preempt},
+    {"palloc-buddy", test_palloc_buddy},
+    {"palloc-bench-256mb", test_palloc_bench_256mb},
+    {"palloc-bench-2gb", test_palloc_bench_2gb},
+    {"slab-cache", test_slab_cache},
+    {"malloc-large", test_malloc_large},
+    {"string-bench", test_string_bench},
     {"mlfqs-load-1", test_mlfqs_load_1},
     {"mlfqs-load-60", test_mlfqs_load_60},
     {"mlfqs-load-avg", test_mlfqs_load_avg},
@@ -38,6 +57,8 @@ static const struct test tests[] =
     {"mlfqs-nice-2", test_mlfqs_nice_2},
     {"mlfqs-nice-10", test_mlfqs_nice_10},
     {"mlfqs-block", test_mlfqs_block},
+    {"mlfqs-wake-order", test_mlfqs_wake_order},
+    {"mlfqs-tick-cost", test_mlfqs_tick_cost},
   };
 
 static const char *test_name;
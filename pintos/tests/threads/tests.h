@@ -11,6 +11,9 @@ extern test_func test_alarm_simultaneous;
 extern test_func test_alarm_priority;
 extern test_func test_alarm_zero;
 extern test_func test_alarm_negative;
+extern test_func test_alarm_stress;
+extern test_func test_alarm_cascade;
+extern test_func test_alarm_tickless;
 extern test_func test_priority_change;
 extern test_func test_priority_donate_one;
 extern test_func test_priority_donate_multiple;
@@ -19,10 +22,26 @@ extern test_func test_priority_donate_sema;
 extern test_func test_priority_donate_nest;
 extern test_func test_priority_donate_lower;
 extern test_func test_priority_donate_chain;
+extern test_func test_priority_donate_deep;
+extern test_func test_priority_donate_rwlock;
+extern test_func test_priority_donate_rwchain;
+extern test_func test_priority_donate_rwdowngrade;
+extern test_func test_priority_donate_waiter;
 extern test_func test_priority_fifo;
 extern test_func test_priority_preempt;
 extern test_func test_priority_sema;
 extern test_func test_priority_condvar;
+extern test_func test_sched_switch_10;
+extern test_func test_sched_switch_100;
+extern test_func test_sched_switch_1000;
+extern test_func test_lock_uncontended;
+extern test_func test_lock_holder_preempt;
+extern test_func test_palloc_buddy;
+extern test_func test_palloc_bench_256mb;
+extern test_func test_palloc_bench_2gb;
+extern test_func test_slab_cache;
+extern test_func test_malloc_large;
+extern test_func test_string_bench;
 extern test_func test_mlfqs_load_1;
 extern test_func test_mlfqs_load_60;
 extern test_func test_mlfqs_load_avg;
@@ -32,6 +51,8 @@ extern test_func test_mlfqs_fair_20;
 extern test_func test_mlfqs_nice_2;
 extern test_func test_mlfqs_nice_10;
 extern test_func test_mlfqs_block;
+extern test_func test_mlfqs_wake_order;
+extern test_func test_mlfqs_tick_cost;
 
 void msg (const char *, ...);
 void fail (const char *, ...);
@@ -0,0 +1,40 @@
+/* Forks two children that compute for a while in user mode and
+   waits for both.  Run with two CPUs (see Make.tests), they should
+   run in parallel, so the .ck file checks that the second CPU
+   spent timer ticks in user programs. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CHILD_CNT 2
+#define ITER_CNT 100000000
+
+static int
+spin (int seed)
+{
+  unsigned x = seed;
+  int i;
+
+  for (i = 0; i < ITER_CNT; i++)
+    x = x * 1103515245 + 12345;
+  return x >> 24;
+}
+
+void
+test_main (void)
+{
+  pid_t pids[CHILD_CNT];
+  int i;
+
+  for (i = 0; i < CHILD_CNT; i++)
+    {
+      pids[i] = fork ("child");
+      if (pids[i] < 0)
+        fail ("fork() returned %d", pids[i]);
+      if (pids[i] == 0)
+        exit (spin (i));
+    }
+  for (i = 0; i < CHILD_CNT; i++)
+    msg ("child %d exit status is %d", i, wait (pids[i]));
+}
@@ -0,0 +1,37 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+check_expected ([<<'EOF', <<'EOF', <<'EOF']);
+(smp-spread) begin
+child: exit(171)
+child: exit(39)
+(smp-spread) child 0 exit status is 171
+(smp-spread) child 1 exit status is 39
+(smp-spread) end
+smp-spread: exit(0)
+EOF
+(smp-spread) begin
+child: exit(39)
+child: exit(171)
+(smp-spread) child 0 exit status is 171
+(smp-spread) child 1 exit status is 39
+(smp-spread) end
+smp-spread: exit(0)
+EOF
+(smp-spread) begin
+child: exit(171)
+(smp-spread) child 0 exit status is 171
+child: exit(39)
+(smp-spread) child 1 exit status is 39
+(smp-spread) end
+smp-spread: exit(0)
+EOF
+my (@output) = read_text_file ("$test.output");
+my ($cpus) = map (/^SMP: (\d+) CPUs online\.$/, @output);
+fail "second CPU did not start\n" if !defined $cpus || $cpus < 2;
+my ($user) = map (/^CPU 1: \d+ idle ticks, \d+ kernel ticks, (\d+) user ticks$/, @output);
+fail "missing statistics for CPU 1\n" if !defined $user;
+fail "CPU 1 never ran a user program\n" if $user == 0;
+pass "CPU 1 ran user programs for $user ticks";
@@ -0,0 +1,55 @@
+/* Makes 16 MB of anonymous memory resident, then measures how
+   long fork() takes to return in the parent.  With copy-on-write
+   that should be a small fraction of one pass over the memory,
+   which is also reported for comparison: an eager fork() copies
+   every byte of it. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define RESIDENT_SIZE (16 * 1024 * 1024)
+
+static char resident[RESIDENT_SIZE];
+
+static inline unsigned long long
+rdtsc (void)
+{
+  unsigned lo, hi;
+  asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+  return ((unsigned long long) hi << 32) | lo;
+}
+
+void
+test_main (void)
+{
+  unsigned long long start, pass_cycles, fork_cycles;
+  pid_t child;
+  size_t i;
+
+  memset (resident, 0x5a, sizeof resident);
+
+  start = rdtsc ();
+  memset (resident, 0xa5, sizeof resident);
+  pass_cycles = rdtsc () - start;
+
+  start = rdtsc ();
+  child = fork ("child");
+  if (child == 0)
+    {
+      for (i = 0; i < sizeof resident; i += PAGE_SIZE)
+        if (resident[i] != (char) 0xa5)
+          fail ("child: page %zu differs from parent's", i / PAGE_SIZE);
+      exit (0);
+    }
+  fork_cycles = rdtsc () - start;
+  if (child < 0)
+    fail ("fork failed");
+  if (wait (child) != 0)
+    fail ("child failed");
+
+  msg ("fork of %d MB: %llu cycles, one pass over it: %llu cycles",
+       RESIDENT_SIZE / (1024 * 1024), fork_cycles, pass_cycles);
+}
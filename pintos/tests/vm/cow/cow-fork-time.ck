@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+my (@core) = get_core_output ("run", @output);
+fail "missing begin\n" if !grep ($_ eq '(cow-fork-time) begin', @core);
+fail "child did not exit cleanly\n" if !grep ($_ eq 'child: exit(0)', @core);
+fail "missing timing line\n"
+  if !grep (/^\(cow-fork-time\) fork of \d+ MB: \d+ cycles, one pass over it: \d+ cycles$/, @core);
+fail "missing end\n" if !grep ($_ eq '(cow-fork-time) end', @core);
+pass;
@@ -0,0 +1,93 @@
+/* Has a forked child push a few pages of the parent out to swap,
+   then forks again while they are still out.  The second child
+   must see the parent's data in them and must be able to write to
+   them without changing the parent's copy, which stays in swap
+   until that child is gone. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define SHARED_PAGES 8
+#define THRASH_SIZE (12 * 1024 * 1024)
+#define THRASH_TRIES 4
+
+static char shared[SHARED_PAGES * PAGE_SIZE];
+static char thrash[THRASH_SIZE];
+
+/* Returns true if no page of shared[] is resident. */
+static bool
+shared_swapped_out (void)
+{
+  size_t i;
+
+  for (i = 0; i < sizeof shared; i += PAGE_SIZE)
+    if (get_phys_addr (shared + i) != NULL)
+      return false;
+  return true;
+}
+
+/* Touches more memory than there are user frames, after taking
+   private copies of shared[] so that the parent's frames are no
+   longer shared and may be evicted. */
+static void
+thrash_memory (void)
+{
+  size_t i;
+
+  memset (shared, 0, sizeof shared);
+  for (i = 0; i < THRASH_SIZE; i += PAGE_SIZE)
+    thrash[i] = (char) (i / PAGE_SIZE + 1);
+  exit (0);
+}
+
+static void
+write_shared (void)
+{
+  size_t i;
+
+  for (i = 0; i < sizeof shared; i++)
+    if (shared[i] != (char) (i / PAGE_SIZE + 'A'))
+      fail ("writer: byte %zu differs from parent's", i);
+  memset (shared, 'z', sizeof shared);
+  for (i = 0; i < sizeof shared; i++)
+    if (shared[i] != 'z')
+      fail ("writer: byte %zu lost its write", i);
+  exit (0);
+}
+
+void
+test_main (void)
+{
+  pid_t child;
+  size_t i;
+  int try;
+
+  for (i = 0; i < sizeof shared; i++)
+    shared[i] = (char) (i / PAGE_SIZE + 'A');
+
+  for (try = 0; try < THRASH_TRIES && !shared_swapped_out (); try++)
+    {
+      child = fork ("thrasher");
+      if (child == 0)
+        thrash_memory ();
+      if (child < 0 || wait (child) != 0)
+        fail ("thrasher failed");
+    }
+  CHECK (shared_swapped_out (), "swap out parent's pages");
+
+  child = fork ("writer");
+  if (child == 0)
+    write_shared ();
+  if (child < 0)
+    fail ("fork failed");
+  CHECK (wait (child) == 0, "wait for writer");
+
+  CHECK (shared_swapped_out (), "parent's pages still swapped out");
+  for (i = 0; i < sizeof shared; i++)
+    if (shared[i] != (char) (i / PAGE_SIZE + 'A'))
+      fail ("parent: byte %zu changed by writer", i);
+  msg ("parent's data intact");
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(cow-swapped) begin
+(cow-swapped) swap out parent's pages
+(cow-swapped) wait for writer
+(cow-swapped) parent's pages still swapped out
+(cow-swapped) parent's data intact
+(cow-swapped) end
+EOF
+pass;
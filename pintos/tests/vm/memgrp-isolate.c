@@ -0,0 +1,86 @@
+/* Runs a small "service" working set in the root memory group
+   while a forked child thrashes a 2 MB buffer inside a group
+   limited to THRASH_FRAMES resident frames.  The child's
+   evictions must stay inside its own group, so the service's
+   pages are never stolen and touching them stays cheap.  Reports
+   the worst latency of one pass over the service's pages. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define SERVICE_PAGES 16
+#define SERVICE_ROUNDS 2000
+#define THRASH_SIZE (2 * 1024 * 1024)
+#define THRASH_FRAMES 32
+#define THRASH_PASSES 3
+
+static char service[SERVICE_PAGES * PAGE_SIZE];
+static char thrash[THRASH_SIZE];
+
+static inline unsigned long long
+rdtsc (void)
+{
+  unsigned lo, hi;
+  asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+  return ((unsigned long long) hi << 32) | lo;
+}
+
+static void
+thrash_memory (void)
+{
+  size_t i;
+  int pass;
+
+  if (!memgroup (THRASH_FRAMES, 0))
+    fail ("memgroup failed");
+
+  for (pass = 0; pass < THRASH_PASSES; pass++)
+    {
+      for (i = 0; i < THRASH_SIZE; i += PAGE_SIZE)
+        thrash[i] = (char) (i / PAGE_SIZE + pass);
+      for (i = 0; i < THRASH_SIZE; i += PAGE_SIZE)
+        if (thrash[i] != (char) (i / PAGE_SIZE + pass))
+          fail ("thrash page %zu corrupted in pass %d", i / PAGE_SIZE, pass);
+    }
+  exit (0);
+}
+
+void
+test_main (void)
+{
+  unsigned long long worst = 0;
+  pid_t child;
+  size_t i;
+  int round;
+
+  memset (service, 0x5a, sizeof service);
+
+  child = fork ("thrasher");
+  if (child == 0)
+    thrash_memory ();
+  if (child < 0)
+    fail ("fork failed");
+
+  for (round = 0; round < SERVICE_ROUNDS; round++)
+    {
+      unsigned long long start = rdtsc (), elapsed;
+
+      for (i = 0; i < sizeof service; i += PAGE_SIZE)
+        service[i]++;
+      elapsed = rdtsc () - start;
+      if (elapsed > worst)
+        worst = elapsed;
+    }
+
+  if (wait (child) != 0)
+    fail ("thrasher failed");
+
+  for (i = 0; i < sizeof service; i++)
+    if (service[i] != (i % PAGE_SIZE == 0 ? (char) (0x5a + SERVICE_ROUNDS) : 0x5a))
+      fail ("service byte %zu corrupted", i);
+
+  msg ("service: %d rounds, worst round %llu cycles", SERVICE_ROUNDS, worst);
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+my (@core) = get_core_output ("run", @output);
+fail "missing begin\n" if !grep ($_ eq '(memgrp-isolate) begin', @core);
+fail "thrasher did not exit cleanly\n" if !grep ($_ eq 'thrasher: exit(0)', @core);
+fail "missing timing line\n"
+  if !grep (/^\(memgrp-isolate\) service: \d+ rounds, worst round \d+ cycles$/, @core);
+fail "missing end\n" if !grep ($_ eq '(memgrp-isolate) end', @core);
+pass;
@@ -0,0 +1,49 @@
+/* Reads a mapping of large.txt one page at a time in a random
+   order, checking every page against the file's contents.  There
+   is no sequential pattern for readahead to follow, so it should
+   read little ahead; the .ck file checks its counters. */
+
+#include <debug.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/vm/large.inc"
+
+#define PAGE_SIZE 4096
+#define MAX_PAGES 512
+
+static size_t order[MAX_PAGES];
+
+void
+test_main (void)
+{
+  char *actual = (char *) 0x10000000;
+  size_t len = strlen (large);
+  size_t page_cnt = (len + PAGE_SIZE - 1) / PAGE_SIZE;
+  size_t i;
+  int handle;
+  void *map;
+
+  ASSERT (page_cnt <= MAX_PAGES);
+  for (i = 0; i < page_cnt; i++)
+    order[i] = i;
+  shuffle (order, page_cnt, sizeof *order);
+
+  CHECK ((handle = open ("large.txt")) > 1, "open \"large.txt\"");
+  CHECK ((map = mmap (actual, len, 0, handle, 0)) != MAP_FAILED,
+         "mmap \"large.txt\"");
+
+  for (i = 0; i < page_cnt; i++)
+    {
+      size_t ofs = order[i] * PAGE_SIZE;
+      size_t size = len - ofs < PAGE_SIZE ? len - ofs : PAGE_SIZE;
+
+      if (memcmp (actual + ofs, large + ofs, size))
+        fail ("page %zu of mmap'd file reported bad data", order[i]);
+    }
+  msg ("checked %zu pages in random order", page_cnt);
+
+  munmap (map);
+  close (handle);
+}
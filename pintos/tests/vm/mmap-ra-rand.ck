@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-ra-rand) begin
+(mmap-ra-rand) open "large.txt"
+(mmap-ra-rand) mmap "large.txt"
+(mmap-ra-rand) checked 490 pages in random order
+(mmap-ra-rand) end
+EOF
+my (@output) = read_text_file ("$test.output");
+my ($windows, $read)
+  = map (/^Mmap readahead: (\d+) windows, (\d+) pages read ahead/, @output);
+fail "missing mmap readahead statistics\n" if !defined $read;
+fail "random faults read $read of 490 pages ahead\n" if $read >= 490 / 4;
+pass;
@@ -0,0 +1,40 @@
+/* Reads a mapping of large.txt front to back, one page at a time,
+   checking every page against the file's contents.  The faults
+   are sequential, so readahead should have read most pages before
+   they are touched; the .ck file checks its counters. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/vm/large.inc"
+
+#define PAGE_SIZE 4096
+
+void
+test_main (void)
+{
+  char *actual = (char *) 0x10000000;
+  size_t len = strlen (large);
+  size_t page_cnt = (len + PAGE_SIZE - 1) / PAGE_SIZE;
+  size_t i;
+  int handle;
+  void *map;
+
+  CHECK ((handle = open ("large.txt")) > 1, "open \"large.txt\"");
+  CHECK ((map = mmap (actual, len, 0, handle, 0)) != MAP_FAILED,
+         "mmap \"large.txt\"");
+
+  for (i = 0; i < page_cnt; i++)
+    {
+      size_t ofs = i * PAGE_SIZE;
+      size_t size = len - ofs < PAGE_SIZE ? len - ofs : PAGE_SIZE;
+
+      if (memcmp (actual + ofs, large + ofs, size))
+        fail ("page %zu of mmap'd file reported bad data", i);
+    }
+  msg ("checked %zu pages in order", page_cnt);
+
+  munmap (map);
+  close (handle);
+}
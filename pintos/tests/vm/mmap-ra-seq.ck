@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-ra-seq) begin
+(mmap-ra-seq) open "large.txt"
+(mmap-ra-seq) mmap "large.txt"
+(mmap-ra-seq) checked 490 pages in order
+(mmap-ra-seq) end
+EOF
+my (@output) = read_text_file ("$test.output");
+my ($windows, $read, $hits)
+  = map (/^Mmap readahead: (\d+) windows, (\d+) pages read ahead, (\d+) hits/,
+         @output);
+fail "missing mmap readahead statistics\n" if !defined $hits;
+fail "sequential faults opened no readahead window\n" if $windows == 0;
+fail "no fault was served by readahead\n" if $hits == 0;
+pass;
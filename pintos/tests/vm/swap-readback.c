@@ -0,0 +1,43 @@
+/* Writes a distinct value to every word of 16 MB of anonymous
+   memory, more than fits in the frames of a 10 MB machine, then
+   reads all of it back twice, front to back, checking each word.
+   Pages evicted together go to consecutive swap slots, so reading
+   them back in order should find most of them read ahead; the .ck
+   file checks the swap counters. */
+
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CHUNK_SIZE (16 * 1024 * 1024)
+#define WORD_CNT (CHUNK_SIZE / sizeof (uint32_t))
+
+static uint32_t chunk[WORD_CNT];
+
+/* Value stored in word I.  Never leaves a page all zeros. */
+static uint32_t
+pattern (size_t i)
+{
+  return (uint32_t) i * 2654435761u | 1;
+}
+
+void
+test_main (void)
+{
+  size_t i;
+  int pass;
+
+  for (i = 0; i < WORD_CNT; i++)
+    chunk[i] = pattern (i);
+  msg ("wrote %d MB", CHUNK_SIZE / (1024 * 1024));
+
+  for (pass = 0; pass < 2; pass++)
+    {
+      for (i = 0; i < WORD_CNT; i++)
+        if (chunk[i] != pattern (i))
+          fail ("pass %d: word %zu is %08x, not %08x",
+                pass, i, chunk[i], pattern (i));
+      msg ("pass %d: read back %d MB", pass, CHUNK_SIZE / (1024 * 1024));
+    }
+}
@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(swap-readback) begin
+(swap-readback) wrote 16 MB
+(swap-readback) pass 0: read back 16 MB
+(swap-readback) pass 1: read back 16 MB
+(swap-readback) end
+EOF
+my (@output) = read_text_file ("$test.output");
+my ($in, $out) = map (/^Swap: (\d+) pages in, (\d+) pages out/, @output);
+fail "missing swap statistics\n" if !defined $out;
+fail "nothing was swapped out\n" if $out == 0;
+fail "nothing was swapped back in\n" if $in == 0;
+my ($hits) = map (/^Swap readahead: (\d+) hits/, @output);
+fail "missing swap readahead statistics\n" if !defined $hits;
+fail "no swap-in was served by readahead\n" if $hits == 0;
+pass;
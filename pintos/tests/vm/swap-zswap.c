@@ -0,0 +1,56 @@
+/* Fills 8 MB of anonymous memory, more than fits in the frames
+   of a 10 MB machine, with pages of three kinds: all zeros, a
+   short pattern repeated across the page, and words that never
+   repeat.  Then reads all of it back, checking each word.  The
+   kernel runs with -zswap, so evicted zero pages should only be
+   noted, patterned pages should go to the compressed pool, and
+   only the rest should reach the swap disk; the .ck file checks
+   the counters and reports the pool's compression ratio and the
+   sector writes saved. */
+
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CHUNK_SIZE (8 * 1024 * 1024)
+#define PAGE_WORDS (4096 / sizeof (uint32_t))
+#define PAGE_CNT (CHUNK_SIZE / 4096)
+
+/* Page-aligned, so that each row is one page of its own kind. */
+static uint32_t chunk[PAGE_CNT][PAGE_WORDS] __attribute__ ((aligned (4096)));
+
+/* Value stored in word W of page P.  One page in four is all
+   zeros, one in four never repeats a word, and the others repeat
+   a 64-byte pattern that starts with the page number. */
+static uint32_t
+value (size_t p, size_t w)
+{
+  switch (p % 4)
+    {
+    case 0:
+      return 0;
+    case 3:
+      return (uint32_t) (p * PAGE_WORDS + w) * 2654435761u | 1;
+    default:
+      return w % 16 == 0 ? p : 0x61616161 + w % 16;
+    }
+}
+
+void
+test_main (void)
+{
+  size_t p, w;
+
+  for (p = 0; p < PAGE_CNT; p++)
+    for (w = 0; w < PAGE_WORDS; w++)
+      chunk[p][w] = value (p, w);
+  msg ("wrote %d MB", CHUNK_SIZE / (1024 * 1024));
+
+  for (p = 0; p < PAGE_CNT; p++)
+    for (w = 0; w < PAGE_WORDS; w++)
+      if (chunk[p][w] != value (p, w))
+        fail ("page %zu word %zu is %08x, not %08x",
+              p, w, chunk[p][w], value (p, w));
+  msg ("read back %d MB", CHUNK_SIZE / (1024 * 1024));
+}
@@ -0,0 +1,28 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(swap-zswap) begin
+(swap-zswap) wrote 8 MB
+(swap-zswap) read back 8 MB
+(swap-zswap) end
+EOF
+my (@output) = read_text_file ("$test.output");
+my ($in, $out) = map (/^Swap: (\d+) pages in, (\d+) pages out/, @output);
+fail "missing swap statistics\n" if !defined $out;
+fail "nothing was swapped out\n" if $out == 0;
+my ($zero, $comp, $sectors)
+  = map (/^Swap: (\d+) zero pages and (\d+) compressed pages kept off the disk, saving (\d+) sector writes/,
+         @output);
+fail "missing zswap swap statistics\n" if !defined $sectors;
+fail "no zero page was kept off the disk\n" if $zero == 0;
+fail "no page was compressed\n" if $comp == 0;
+my ($stored, $kb, $pct, $rejected)
+  = map (/^Zswap: (\d+) pages stored in (\d+) kB \((\d+)% of original\), (\d+) incompressible/,
+         @output);
+fail "missing zswap statistics\n" if !defined $rejected;
+fail "no page was found incompressible\n" if $rejected == 0;
+fail "patterned pages compressed only to $pct% of their size\n" if $pct > 25;
+pass "compressed to $pct% of original, saving $sectors sector writes";
@@ -20,7 +20,12 @@
 #include "threads/mmu.h"
 #include "threads/palloc.h"
 #include "threads/pte.h"
+#include "threads/slab.h"
+#include "threads/smp.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/vmalloc.h"
+#include "intrinsic.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
@@ -32,6 +37,7 @@
 #include "tests/threads/tests.h"
 #ifdef VM
 #include "vm/vm.h"
+#include "vm/zswap.h"
 #endif
 #ifdef FILESYS
 #include "devices/disk.h"
@@ -53,6 +59,7 @@ bool power_off_when_done;
 bool thread_tests;
 
 static void bss_init(void);
+static void cpu_features_init(void);
 static void paging_init(uint64_t mem_end);
 
 static char **read_command_line(void);
@@ -72,6 +79,7 @@ int main(void)
 
 	/* Clear BSS and get machine's RAM size. */
 	bss_init();
+	cpu_features_init();
 
 	/* Break command line into arguments and parse options. */
 	argv = read_command_line();
@@ -85,7 +93,11 @@ int main(void)
 	/* Initialize memory system. */
 	mem_end = palloc_init();
 	malloc_init();
+	kmem_init();
+	synch_init();
 	paging_init(mem_end);
+	palloc_init_high();
+	vmalloc_init();
 
 #ifdef USERPROG
 	tss_init();
@@ -103,8 +115,10 @@ int main(void)
 #endif
 	/* Start thread scheduler and enable interrupts. */
 	thread_start();
+	palloc_prezero_start();
 	serial_init_queue();
 	timer_calibrate();
+	smp_init();
 
 #ifdef USERPROG
 	init_std_fds();
@@ -144,6 +158,20 @@ static void bss_init(void)
 	memset(&_start_bss, 0, &_end_bss - &_start_bss);
 }
 
+/* Checks which optional CPU features the kernel can use. */
+static void cpu_features_init(void)
+{
+	uint32_t max_leaf, ebx, ecx, edx;
+
+	/* CPUID leaf 7, EBX bit 9: enhanced REP MOVSB/STOSB. */
+	cpuid(0, 0, &max_leaf, &ebx, &ecx, &edx);
+	if (max_leaf >= 7) {
+		uint32_t eax;
+		cpuid(7, 0, &eax, &ebx, &ecx, &edx);
+		string_erms = (ebx & (1 << 9)) != 0;
+	}
+}
+
 /* Populates the page table with the kernel virtual mapping,
  * and then sets up the CPU to use the new page directory.
  * Points base_pml4 to the pml4 it creates. */
@@ -169,6 +197,10 @@ static void paging_init(uint64_t mem_end)
 
 	// reload cr3
 	pml4_activate(0);
+
+	// Make the kernel fault on writes to read-only pages too, so
+	// that its writes to user memory break copy-on-write sharing.
+	lcr0(rcr0() | CR0_WP);
 }
 
 /* Breaks the kernel command line into words and returns them as
@@ -225,11 +257,38 @@ static char **parse_options(char **argv)
 			random_init(atoi(value));
 		else if (!strcmp(name, "-mlfqs"))
 			thread_mlfqs = true;
+		else if (!strcmp(name, "-tickless"))
+			timer_tickless = true;
 #ifdef USERPROG
 		else if (!strcmp(name, "-ul"))
 			user_page_limit = atoi(value);
 		else if (!strcmp(name, "-threads-tests"))
 			thread_tests = true;
+#endif
+#ifdef VM
+		else if (!strcmp(name, "-clock-age")) {
+			int age = atoi(value);
+			if (age < 1 || age > UINT8_MAX)
+				PANIC("-clock-age must be between 1 and %d", UINT8_MAX);
+			vm_clock_age = age;
+		} else if (!strcmp(name, "-evict")) {
+			if (value != NULL && !strcmp(value, "clock"))
+				vm_evict_policy = VM_EVICT_CLOCK;
+			else if (value != NULL && !strcmp(value, "2q"))
+				vm_evict_policy = VM_EVICT_2Q;
+			else
+				PANIC("unknown eviction policy `%s' (use clock or 2q)", value);
+		} else if (!strcmp(name, "-zswap")) {
+			int kb = atoi(value);
+			if (kb < 0 || kb > ZSWAP_LIMIT_KB)
+				PANIC("-zswap must be between 0 and %d", ZSWAP_LIMIT_KB);
+			zswap_max_kb = kb;
+		} else if (!strcmp(name, "-fault-around")) {
+			int pages = atoi(value);
+			if (pages < 1)
+				PANIC("-fault-around must be at least 1");
+			vm_fault_around = pages;
+		}
 #endif
 		else
 			PANIC("unknown option `%s' (use -h for help)", name);
@@ -326,8 +385,15 @@ static void usage(void)
 		   "  -f                 Format file system disk during startup.\n"
 		   "  -rs=SEED           Set random number seed to SEED.\n"
 		   "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+		   "  -tickless          Stop the periodic timer tick while idle.\n"
 #ifdef USERPROG
 		   "  -ul=COUNT          Limit user memory to COUNT pages.\n"
+#endif
+#ifdef VM
+		   "  -clock-age=N       Evict frames after N sweeps unreferenced.\n"
+		   "  -evict=POLICY      Replace frames by POLICY: clock (default) or 2q.\n"
+		   "  -fault-around=N    Load executable and mmap pages N at a time (default 1=off).\n"
+		   "  -zswap=KB          Compress up to KB of swapped-out pages in RAM (0=off).\n"
 #endif
 	);
 	power_off();
@@ -354,6 +420,9 @@ static void print_stats(void)
 {
 	timer_print_stats();
 	thread_print_stats();
+	palloc_print_stats();
+	kmem_print_stats();
+	vmalloc_print_stats();
 #ifdef FILESYS
 	disk_print_stats();
 #endif
@@ -362,4 +431,7 @@ static void print_stats(void)
 #ifdef USERPROG
 	exception_print_stats();
 #endif
+#ifdef VM
+	vm_print_stats();
+#endif
 }
@@ -8,7 +8,9 @@
 #include "threads/io.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
+#include "threads/smp.h"
 #include "threads/vaddr.h"
+#include "devices/lapic.h"
 #include "devices/timer.h"
 #include "intrinsic.h"
 #ifdef USERPROG
@@ -88,7 +90,8 @@ static intr_handler_func *intr_handlers[INTR_CNT];
 static const char *intr_names[INTR_CNT];
 
 /* External interrupts are those generated by devices outside the
-   CPU, such as the timer.  External interrupts run with
+   CPU, such as the timer, or sent by other CPUs (inter-processor
+   interrupts, or IPIs; see threads/smp.c).  External interrupts run with
    interrupts turned off, so they never nest, nor are they ever
    pre-empted.  Handlers for external interrupts also may not
    sleep, although they may invoke intr_yield_on_return() to
@@ -195,6 +198,17 @@ void intr_init(void)
 	intr_names[17] = "#AC Alignment Check Exception";
 	intr_names[18] = "#MC Machine-Check Exception";
 	intr_names[19] = "#XF SIMD Floating-Point Exception";
+	intr_names[IPI_TLB_FLUSH] = "IPI TLB flush";
+}
+
+/* Loads the IDT, and the TSS, on an application processor.  The
+   IDT itself is shared with the BSP, which set it up. */
+void intr_init_ap(void)
+{
+#ifdef USERPROG
+	ltr(SEL_TSS);
+#endif
+	lidt(&idt_desc);
 }
 
 /* Registers interrupt VEC_NO to invoke HANDLER with descriptor
@@ -223,6 +237,15 @@ void intr_register_ext(uint8_t vec_no, intr_handler_func *handler, const char *n
 	register_handler(vec_no, 0, INTR_OFF, handler, name);
 }
 
+/* Registers inter-processor interrupt VEC_NO to invoke HANDLER,
+   which is named NAME for debugging purposes.  Like an external
+   interrupt, the handler will execute with interrupts disabled. */
+void intr_register_ipi(uint8_t vec_no, intr_handler_func *handler, const char *name)
+{
+	ASSERT(vec_no >= 0x50 && vec_no <= 0x5f);
+	register_handler(vec_no, 0, INTR_OFF, handler, name);
+}
+
 /* Registers internal interrupt VEC_NO to invoke HANDLER, which
    is named NAME for debugging purposes.  The interrupt handler
    will be invoked with interrupt status LEVEL.
@@ -239,7 +262,7 @@ void intr_register_ext(uint8_t vec_no, intr_handler_func *handler, const char *n
 void intr_register_int(uint8_t vec_no, int dpl, enum intr_level level, intr_handler_func *handler,
 					   const char *name)
 {
-	ASSERT(vec_no < 0x20 || vec_no > 0x2f);
+	ASSERT((vec_no < 0x20 || vec_no > 0x2f) && (vec_no < 0x50 || vec_no > 0x5f));
 	register_handler(vec_no, dpl, level, handler, name);
 }
 
@@ -321,27 +344,42 @@ static void pic_end_of_interrupt(int irq)
    interrupted thread's registers. */
 void intr_handler(struct intr_frame *frame)
 {
-	bool external;
+	bool external, ipi;
 	intr_handler_func *handler;
 
+	/* Another CPU holds the kernel lock and waits for us to flush
+	   our TLB, so this one cannot wait for the lock. */
+	if (frame->vec_no == IPI_TLB_FLUSH) {
+		smp_flush_tlb_ipi();
+		return;
+	}
+	kernel_lock_acquire();
+
 	/* External interrupts are special.
 	   We only handle one at a time (so interrupts must be off)
-	   and they need to be acknowledged on the PIC (see below).
+	   and they need to be acknowledged on the PIC, or for IPIs
+	   on the local APIC (see below).
 	   An external interrupt handler cannot sleep. */
-	external = frame->vec_no >= 0x20 && frame->vec_no < 0x30;
+	ipi = frame->vec_no >= 0x50 && frame->vec_no < 0x60;
+	external = ipi || (frame->vec_no >= 0x20 && frame->vec_no < 0x30);
 	if (external) {
 		ASSERT(intr_get_level() == INTR_OFF);
 		ASSERT(!intr_context());
 
 		in_external_intr = true;
 		yield_on_return = false;
+
+		/* A device interrupt may end a tickless idle period
+		   early.  Catch the tick count up before handling it. */
+		if (!ipi && frame->vec_no != 0x20)
+			timer_idle_exit();
 	}
 
 	/* Invoke the interrupt's handler. */
 	handler = intr_handlers[frame->vec_no];
 	if (handler != NULL)
 		handler(frame);
-	else if (frame->vec_no == 0x27 || frame->vec_no == 0x2f) {
+	else if (frame->vec_no == 0x27 || frame->vec_no == 0x2f || frame->vec_no == LAPIC_SPURIOUS) {
 		/* There is no handler, but this interrupt can trigger
 		   spuriously due to a hardware fault or hardware race
 		   condition.  Ignore it. */
@@ -358,11 +396,21 @@ void intr_handler(struct intr_frame *frame)
 		ASSERT(intr_context());
 
 		in_external_intr = false;
-		pic_end_of_interrupt(frame->vec_no);
+		if (ipi)
+			lapic_eoi();
+		else
+			pic_end_of_interrupt(frame->vec_no);
 
 		if (yield_on_return)
 			thread_yield();
 	}
+
+	/* Returning to user mode: let the other CPUs into the kernel.
+	   Interrupts stay off until intr_entry's iretq. */
+	if ((frame->cs & 3) == 3) {
+		intr_disable();
+		kernel_lock_release();
+	}
 }
 
 /* Dumps interrupt frame F to the console, for debugging. */
@@ -391,3 +439,9 @@ const char *intr_name(uint8_t vec)
 {
 	return intr_names[vec];
 }
+
+void register_ud_hack(intr_handler_func *h)
+{
+	intr_handlers[6] = NULL;
+	register_handler(6, 3, INTR_ON, h, "ud-syscall");
+}
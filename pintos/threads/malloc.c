@@ -8,6 +8,7 @@
 #include "threads/palloc.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
+#include "threads/vmalloc.h"
 
 /* A simple implementation of malloc().
 
@@ -28,11 +29,14 @@
    blocks, we remove all of the arena's blocks from the free list
    and give the arena back to the page allocator.
 
-   We can't handle blocks bigger than 2 kB using this scheme,
-   because they're too big to fit in a single page with a
-   descriptor.  We handle those by allocating contiguous pages
-   with the page allocator and sticking the allocation size at
-   the beginning of the allocated block's arena header. */
+   We can't handle blocks bigger than 1 kB using this scheme,
+   because no more than one would fit in a page with the arena
+   header.  We hand those to vmalloc(), which packs them into a
+   virtually contiguous region at a much finer granularity than
+   a page (see vmalloc.c).  Until vmalloc() is initialized, or if
+   its region is full, we fall back to allocating contiguous
+   pages with the page allocator and sticking the allocation size
+   at the beginning of the allocated block's arena header. */
 
 /* Descriptor. */
 struct desc {
@@ -97,8 +101,12 @@ void *malloc(size_t size)
 		if (d->block_size >= size)
 			break;
 	if (d == descs + desc_cnt) {
-		/* SIZE is too big for any descriptor.
-		   Allocate enough pages to hold SIZE plus an arena. */
+		/* SIZE is too big for any descriptor. */
+		void *p = vmalloc(size);
+		if (p != NULL)
+			return p;
+
+		/* Allocate enough pages to hold SIZE plus an arena. */
 		size_t page_cnt = DIV_ROUND_UP(size + sizeof *a, PGSIZE);
 		a = palloc_get_multiple(0, page_cnt);
 		if (a == NULL)
@@ -166,6 +174,9 @@ void *calloc(size_t a, size_t b)
 /* Returns the number of bytes allocated for BLOCK. */
 static size_t block_size(void *block)
 {
+	if (is_vmalloc_vaddr(block))
+		return vmalloc_size(block);
+
 	struct block *b = block;
 	struct arena *a = block_to_arena(b);
 	struct desc *d = a->desc;
@@ -200,7 +211,9 @@ void *realloc(void *old_block, size_t new_size)
    malloc(), calloc(), or realloc(). */
 void free(void *p)
 {
-	if (p != NULL) {
+	if (p != NULL && is_vmalloc_vaddr(p))
+		vfree(p);
+	else if (p != NULL) {
 		struct block *b = p;
 		struct arena *a = block_to_arena(b);
 		struct desc *d = a->desc;
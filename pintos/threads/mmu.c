@@ -4,6 +4,7 @@
 #include "threads/init.h"
 #include "threads/pte.h"
 #include "threads/palloc.h"
+#include "threads/smp.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
 #include "intrinsic.h"
@@ -255,6 +256,7 @@ void pml4_clear_page(uint64_t *pml4, void *upage)
 		*pte &= ~PTE_P;
 		if (rcr3() == vtop(pml4))
 			invlpg((uint64_t)upage);
+		smp_flush_tlb(pml4);
 	}
 }
 
@@ -277,10 +279,32 @@ void pml4_set_dirty(uint64_t *pml4, const void *vpage, bool dirty)
 		if (dirty)
 			*pte |= PTE_D;
 		else
-			*pte &= ~(uint32_t)PTE_D;
+			*pte &= ~(uint64_t)PTE_D;
 
 		if (rcr3() == vtop(pml4))
 			invlpg((uint64_t)vpage);
+		/* Another CPU could go on writing through a cached
+		   dirty entry without setting the bit again. */
+		if (!dirty)
+			smp_flush_tlb(pml4);
+	}
+}
+
+/* Sets the writable bit to WRITABLE in the PTE for virtual page
+ * VPAGE in PML4, leaving its other bits alone. */
+void pml4_set_writable(uint64_t *pml4, const void *vpage, bool writable)
+{
+	uint64_t *pte = pml4e_walk(pml4, (uint64_t)vpage, false);
+	if (pte) {
+		if (writable)
+			*pte |= PTE_W;
+		else
+			*pte &= ~(uint64_t)PTE_W;
+
+		if (rcr3() == vtop(pml4))
+			invlpg((uint64_t)vpage);
+		if (!writable)
+			smp_flush_tlb(pml4);
 	}
 }
 
@@ -303,8 +327,11 @@ void pml4_set_accessed(uint64_t *pml4, const void *vpage, bool accessed)
 		if (accessed)
 			*pte |= PTE_A;
 		else
-			*pte &= ~(uint32_t)PTE_A;
+			*pte &= ~(uint64_t)PTE_A;
 
+		/* Other CPUs are not made to flush: until they do, their
+		   accesses just go unnoticed, which only makes the page
+		   look a little older to the clock algorithm. */
 		if (rcr3() == vtop(pml4))
 			invlpg((uint64_t)vpage);
 	}
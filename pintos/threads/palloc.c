@@ -8,8 +8,10 @@
 #include <stdio.h>
 #include <string.h>
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/loader.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
 #include "threads/vaddr.h"
 
 /* Page allocator.  Hands out memory in page-size (or
@@ -24,23 +26,132 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   Each pool is a binary buddy allocator.  Its free pages form
+   blocks of 2**K pages, for "order" K, each aligned to its size
+   relative to the pool's base, and kept on one free list per
+   order.  An allocation splits the smallest free block that is
+   big enough, and a free merges a block with its equally sized
+   neighbor, its "buddy", for as long as the buddy is free too.
+   Both take O(log n) steps in the size of the pool.  Requests
+   that are not a power of two are carved out of the next larger
+   block, and the rest of it is freed again right away.
+
+   Single pages, which are by far the most common request (every
+   page fault wants one), usually do not reach the buddy
+   allocator at all.  Each pool keeps a small cache of free
+   pages, which it refills from and drains to the buddy free
+   lists PCACHE_BATCH pages at a time, so most single-page
+   allocations and frees are a push or a pop.
+
+   A pool is only touched with interrupts off, which is all the
+   mutual exclusion a single CPU needs and lets pages be freed
+   from anywhere, even with interrupts already off.
+
+   Most user pages are asked for with PAL_ZERO, from the page
+   fault handler.  So that the fault path does not have to clear
+   them, the user pool also keeps a stock of pages that are
+   already zero.  Freed pages are set aside for it instead of
+   being poisoned, and a low-priority kernel thread zeroes them,
+   or fresh pages from the pool, whenever the stock runs low. */
+
+/* Number of block orders.  The largest block is 2**20 pages,
+   that is, 4 GB. */
+#define BUDDY_ORDERS 21
+
+/* Null page index in the free lists. */
+#define BUDDY_NIL UINT32_MAX
+
+/* Order of a page that does not head a free block. */
+#define NOT_FREE_HEAD 0xff
+
+/* Buddy bookkeeping for one page of a pool.  It is kept outside
+   the pages themselves, so that free pages are never written. */
+struct buddy_page {
+	uint32_t next; /* Next free block of the same order, or BUDDY_NIL. */
+	uint32_t prev; /* Previous free block of the same order, or BUDDY_NIL. */
+	uint8_t order; /* Order of the free block this page heads, or NOT_FREE_HEAD. */
+};
+
+/* Maximum number of pages in a page cache. */
+#define PCACHE_SIZE 64
+
+/* Number of pages moved between a page cache and its pool at
+   once. */
+#define PCACHE_BATCH 32
+
+/* Maximum number of pages in a pool's pre-zeroed stock. */
+#define PREZERO_MAX 256
+
+/* Cache of free pages in front of a pool's free lists.  Its
+   pages count as used in the pool. */
+struct page_cache {
+	size_t cnt;				  /* Number of pages in PAGES. */
+	void *pages[PCACHE_SIZE]; /* Cached pages, most recently freed last. */
+	long long hits;			  /* Allocations served from the cache. */
+	long long misses;		  /* Allocations that found it empty. */
+	long long refills;		  /* Batches taken from the pool. */
+	long long drains;		  /* Batches given back to the pool. */
+};
 
 /* A memory pool. */
 struct pool {
-	struct lock lock;		 /* Mutual exclusion. */
-	struct bitmap *used_map; /* Bitmap of free pages. */
-	uint8_t *base;			 /* Base of pool. */
+	struct bitmap *used_map;	/* Bitmap of used pages. */
+	uint8_t *base;				/* Base of pool. */
+	struct buddy_page *pages;	/* Buddy bookkeeping, one per page. */
+	uint32_t free_lists[BUDDY_ORDERS]; /* First free block of each order. */
+	size_t free_blocks[BUDDY_ORDERS];  /* Number of free blocks of each order. */
+	size_t free_cnt;				   /* Number of free pages. */
+	struct page_cache cache;		   /* Cache of single pages. */
+
+	/* Pre-zeroed pages.  Like cached pages, they count as used. */
+	size_t zero_target;			/* Pages to keep zeroed, 0 for none. */
+	void *zeroed[PREZERO_MAX];	/* Pages that are all zeros. */
+	size_t zeroed_cnt;			/* Number of pages in ZEROED. */
+	void *dirty[PREZERO_MAX];	/* Freed pages waiting to be zeroed. */
+	size_t dirty_cnt;			/* Number of pages in DIRTY. */
+	bool zero_wanted;			/* Pre-zeroing thread woken up? */
+	long long zero_hits;		/* PAL_ZERO pages taken from the stock. */
+	long long zero_misses;		/* PAL_ZERO pages that had to be cleared. */
 };
 
 /* Two pools: one for kernel data, one for user pages. */
 static struct pool kernel_pool, user_pool;
 
+/* Physical memory mapped by the page table that start.S builds,
+   128 large pages of 2 MB each.  A free block may lie anywhere in
+   its pool, so until paging_init() maps the rest, the pools only
+   get the pages below this; palloc_init_high() adds the others. */
+#define BOOT_MAP_END ((uint64_t)128 << 21)
+
 /* Maximum number of pages to put in user pool. */
 size_t user_page_limit = SIZE_MAX;
+
+/* Wakes up the pre-zeroing thread. */
+static struct semaphore prezero_sema;
 static void init_pool(struct pool *p, void **bm_base, uint64_t start, uint64_t end);
+static void release_usable(uint64_t lo, uint64_t hi);
 
 static bool page_from_pool(const struct pool *, void *page);
+static size_t buddy_alloc(struct pool *, size_t page_cnt);
+static void buddy_free(struct pool *, size_t page_idx, size_t page_cnt);
+static void buddy_free_block(struct pool *, size_t page_idx, int order);
+static void buddy_push(struct pool *, size_t page_idx, int order);
+static void buddy_unlink(struct pool *, size_t page_idx);
+static void *pool_get(struct pool *, size_t page_cnt);
+static void pool_put(struct pool *, size_t page_idx, size_t page_cnt);
+static void *pcache_get(struct pool *);
+static void pcache_put(struct pool *, void *page);
+static bool pcache_flush(struct pool *);
+static void pcache_refill(struct pool *, struct page_cache *);
+static void pcache_drain(struct pool *, struct page_cache *, size_t page_cnt);
+static void *prezero_get(struct pool *);
+static bool prezero_put_dirty(struct pool *, void *page);
+static bool prezero_flush(struct pool *);
+static void prezero_fill(struct pool *);
+static void prezero_daemon(void *aux);
+static void pool_print_stats(const char *name, struct pool *);
 
 /* multiboot info */
 struct multiboot_info {
@@ -187,11 +298,20 @@ static void populate_pools(struct area *base_mem, struct area *ext_mem)
 	// generate the user pool
 	init_pool(&user_pool, &free_start, region_start, end);
 
-	// Iterate over the e820_entry. Setup the usable.
-	uint64_t usable_bound = (uint64_t)free_start;
+	// Everything below free_start is the kernel or pool metadata.
+	release_usable((uint64_t)free_start, (uint64_t)ptov(BOOT_MAP_END));
+}
+
+/* Hands the usable pages whose kernel virtual addresses lie in
+   [LO, HI) over to the pool that owns each of them. */
+static void release_usable(uint64_t lo, uint64_t hi)
+{
+	struct multiboot_info *mb_info = ptov(MULTIBOOT_INFO);
+	struct e820_entry *entries = ptov(mb_info->mmap_base);
 	struct pool *pool;
 	void *pool_end;
 	size_t page_idx, page_cnt;
+	uint32_t i;
 
 	for (i = 0; i < mb_info->mmap_len / sizeof(struct e820_entry); i++) {
 		struct e820_entry *entry = &entries[i];
@@ -201,11 +321,11 @@ static void populate_pools(struct area *base_mem, struct area *ext_mem)
 			uint64_t end = start + size;
 
 			// TODO: add 0x1000 ~ 0x200000, This is not a matter for now.
-			// All the pages are unuable
-			if (end < usable_bound)
+			if (end > hi)
+				end = hi;
+			start = (uint64_t)pg_round_up(start >= lo ? start : lo);
+			if (start >= end)
 				continue;
-
-			start = (uint64_t)pg_round_up(start >= usable_bound ? start : usable_bound);
 		split:
 			if (page_from_pool(&kernel_pool, (void *)start))
 				pool = &kernel_pool;
@@ -219,11 +339,13 @@ static void populate_pools(struct area *base_mem, struct area *ext_mem)
 			if ((uint64_t)pool_end < end) {
 				page_cnt = ((uint64_t)pool_end - start) / PGSIZE;
 				bitmap_set_multiple(pool->used_map, page_idx, page_cnt, false);
+				buddy_free(pool, page_idx, page_cnt);
 				start = (uint64_t)pool_end;
 				goto split;
 			} else {
 				page_cnt = ((uint64_t)end - start) / PGSIZE;
 				bitmap_set_multiple(pool->used_map, page_idx, page_cnt, false);
+				buddy_free(pool, page_idx, page_cnt);
 			}
 		}
 	}
@@ -245,9 +367,35 @@ uint64_t palloc_init(void)
 	printf("\text_mem: 0x%llx ~ 0x%llx (Usable: %'llu kB)\n", ext_mem.start, ext_mem.end,
 		   ext_mem.size / 1024);
 	populate_pools(&base_mem, &ext_mem);
+	sema_init(&prezero_sema, 0);
 	return ext_mem.end;
 }
 
+/* Hands the memory above BOOT_MAP_END to the pools.  Must be
+   called once paging_init() has mapped all of physical memory. */
+void palloc_init_high(void)
+{
+	enum intr_level old_level = intr_disable();
+	release_usable((uint64_t)ptov(BOOT_MAP_END), UINT64_MAX);
+	intr_set_level(old_level);
+}
+
+/* Starts the thread that keeps a stock of zeroed user pages.
+   Must be called after thread_start(). */
+void palloc_prezero_start(void)
+{
+	size_t target = bitmap_size(user_pool.used_map) / 8;
+	enum intr_level old_level;
+
+	/* The kernel pool gets no stock: its PAL_ZERO requests are
+	   rare and mostly for more than one page. */
+	old_level = intr_disable();
+	user_pool.zero_target = target < PREZERO_MAX ? target : PREZERO_MAX;
+	intr_set_level(old_level);
+
+	thread_create("prezero", PRI_MIN, prezero_daemon, NULL);
+}
+
 /* Obtains and returns a group of PAGE_CNT contiguous free pages.
    If PAL_USER is set, the pages are obtained from the user pool,
    otherwise from the kernel pool.  If PAL_ZERO is set in FLAGS,
@@ -257,16 +405,20 @@ uint64_t palloc_init(void)
 void *palloc_get_multiple(enum palloc_flags flags, size_t page_cnt)
 {
 	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+	void *pages = NULL;
 
-	lock_acquire(&pool->lock);
-	size_t page_idx = bitmap_scan_and_flip(pool->used_map, 0, page_cnt, false);
-	lock_release(&pool->lock);
-	void *pages;
+	if (page_cnt == 1 && (flags & PAL_ZERO) && (pages = prezero_get(pool)) != NULL)
+		return pages;
 
-	if (page_idx != BITMAP_ERROR)
-		pages = pool->base + PGSIZE * page_idx;
+	if (page_cnt == 1)
+		pages = pcache_get(pool);
 	else
-		pages = NULL;
+		pages = pool_get(pool, page_cnt);
+
+	/* The pages in our cache and in the pre-zeroed stock may be
+	   what keeps the pool from coalescing a big enough block. */
+	if (pages == NULL && (pcache_flush(pool) | prezero_flush(pool)))
+		pages = pool_get(pool, page_cnt);
 
 	if (pages) {
 		if (flags & PAL_ZERO)
@@ -310,11 +462,19 @@ void palloc_free_multiple(void *pages, size_t page_cnt)
 
 	page_idx = pg_no(pages) - pg_no(pool->base);
 
+	/* A page that is going to be zeroed anyway need not be
+	   poisoned first. */
+	if (page_cnt == 1 && prezero_put_dirty(pool, pages))
+		return;
+
 #ifndef NDEBUG
 	memset(pages, 0xcc, PGSIZE * page_cnt);
 #endif
-	ASSERT(bitmap_all(pool->used_map, page_idx, page_cnt));
-	bitmap_set_multiple(pool->used_map, page_idx, page_cnt, false);
+	if (page_cnt == 1) {
+		ASSERT(bitmap_test(pool->used_map, page_idx));
+		pcache_put(pool, pages);
+	} else
+		pool_put(pool, page_idx, page_cnt);
 }
 
 /* Frees the page at PAGE. */
@@ -323,23 +483,43 @@ void palloc_free_page(void *page)
 	palloc_free_multiple(page, 1);
 }
 
+/* Prints page allocator statistics: for each pool, how much of
+   it is free, and how fragmented the free memory is. */
+void palloc_print_stats(void)
+{
+	pool_print_stats("Kernel", &kernel_pool);
+	pool_print_stats("User", &user_pool);
+}
+
 /* Initializes pool P as starting at START and ending at END */
 static void init_pool(struct pool *p, void **bm_base, uint64_t start, uint64_t end)
 {
-	/* We'll put the pool's used_map at its base.
-	   Calculate the space needed for the bitmap
-	   and subtract it from the pool's size. */
+	/* We'll put the pool's used_map and buddy bookkeeping at
+	   BM_BASE.  Calculate the space needed for them and
+	   subtract it from the free memory. */
 	uint64_t pgcnt = (end - start) / PGSIZE;
 	size_t bm_pages = DIV_ROUND_UP(bitmap_buf_size(pgcnt), PGSIZE) * PGSIZE;
+	size_t buddy_pages = DIV_ROUND_UP(pgcnt * sizeof *p->pages, PGSIZE) * PGSIZE;
+	size_t i;
+
+	ASSERT(pgcnt < BUDDY_NIL);
 
-	lock_init(&p->lock);
 	p->used_map = bitmap_create_in_buf(pgcnt, *bm_base, bm_pages);
 	p->base = (void *)start;
 
 	// Mark all to unusable.
 	bitmap_set_all(p->used_map, true);
 
-	*bm_base += bm_pages;
+	p->pages = *bm_base + bm_pages;
+	for (i = 0; i < pgcnt; i++)
+		p->pages[i].order = NOT_FREE_HEAD;
+	for (i = 0; i < BUDDY_ORDERS; i++) {
+		p->free_lists[i] = BUDDY_NIL;
+		p->free_blocks[i] = 0;
+	}
+	p->free_cnt = 0;
+
+	*bm_base += bm_pages + buddy_pages;
 }
 
 /* Returns true if PAGE was allocated from POOL,
@@ -351,3 +531,429 @@ static bool page_from_pool(const struct pool *pool, void *page)
 	size_t end_page = start_page + bitmap_size(pool->used_map);
 	return page_no >= start_page && page_no < end_page;
 }
+
+/* Allocates PAGE_CNT contiguous pages directly from POOL and
+   returns the first one, or a null pointer if POOL has no free
+   block big enough. */
+static void *pool_get(struct pool *pool, size_t page_cnt)
+{
+	enum intr_level old_level;
+	size_t page_idx;
+
+	old_level = intr_disable();
+	page_idx = buddy_alloc(pool, page_cnt);
+	if (page_idx != BITMAP_ERROR) {
+		ASSERT(bitmap_none(pool->used_map, page_idx, page_cnt));
+		bitmap_set_multiple(pool->used_map, page_idx, page_cnt, true);
+	}
+	intr_set_level(old_level);
+
+	return page_idx != BITMAP_ERROR ? pool->base + PGSIZE * page_idx : NULL;
+}
+
+/* Returns the PAGE_CNT pages starting at index PAGE_IDX directly
+   to POOL. */
+static void pool_put(struct pool *pool, size_t page_idx, size_t page_cnt)
+{
+	enum intr_level old_level = intr_disable();
+
+	ASSERT(bitmap_all(pool->used_map, page_idx, page_cnt));
+	bitmap_set_multiple(pool->used_map, page_idx, page_cnt, false);
+	buddy_free(pool, page_idx, page_cnt);
+	intr_set_level(old_level);
+}
+
+/* Returns a free page of POOL from its page cache,
+   refilling the cache first if it is empty, or a null pointer if
+   POOL has no free pages left. */
+static void *pcache_get(struct pool *pool)
+{
+	enum intr_level old_level = intr_disable();
+	struct page_cache *c = &pool->cache;
+	void *page = NULL;
+
+	if (c->cnt > 0)
+		c->hits++;
+	else {
+		c->misses++;
+		pcache_refill(pool, c);
+	}
+	if (c->cnt > 0)
+		page = c->pages[--c->cnt];
+	intr_set_level(old_level);
+
+	return page;
+}
+
+/* Puts PAGE, a page of POOL, in POOL's page cache, first
+   draining the oldest pages in the cache to POOL if it is full. */
+static void pcache_put(struct pool *pool, void *page)
+{
+	enum intr_level old_level = intr_disable();
+	struct page_cache *c = &pool->cache;
+
+	if (c->cnt == PCACHE_SIZE)
+		pcache_drain(pool, c, PCACHE_BATCH);
+	c->pages[c->cnt++] = page;
+	intr_set_level(old_level);
+}
+
+/* Returns every page in POOL's page cache to its free lists.
+   Returns true if there were any. */
+static bool pcache_flush(struct pool *pool)
+{
+	enum intr_level old_level = intr_disable();
+	struct page_cache *c = &pool->cache;
+	size_t page_cnt = c->cnt;
+
+	if (page_cnt > 0)
+		pcache_drain(pool, c, page_cnt);
+	intr_set_level(old_level);
+
+	return page_cnt > 0;
+}
+
+/* Moves up to PCACHE_BATCH pages from POOL into its empty page
+   cache C.  A single block is used if the pool still has one, so
+   that the pages are handed out in address order.  Must be
+   called with interrupts off. */
+static void pcache_refill(struct pool *pool, struct page_cache *c)
+{
+	size_t page_idx, i;
+
+	ASSERT(intr_get_level() == INTR_OFF);
+	ASSERT(c->cnt == 0);
+
+	page_idx = buddy_alloc(pool, PCACHE_BATCH);
+	if (page_idx != BITMAP_ERROR) {
+		ASSERT(bitmap_none(pool->used_map, page_idx, PCACHE_BATCH));
+		bitmap_set_multiple(pool->used_map, page_idx, PCACHE_BATCH, true);
+		for (i = PCACHE_BATCH; i-- > 0;)
+			c->pages[c->cnt++] = pool->base + PGSIZE * (page_idx + i);
+	} else {
+		/* Too fragmented for a whole batch: take the pages one
+		   by one. */
+		while (c->cnt < PCACHE_BATCH && (page_idx = buddy_alloc(pool, 1)) != BITMAP_ERROR) {
+			ASSERT(!bitmap_test(pool->used_map, page_idx));
+			bitmap_mark(pool->used_map, page_idx);
+			c->pages[c->cnt++] = pool->base + PGSIZE * page_idx;
+		}
+	}
+
+	if (c->cnt > 0)
+		c->refills++;
+}
+
+/* Returns the PAGE_CNT oldest pages in page cache C to POOL.
+   Must be called with interrupts off. */
+static void pcache_drain(struct pool *pool, struct page_cache *c, size_t page_cnt)
+{
+	size_t i;
+
+	ASSERT(intr_get_level() == INTR_OFF);
+	ASSERT(page_cnt <= c->cnt);
+
+	for (i = 0; i < page_cnt; i++) {
+		size_t page_idx = pg_no(c->pages[i]) - pg_no(pool->base);
+		ASSERT(bitmap_test(pool->used_map, page_idx));
+		bitmap_reset(pool->used_map, page_idx);
+		buddy_free(pool, page_idx, 1);
+	}
+
+	c->cnt -= page_cnt;
+	memmove(c->pages, c->pages + page_cnt, c->cnt * sizeof *c->pages);
+	c->drains++;
+}
+
+/* Returns a page from POOL's pre-zeroed stock, or a null pointer
+   if the stock is empty, waking up the pre-zeroing thread if the
+   stock is running low. */
+static void *prezero_get(struct pool *pool)
+{
+	enum intr_level old_level;
+	void *page = NULL;
+	bool wake = false;
+
+	if (pool->zero_target == 0)
+		return NULL;
+
+	old_level = intr_disable();
+	if (pool->zeroed_cnt > 0) {
+		page = pool->zeroed[--pool->zeroed_cnt];
+		pool->zero_hits++;
+	} else
+		pool->zero_misses++;
+	if (pool->zeroed_cnt < pool->zero_target * 3 / 4 && !pool->zero_wanted)
+		wake = pool->zero_wanted = true;
+	intr_set_level(old_level);
+
+	if (wake)
+		sema_up(&prezero_sema);
+	return page;
+}
+
+/* Sets aside PAGE, a page of POOL being freed, for the
+   pre-zeroing thread if the stock has room for it.  Returns true
+   if so, false if PAGE must be freed normally. */
+static bool prezero_put_dirty(struct pool *pool, void *page)
+{
+	enum intr_level old_level;
+	bool taken = false;
+
+	if (pool->zero_target == 0)
+		return false;
+
+	old_level = intr_disable();
+	if (pool->zeroed_cnt + pool->dirty_cnt < pool->zero_target) {
+		pool->dirty[pool->dirty_cnt++] = page;
+		taken = true;
+	}
+	intr_set_level(old_level);
+
+	return taken;
+}
+
+/* Returns every page in POOL's pre-zeroed stock, zeroed or not,
+   to POOL.  Returns true if there were any. */
+static bool prezero_flush(struct pool *pool)
+{
+	enum intr_level old_level;
+	bool flushed;
+
+	if (pool->zero_target == 0)
+		return false;
+
+	old_level = intr_disable();
+	flushed = pool->zeroed_cnt + pool->dirty_cnt > 0;
+	while (pool->zeroed_cnt > 0)
+		pool_put(pool, pg_no(pool->zeroed[--pool->zeroed_cnt]) - pg_no(pool->base), 1);
+	while (pool->dirty_cnt > 0)
+		pool_put(pool, pg_no(pool->dirty[--pool->dirty_cnt]) - pg_no(pool->base), 1);
+	intr_set_level(old_level);
+
+	return flushed;
+}
+
+/* Zeroes pages until POOL's stock reaches its target, taking
+   the pages set aside by frees first and free pages of POOL
+   after that.  Stops early if POOL runs out of pages. */
+static void prezero_fill(struct pool *pool)
+{
+	enum intr_level old_level;
+
+	old_level = intr_disable();
+	pool->zero_wanted = false;
+	intr_set_level(old_level);
+
+	for (;;) {
+		void *page = NULL;
+
+		old_level = intr_disable();
+		if (pool->zeroed_cnt >= pool->zero_target) {
+			intr_set_level(old_level);
+			break;
+		}
+		if (pool->dirty_cnt > 0)
+			page = pool->dirty[--pool->dirty_cnt];
+		intr_set_level(old_level);
+
+		if (page == NULL && (page = pool_get(pool, 1)) == NULL)
+			break;
+
+		/* Zero the page with interrupts on, so that the page
+		   fault handler never waits for us. */
+		memset(page, 0, PGSIZE);
+
+		old_level = intr_disable();
+		if (pool->zeroed_cnt < pool->zero_target) {
+			pool->zeroed[pool->zeroed_cnt++] = page;
+			page = NULL;
+		}
+		intr_set_level(old_level);
+
+		if (page != NULL) {
+			pool_put(pool, pg_no(page) - pg_no(pool->base), 1);
+			break;
+		}
+	}
+}
+
+/* Pre-zeroing thread.  Runs at the lowest priority, so that it
+   only uses time no other thread wants, and refills the user
+   pool's stock of zeroed pages each time prezero_get() finds it
+   running low.
+
+   Under the MLFQS it waits for its first request before raising
+   its nice value.  Lowering its priority at once would leave it
+   ready behind any busy thread, counted in the load average for
+   as long as that thread runs, although it has nothing to do. */
+static void prezero_daemon(void *aux UNUSED)
+{
+	sema_down(&prezero_sema);
+	if (thread_mlfqs)
+		thread_set_nice(20);
+
+	for (;;) {
+		prezero_fill(&user_pool);
+		sema_down(&prezero_sema);
+	}
+}
+
+/* Takes PAGE_CNT contiguous pages out of POOL's free blocks and
+   returns the index of the first one, or BITMAP_ERROR if there is
+   no free block big enough. */
+static size_t buddy_alloc(struct pool *pool, size_t page_cnt)
+{
+	int order = 0, k;
+	size_t page_idx;
+
+	ASSERT(page_cnt > 0);
+
+	while (order < BUDDY_ORDERS && ((size_t)1 << order) < page_cnt)
+		order++;
+	for (k = order; k < BUDDY_ORDERS; k++)
+		if (pool->free_lists[k] != BUDDY_NIL)
+			break;
+	if (k >= BUDDY_ORDERS)
+		return BITMAP_ERROR;
+
+	page_idx = pool->free_lists[k];
+	buddy_unlink(pool, page_idx);
+	pool->free_cnt -= (size_t)1 << k;
+
+	/* Split off the upper halves until the block fits. */
+	while (k > order) {
+		k--;
+		buddy_push(pool, page_idx + ((size_t)1 << k), k);
+		pool->free_cnt += (size_t)1 << k;
+	}
+
+	/* Give back what we carved out but do not need. */
+	if (((size_t)1 << order) > page_cnt)
+		buddy_free(pool, page_idx + page_cnt, ((size_t)1 << order) - page_cnt);
+	return page_idx;
+}
+
+/* Returns the PAGE_CNT pages starting at index PAGE_IDX to POOL,
+   as the largest aligned blocks that make up the range. */
+static void buddy_free(struct pool *pool, size_t page_idx, size_t page_cnt)
+{
+	while (page_cnt > 0) {
+		int order = 0;
+
+		while (order + 1 < BUDDY_ORDERS && (page_idx & ((size_t)1 << order)) == 0
+			   && ((size_t)2 << order) <= page_cnt)
+			order++;
+
+		buddy_free_block(pool, page_idx, order);
+		page_idx += (size_t)1 << order;
+		page_cnt -= (size_t)1 << order;
+	}
+}
+
+/* Returns the block of 2**ORDER pages starting at PAGE_IDX to
+   POOL, merging it with its buddy for as long as the buddy is
+   free as a whole. */
+static void buddy_free_block(struct pool *pool, size_t page_idx, int order)
+{
+	size_t pgcnt = bitmap_size(pool->used_map);
+
+	pool->free_cnt += (size_t)1 << order;
+	while (order + 1 < BUDDY_ORDERS) {
+		size_t buddy = page_idx ^ ((size_t)1 << order);
+
+		if (buddy + ((size_t)1 << order) > pgcnt || pool->pages[buddy].order != order)
+			break;
+		buddy_unlink(pool, buddy);
+		if (buddy < page_idx)
+			page_idx = buddy;
+		order++;
+	}
+	buddy_push(pool, page_idx, order);
+}
+
+/* Puts the free block of 2**ORDER pages at PAGE_IDX on POOL's
+   free list for ORDER. */
+static void buddy_push(struct pool *pool, size_t page_idx, int order)
+{
+	struct buddy_page *page = &pool->pages[page_idx];
+	uint32_t head = pool->free_lists[order];
+
+	page->order = order;
+	page->prev = BUDDY_NIL;
+	page->next = head;
+	if (head != BUDDY_NIL)
+		pool->pages[head].prev = page_idx;
+	pool->free_lists[order] = page_idx;
+	pool->free_blocks[order]++;
+}
+
+/* Takes the free block at PAGE_IDX off its free list. */
+static void buddy_unlink(struct pool *pool, size_t page_idx)
+{
+	struct buddy_page *page = &pool->pages[page_idx];
+	int order = page->order;
+
+	ASSERT(order != NOT_FREE_HEAD);
+	if (page->prev != BUDDY_NIL)
+		pool->pages[page->prev].next = page->next;
+	else
+		pool->free_lists[order] = page->next;
+	if (page->next != BUDDY_NIL)
+		pool->pages[page->next].prev = page->prev;
+	page->order = NOT_FREE_HEAD;
+	pool->free_blocks[order]--;
+}
+
+/* Prints how many of POOL's pages are free, the free blocks of
+   each order, and what share of the free pages lies outside the
+   largest free block, as a measure of fragmentation.  Then prints
+   how well the page caches and the pre-zeroed stock did. */
+static void pool_print_stats(const char *name, struct pool *pool)
+{
+	size_t free_blocks[BUDDY_ORDERS];
+	size_t free_cnt, largest = 0, cached = 0;
+	struct page_cache *c = &pool->cache;
+	enum intr_level old_level;
+	long long hits, misses;
+	int order, top = -1;
+
+	old_level = intr_disable();
+	memcpy(free_blocks, pool->free_blocks, sizeof free_blocks);
+	free_cnt = pool->free_cnt;
+	intr_set_level(old_level);
+
+	for (order = 0; order < BUDDY_ORDERS; order++)
+		if (free_blocks[order] > 0)
+			top = order;
+	if (top >= 0)
+		largest = (size_t)1 << top;
+
+	printf("%s pool: %zu of %zu pages free, largest free block %zu pages, "
+		   "fragmentation %zu%%\n",
+		   name, free_cnt, bitmap_size(pool->used_map), largest,
+		   free_cnt > 0 ? (free_cnt - largest) * 100 / free_cnt : 0);
+	printf("%s pool: free blocks by order:", name);
+	for (order = 0; order <= top; order++)
+		printf(" %zu", free_blocks[order]);
+	printf("\n");
+
+	hits = c->hits;
+	misses = c->misses;
+	printf("%s pool: page cache: %lld hits, %lld misses (%lld%% hit rate), "
+		   "%lld refills, %lld drains, %zu pages cached\n",
+		   name, hits, misses, hits + misses > 0 ? hits * 100 / (hits + misses) : 0, c->refills,
+		   c->drains, c->cnt);
+
+	if (pool->zero_target > 0) {
+		old_level = intr_disable();
+		hits = pool->zero_hits;
+		misses = pool->zero_misses;
+		cached = pool->zeroed_cnt;
+		intr_set_level(old_level);
+		printf("%s pool: pre-zeroed: %lld hits, %lld misses (%lld%% hit rate), "
+			   "%zu of %zu pages ready\n",
+			   name, hits, misses, hits + misses > 0 ? hits * 100 / (hits + misses) : 0, cached,
+			   pool->zero_target);
+	}
+}
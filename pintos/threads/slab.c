@@ -0,0 +1,395 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* Slab allocator.
+
+   An object cache hands out objects of a single size, such as
+   every `struct page' of the VM system.  Unlike malloc(), which
+   rounds each request up to a power of 2, a cache packs its
+   objects into pages, called "slabs", at their exact size
+   (rounded up only to KMEM_ALIGN), so a 136-byte object takes
+   136 bytes and not 256.
+
+   Each slab is one page from the kernel pool.  It begins with a
+   header that records the cache it belongs to and a stack of
+   the indexes of its free objects, followed by the objects.  The
+   free stack is kept in the header, not in the free objects, so
+   a freed object keeps whatever state it was left in.  That is
+   what makes constructors work: a cache with a constructor runs
+   it once on each object when it creates a slab, and from then
+   on hands out objects in their constructed state, which the
+   caller must restore before freeing them.
+
+   Whatever room is left over in a slab is used to "color" it:
+   successive slabs start their objects at different multiples
+   of KMEM_COLOR_STEP bytes, so that the same object in different
+   slabs does not always map to the same cache lines.
+
+   A cache keeps its slabs on three lists, for slabs with no,
+   some, and only free objects.  Empty slabs beyond KMEM_EMPTY_MAX
+   are given back to the page allocator.  In front of the slabs,
+   each cache keeps a small stack of free objects, which it
+   refills from and drains to the slabs KMEM_STACK_BATCH objects
+   at a time, so that most allocations and frees are a push or a
+   pop.
+
+   Caches are only touched with interrupts off, so objects may be
+   freed with interrupts already off, e.g. while a dying thread
+   is being destroyed. */
+
+/* Alignment of objects. */
+#define KMEM_ALIGN 8
+
+/* Distance between slab colors.  One cache line. */
+#define KMEM_COLOR_STEP 64
+
+/* Largest object size a cache supports. */
+#define KMEM_MAX_SIZE (PGSIZE / 4)
+
+/* Maximum number of objects in a cache's stack. */
+#define KMEM_STACK_SIZE 16
+
+/* Number of objects moved between a cache's stack and its slabs
+   at once. */
+#define KMEM_STACK_BATCH 8
+
+/* Number of empty slabs a cache keeps. */
+#define KMEM_EMPTY_MAX 1
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab0bec
+
+/* Slab header, at the start of each slab's page. */
+struct slab {
+	unsigned magic;			  /* Always set to SLAB_MAGIC. */
+	struct kmem_cache *cache; /* Owning cache. */
+	struct list_elem elem;	  /* Element in one of the cache's slab lists. */
+	uint8_t *objs;			  /* First object. */
+	uint16_t free_cnt;		  /* Number of free objects. */
+	uint16_t free[];		  /* Indexes of the free objects. */
+};
+
+/* Stack of free objects in front of a cache's slabs.  Its
+   objects count as in use in the slabs. */
+struct kmem_stack {
+	size_t cnt;					 /* Number of objects in OBJS. */
+	void *objs[KMEM_STACK_SIZE]; /* Free objects, most recently freed last. */
+	long long hits;				/* Allocations served from OBJS. */
+	long long misses;			/* Allocations that found OBJS empty. */
+};
+
+/* Object cache. */
+struct kmem_cache {
+	const char *name;	  /* Name, for statistics. */
+	size_t obj_size;	  /* Object size requested. */
+	size_t size;		  /* Object size, rounded up to KMEM_ALIGN. */
+	size_t objs_per_slab; /* Number of objects in a slab. */
+	size_t hdr_size;	  /* Size of a slab header. */
+	size_t color_cnt;	  /* Number of distinct colors. */
+	size_t next_color;	  /* Color of the next slab. */
+	kmem_ctor *ctor;	  /* Constructor, or null. */
+
+	struct list full;	  /* Slabs with no free objects. */
+	struct list partial;  /* Slabs with some free objects. */
+	struct list empty;	  /* Slabs with only free objects. */
+	size_t slab_cnt;	  /* Number of slabs. */
+	size_t empty_cnt;	  /* Number of slabs in EMPTY. */
+	size_t inuse;		  /* Objects not free in their slabs. */
+
+	struct list_elem elem;	  /* Element in all_caches. */
+	struct kmem_stack stack; /* Free objects in front of the slabs. */
+};
+
+/* Every cache, for statistics. */
+static struct list all_caches;
+
+static size_t slab_hdr_size(size_t objs_per_slab);
+static struct slab *slab_create(struct kmem_cache *);
+static struct slab *obj_to_slab(void *obj);
+static void *slab_get(struct kmem_cache *, struct slab *);
+static void slab_put(struct kmem_cache *, struct slab *, void *obj);
+static void kmem_refill(struct kmem_cache *, struct kmem_stack *);
+static void kmem_drain(struct kmem_cache *, struct kmem_stack *, size_t cnt);
+
+/* Initializes the slab allocator. */
+void kmem_init(void)
+{
+	list_init(&all_caches);
+}
+
+/* Creates and returns a cache of objects of SIZE bytes, which
+   must be at most KMEM_MAX_SIZE.  If CTOR is nonnull, each
+   object is constructed by calling CTOR once, before the cache
+   first hands it out.  NAME identifies the cache in statistics
+   and must stay valid.  Panics if memory is not available, since
+   caches are created during initialization. */
+struct kmem_cache *kmem_cache_create(const char *name, size_t size, kmem_ctor *ctor)
+{
+	struct kmem_cache *c;
+	enum intr_level old_level;
+	size_t n, leftover;
+
+	ASSERT(name != NULL);
+	ASSERT(size > 0 && size <= KMEM_MAX_SIZE);
+
+	c = calloc(1, sizeof *c);
+	if (c == NULL)
+		PANIC("kmem_cache_create: out of memory");
+
+	c->name = name;
+	c->obj_size = size;
+	c->size = ROUND_UP(size, KMEM_ALIGN);
+	c->ctor = ctor;
+
+	/* Fit as many objects as we can beside their header, then
+	   spread what is left over across the colors. */
+	n = (PGSIZE - sizeof(struct slab)) / (c->size + sizeof(uint16_t));
+	while (slab_hdr_size(n) + n * c->size > PGSIZE)
+		n--;
+	ASSERT(n > 0);
+	c->objs_per_slab = n;
+	c->hdr_size = slab_hdr_size(n);
+	leftover = PGSIZE - c->hdr_size - n * c->size;
+	c->color_cnt = leftover / KMEM_COLOR_STEP + 1;
+
+	list_init(&c->full);
+	list_init(&c->partial);
+	list_init(&c->empty);
+
+	old_level = intr_disable();
+	list_push_back(&all_caches, &c->elem);
+	intr_set_level(old_level);
+
+	return c;
+}
+
+/* Obtains and returns an object from cache C, or a null pointer
+   if memory is not available. */
+void *kmem_cache_alloc(struct kmem_cache *c)
+{
+	enum intr_level old_level = intr_disable();
+	struct kmem_stack *st = &c->stack;
+	void *obj = NULL;
+
+	if (st->cnt > 0)
+		st->hits++;
+	else {
+		st->misses++;
+		kmem_refill(c, st);
+	}
+	if (st->cnt > 0)
+		obj = st->objs[--st->cnt];
+	intr_set_level(old_level);
+
+	return obj;
+}
+
+/* Obtains an object from cache C, which must not have a
+   constructor, and fills it with zeros.  Returns a null pointer
+   if memory is not available. */
+void *kmem_cache_zalloc(struct kmem_cache *c)
+{
+	void *obj;
+
+	ASSERT(c->ctor == NULL);
+
+	obj = kmem_cache_alloc(c);
+	if (obj != NULL)
+		memset(obj, 0, c->obj_size);
+	return obj;
+}
+
+/* Returns OBJ, which must have been obtained from cache C, to C.
+   A null OBJ is ignored. */
+void kmem_cache_free(struct kmem_cache *c, void *obj)
+{
+	enum intr_level old_level;
+	struct kmem_stack *st = &c->stack;
+
+	if (obj == NULL)
+		return;
+	ASSERT(obj_to_slab(obj)->cache == c);
+
+#ifndef NDEBUG
+	/* Clear the object to help detect use-after-free bugs, unless
+	   it must keep its constructed state. */
+	if (c->ctor == NULL)
+		memset(obj, 0xcc, c->size);
+#endif
+
+	old_level = intr_disable();
+	if (st->cnt == KMEM_STACK_SIZE)
+		kmem_drain(c, st, KMEM_STACK_BATCH);
+	st->objs[st->cnt++] = obj;
+	intr_set_level(old_level);
+}
+
+/* Prints, for each cache, how many objects are in use and how
+   much memory its slabs take, next to what the same objects
+   would take as malloc() blocks, which are sized to a power of 2
+   of at least 16 bytes. */
+void kmem_print_stats(void)
+{
+	enum intr_level old_level;
+	struct list_elem *e;
+
+	old_level = intr_disable();
+	for (e = list_begin(&all_caches); e != list_end(&all_caches); e = list_next(e)) {
+		struct kmem_cache *c = list_entry(e, struct kmem_cache, elem);
+		size_t inuse = c->inuse - c->stack.cnt, malloc_size = 16;
+		long long hits = c->stack.hits, misses = c->stack.misses;
+
+		while (malloc_size < c->obj_size)
+			malloc_size *= 2;
+
+		printf("Slab %s: %zu objects of %zu bytes in %zu slabs (%zu kB), "
+			   "%zu kB as %zu-byte malloc blocks, %lld%% stack hit rate\n",
+			   c->name, inuse, c->obj_size, c->slab_cnt, c->slab_cnt * PGSIZE / 1024,
+			   inuse * malloc_size / 1024, malloc_size,
+			   hits + misses > 0 ? hits * 100 / (hits + misses) : 0);
+	}
+	intr_set_level(old_level);
+}
+
+/* Returns the size of the header of a slab with OBJS_PER_SLAB
+   objects. */
+static size_t slab_hdr_size(size_t objs_per_slab)
+{
+	return ROUND_UP(sizeof(struct slab) + objs_per_slab * sizeof(uint16_t), KMEM_ALIGN);
+}
+
+/* Allocates a new slab for cache C, with all of its objects free
+   and constructed, or returns a null pointer if memory is not
+   available.  The slab is not yet on any list. */
+static struct slab *slab_create(struct kmem_cache *c)
+{
+	struct slab *s = palloc_get_page(0);
+	enum intr_level old_level;
+	size_t color, i;
+
+	if (s == NULL)
+		return NULL;
+
+	old_level = intr_disable();
+	color = c->next_color;
+	c->next_color = (c->next_color + 1) % c->color_cnt;
+	intr_set_level(old_level);
+
+	s->magic = SLAB_MAGIC;
+	s->cache = c;
+	s->objs = (uint8_t *)s + c->hdr_size + color * KMEM_COLOR_STEP;
+	s->free_cnt = c->objs_per_slab;
+	for (i = 0; i < c->objs_per_slab; i++) {
+		/* Hand out the objects in address order. */
+		s->free[i] = c->objs_per_slab - 1 - i;
+		if (c->ctor != NULL)
+			c->ctor(s->objs + i * c->size);
+	}
+	return s;
+}
+
+/* Returns the slab that OBJ is in. */
+static struct slab *obj_to_slab(void *obj)
+{
+	struct slab *s = pg_round_down(obj);
+
+	/* Check that the slab is valid and that OBJ is one of its
+	   objects. */
+	ASSERT(s != NULL);
+	ASSERT(s->magic == SLAB_MAGIC);
+	ASSERT((uint8_t *)obj >= s->objs);
+	ASSERT(((uint8_t *)obj - s->objs) % s->cache->size == 0);
+
+	return s;
+}
+
+/* Takes a free object out of slab S of cache C, moving S to the
+   list that fits its new state.  Interrupts must be off. */
+static void *slab_get(struct kmem_cache *c, struct slab *s)
+{
+	void *obj;
+
+	ASSERT(s->free_cnt > 0);
+
+	if (s->free_cnt == c->objs_per_slab)
+		c->empty_cnt--;
+	obj = s->objs + s->free[--s->free_cnt] * c->size;
+	c->inuse++;
+
+	list_remove(&s->elem);
+	list_push_front(s->free_cnt > 0 ? &c->partial : &c->full, &s->elem);
+	return obj;
+}
+
+/* Puts OBJ back into its slab S of cache C, moving S to the list
+   that fits its new state, or freeing S if C already has enough
+   empty slabs.  Interrupts must be off. */
+static void slab_put(struct kmem_cache *c, struct slab *s, void *obj)
+{
+	ASSERT(s->free_cnt < c->objs_per_slab);
+
+	s->free[s->free_cnt++] = ((uint8_t *)obj - s->objs) / c->size;
+	c->inuse--;
+
+	list_remove(&s->elem);
+	if (s->free_cnt < c->objs_per_slab)
+		list_push_front(&c->partial, &s->elem);
+	else if (c->empty_cnt < KMEM_EMPTY_MAX) {
+		list_push_front(&c->empty, &s->elem);
+		c->empty_cnt++;
+	} else {
+		c->slab_cnt--;
+		palloc_free_page(s);
+	}
+}
+
+/* Moves up to KMEM_STACK_BATCH objects from cache C's slabs into
+   its empty stack ST, creating a slab if C has no free objects.
+   Partly used slabs go first, so that empty slabs can be given
+   back.  Must be called with interrupts off. */
+static void kmem_refill(struct kmem_cache *c, struct kmem_stack *st)
+{
+	ASSERT(intr_get_level() == INTR_OFF);
+	ASSERT(st->cnt == 0);
+
+	if (list_empty(&c->partial) && list_empty(&c->empty)) {
+		struct slab *s = slab_create(c);
+		if (s == NULL)
+			return;
+		list_push_front(&c->empty, &s->elem);
+		c->slab_cnt++;
+		c->empty_cnt++;
+	}
+
+	while (st->cnt < KMEM_STACK_BATCH) {
+		struct list *slabs = !list_empty(&c->partial) ? &c->partial : &c->empty;
+		if (list_empty(slabs))
+			break;
+		st->objs[st->cnt++] = slab_get(c, list_entry(list_front(slabs), struct slab, elem));
+	}
+}
+
+/* Returns the CNT oldest objects in stack ST to cache C's slabs.
+   Must be called with interrupts off. */
+static void kmem_drain(struct kmem_cache *c, struct kmem_stack *st, size_t cnt)
+{
+	size_t i;
+
+	ASSERT(intr_get_level() == INTR_OFF);
+	ASSERT(cnt <= st->cnt);
+
+	for (i = 0; i < cnt; i++)
+		slab_put(c, obj_to_slab(st->objs[i]), st->objs[i]);
+
+	st->cnt -= cnt;
+	memmove(st->objs, st->objs + cnt, st->cnt * sizeof *st->objs);
+}
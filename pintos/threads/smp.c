@@ -0,0 +1,401 @@
+#include "threads/smp.h"
+
+#include <debug.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "devices/lapic.h"
+#include "devices/timer.h"
+#include "intrinsic.h"
+#include "threads/interrupt.h"
+#include "threads/loader.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#ifdef USERPROG
+#include "userprog/gdt.h"
+#include "userprog/syscall.h"
+#include "userprog/tss.h"
+#endif
+
+/* Symmetric multiprocessing.
+
+   At boot only the bootstrap processor (BSP) runs.  smp_init()
+   finds the other CPUs, the application processors (APs), in the
+   BIOS's MP configuration table and starts each of them with an
+   INIT and two start-up IPIs.  An AP starts in real mode at
+   AP_TRAMPOLINE (see ap-start.S), which brings it to long mode
+   and calls ap_main() on the stack of the AP's idle thread.  From
+   then on each CPU schedules threads from a run queue of its own
+   (see thread.c).
+
+   The rest of the kernel was written for one CPU, where turning
+   interrupts off is enough to keep its data consistent.  So it
+   runs under a single kernel lock: a CPU takes the lock whenever
+   it enters the kernel, through an interrupt or a system call,
+   and gives it up when it returns to user mode or halts in its
+   idle loop.  User processes run in parallel with each other and
+   with the kernel, but only one CPU at a time runs kernel code.
+
+   With one CPU, smp_init() finds nothing to start, the kernel
+   lock is never enabled, and the kernel runs as it always did.
+
+   See [MP] for the MP configuration table and [IA32-v3a] 8.4
+   "Multiple-Processor (MP) Initialization" for the start-up. */
+
+/* The CPUs that are running, cpus[0] being the BSP. */
+struct cpu cpus[CPU_MAX];
+int cpu_cnt = 1;
+
+/* The kernel lock, taken only once smp_init() starts an AP. */
+static struct spinlock kernel_lock;
+static bool kernel_lock_enabled;
+
+/* Bumped whenever a kernel mapping is removed.  A CPU flushes its
+   TLB on taking the kernel lock if it has not seen the latest
+   generation, since it may hold a stale entry for the mapping. */
+static uint64_t kernel_tlb_gen;
+
+/* Initial stack pointer of the AP being started (ap-start.S). */
+void *ap_boot_stack;
+
+/* AP start-up code, copied to AP_TRAMPOLINE (ap-start.S). */
+extern const char ap_start[], ap_start_end[];
+
+/* MP floating pointer structure.  See [MP] 4.1. */
+struct mp_fp {
+	char signature[4]; /* "_MP_". */
+	uint32_t config;   /* Physical address of the configuration table. */
+	uint8_t length;	   /* In 16-byte units. */
+	uint8_t revision;
+	uint8_t checksum;
+	uint8_t type; /* Nonzero for a default configuration. */
+	uint8_t features[4];
+} __attribute__((packed));
+
+/* MP configuration table header.  See [MP] 4.2. */
+struct mp_config {
+	char signature[4]; /* "PCMP". */
+	uint16_t length;   /* Of the base table, in bytes. */
+	uint8_t revision;
+	uint8_t checksum;
+	char oem_id[8];
+	char product_id[12];
+	uint32_t oem_table;
+	uint16_t oem_table_size;
+	uint16_t entry_cnt;
+	uint32_t lapic_addr; /* Physical address of the local APICs. */
+	uint16_t ext_length;
+	uint8_t ext_checksum;
+	uint8_t reserved;
+} __attribute__((packed));
+
+/* MP configuration table processor entry.  See [MP] 4.3.1.
+   The table's other entries are all 8 bytes long. */
+#define MP_PROCESSOR 0
+#define MP_ENTRY_SIZE 8
+struct mp_processor {
+	uint8_t type; /* MP_PROCESSOR. */
+	uint8_t lapic_id;
+	uint8_t lapic_version;
+	uint8_t flags; /* MP_ENABLED, MP_BSP. */
+	uint32_t signature;
+	uint32_t features;
+	uint32_t reserved[2];
+} __attribute__((packed));
+
+#define MP_ENABLED 0x01 /* Processor is usable. */
+#define MP_BSP 0x02		/* Processor is the BSP. */
+
+static struct mp_config *mp_find_config(void);
+static bool start_ap(struct cpu *, uint8_t lapic_id);
+static void flush_tlb(struct cpu *);
+static intr_handler_func reschedule_interrupt;
+static intr_handler_func tick_interrupt;
+
+/* Returns the CPU this code runs on, which is the CPU of the
+   running thread.  A thread only moves to another CPU while it
+   is not running. */
+struct cpu *this_cpu(void)
+{
+	struct thread *t = (struct thread *)pg_round_down(rrsp());
+	return t->cpu;
+}
+
+/* Starts the other CPUs listed in the MP configuration table, if
+   any.  Must be called after the timer is calibrated, since the
+   start-up protocol is timed, and before any user process
+   runs. */
+void smp_init(void)
+{
+	struct mp_config *config = mp_find_config();
+	uint8_t ap_ids[CPU_MAX - 1];
+	int ap_cnt = 0;
+	enum intr_level old_level;
+	uint8_t *entry;
+
+	if (config == NULL)
+		return;
+
+	entry = (uint8_t *)(config + 1);
+	for (int i = 0; i < config->entry_cnt; i++) {
+		if (*entry == MP_PROCESSOR) {
+			struct mp_processor *proc = (struct mp_processor *)entry;
+			if ((proc->flags & (MP_ENABLED | MP_BSP)) == MP_ENABLED && ap_cnt < CPU_MAX - 1)
+				ap_ids[ap_cnt++] = proc->lapic_id;
+			entry += sizeof *proc;
+		} else
+			entry += MP_ENTRY_SIZE;
+	}
+	if (ap_cnt == 0)
+		return;
+
+	lapic_map(config->lapic_addr);
+	lapic_init(true);
+	cpus[0].lapic_id = lapic_id();
+	cpus[0].started = true;
+	intr_register_ipi(IPI_RESCHEDULE, reschedule_interrupt, "IPI reschedule");
+	intr_register_ipi(IPI_TICK, tick_interrupt, "IPI tick");
+	memcpy(ptov(AP_TRAMPOLINE), ap_start, ap_start_end - ap_start);
+
+	/* The other CPUs get their ticks from the BSP's timer, so it
+	   must keep ticking while the BSP is idle. */
+	timer_tickless = false;
+
+	old_level = intr_disable();
+	kernel_lock_enabled = true;
+	kernel_lock_acquire();
+	intr_set_level(old_level);
+
+	for (int i = 0; i < ap_cnt && cpu_cnt < CPU_MAX; i++)
+		if (start_ap(&cpus[cpu_cnt], ap_ids[i]))
+			cpu_cnt++;
+	printf("SMP: %d CPUs online.\n", cpu_cnt);
+}
+
+/* Returns true if the LEN bytes at P sum to zero. */
+static bool checksum_ok(const void *p, size_t len)
+{
+	const uint8_t *b = p;
+	uint8_t sum = 0;
+
+	while (len-- > 0)
+		sum += *b++;
+	return sum == 0;
+}
+
+/* Looks for the MP floating pointer structure in the LEN bytes
+   at physical address PADDR.  Returns it, or a null pointer if it
+   is not there. */
+static struct mp_fp *mp_search(uint64_t paddr, size_t len)
+{
+	uint8_t *p = ptov(paddr);
+	uint8_t *end = p + len;
+
+	for (; p + sizeof(struct mp_fp) <= end; p += 16)
+		if (!memcmp(p, "_MP_", 4) && checksum_ok(p, sizeof(struct mp_fp)))
+			return (struct mp_fp *)p;
+	return NULL;
+}
+
+/* Returns the MP configuration table, or a null pointer if the
+   BIOS provides none (as on a machine with one CPU).  The
+   floating pointer structure that locates it is in the first KB
+   of the extended BIOS data area, in the last KB of base memory,
+   or in the BIOS ROM between 0xf0000 and 0xfffff. */
+static struct mp_config *mp_find_config(void)
+{
+	uint8_t *bda = ptov(0x400);
+	uint64_t ebda = (uint64_t) * (uint16_t *)(bda + 0x0e) << 4;
+	uint64_t base_kb = *(uint16_t *)(bda + 0x13);
+	struct mp_fp *fp = NULL;
+	struct mp_config *config;
+
+	if (ebda != 0)
+		fp = mp_search(ebda, 1024);
+	if (fp == NULL && base_kb != 0)
+		fp = mp_search(base_kb * 1024 - 1024, 1024);
+	if (fp == NULL)
+		fp = mp_search(0xf0000, 0x10000);
+	if (fp == NULL || fp->config == 0)
+		return NULL;
+
+	config = ptov(fp->config);
+	if (memcmp(config->signature, "PCMP", 4) || !checksum_ok(config, config->length))
+		return NULL;
+	return config;
+}
+
+/* Starts the AP whose local APIC ID is LAPIC_ID as CPU C, and
+   waits for it to come up.  Returns true if it did. */
+static bool start_ap(struct cpu *c, uint8_t lapic_id)
+{
+	struct thread *idle;
+
+	c->id = c - cpus;
+	c->lapic_id = lapic_id;
+	idle = thread_init_ap(c);
+	ap_boot_stack = (uint8_t *)idle + PGSIZE;
+
+	/* INIT, then two start-up IPIs, as [MP] B.4 prescribes.  A
+	   CPU that is already up ignores the second one.  Sleeping
+	   lets our idle thread drop the kernel lock for the AP. */
+	lapic_send_init(lapic_id);
+	timer_msleep(10);
+	lapic_send_startup(lapic_id, AP_TRAMPOLINE);
+	timer_usleep(200);
+	lapic_send_startup(lapic_id, AP_TRAMPOLINE);
+
+	for (int ms = 0; !c->started && ms < 1000; ms += 10)
+		timer_msleep(10);
+	if (!c->started) {
+		printf("SMP: CPU with local APIC ID %d did not start.\n", lapic_id);
+		return false;
+	}
+	return true;
+}
+
+/* Called by ap-start.S, with interrupts off, on each AP as it
+   starts up, on the stack of its idle thread.  Sets up the CPU
+   as main() does the BSP and starts scheduling. */
+void ap_main(void)
+{
+	struct cpu *c = this_cpu();
+
+	lcr0(rcr0() | CR0_WP);
+	lapic_init(false);
+	kernel_lock_acquire();
+#ifdef USERPROG
+	tss_init();
+	gdt_init();
+	syscall_init_ap();
+#endif
+	intr_init_ap();
+	c->started = true;
+	thread_start_ap();
+}
+
+/* Sends interrupt VEC to CPU C. */
+void smp_send_ipi(struct cpu *c, uint8_t vec)
+{
+	lapic_send_ipi(c->lapic_id, vec);
+}
+
+/* Makes the other CPUs that are using PML4 drop their TLB
+   entries for it, and waits until they have.  The caller has
+   already changed PML4 and flushed its own TLB as needed.  Must
+   be called with the kernel lock held, which keeps the other
+   CPUs from switching page tables meanwhile. */
+void smp_flush_tlb(uint64_t *pml4 UNUSED)
+{
+#ifdef USERPROG
+	struct cpu *self;
+	int i;
+
+	if (cpu_cnt == 1)
+		return;
+	ASSERT(kernel_lock_held());
+
+	self = this_cpu();
+	for (i = 0; i < cpu_cnt; i++)
+		if (&cpus[i] != self && cpus[i].curr->pml4 == pml4) {
+			cpus[i].flush_pending = true;
+			smp_send_ipi(&cpus[i], IPI_TLB_FLUSH);
+		}
+	for (i = 0; i < cpu_cnt; i++)
+		while (cpus[i].flush_pending)
+			asm volatile("pause");
+#endif
+}
+
+/* Notes that a kernel mapping was removed.  The caller has
+   flushed it from its own TLB; the other CPUs flush theirs the
+   next time they enter the kernel, which is the only place they
+   could use it. */
+void smp_flush_kernel_tlb(void)
+{
+	if (cpu_cnt == 1)
+		return;
+	ASSERT(kernel_lock_held());
+
+	this_cpu()->kernel_tlb_gen = ++kernel_tlb_gen;
+}
+
+/* Handles IPI_TLB_FLUSH.  Called by intr_handler() without the
+   kernel lock, since the CPU that sent it holds the lock while it
+   waits for us. */
+void smp_flush_tlb_ipi(void)
+{
+	flush_tlb(this_cpu());
+	lapic_eoi();
+}
+
+/* Flushes CPU C's TLB, which must be this CPU's, and reports it
+   done to a CPU waiting in smp_flush_tlb(). */
+static void flush_tlb(struct cpu *c)
+{
+	c->kernel_tlb_gen = kernel_tlb_gen;
+	lcr3(rcr3());
+	barrier();
+	c->flush_pending = false;
+}
+
+/* Acquires the kernel lock for this CPU, waiting for the CPU that
+   holds it to leave the kernel.  Does nothing if this CPU already
+   holds it, or if there is only one CPU. */
+void kernel_lock_acquire(void)
+{
+	enum intr_level old_level;
+	struct cpu *c;
+
+	if (!kernel_lock_enabled)
+		return;
+
+	old_level = intr_disable();
+	c = this_cpu();
+	if (!spinlock_held_by_current_cpu(&kernel_lock)) {
+		while (!spinlock_try_acquire(&kernel_lock)) {
+			/* The holder may be in smp_flush_tlb(), waiting for
+			   us with our interrupts off. */
+			if (c->flush_pending)
+				flush_tlb(c);
+			asm volatile("pause");
+		}
+		if (c->kernel_tlb_gen != kernel_tlb_gen)
+			flush_tlb(c);
+	}
+	intr_set_level(old_level);
+}
+
+/* Releases the kernel lock, which this CPU must hold, as it
+   leaves the kernel.  Interrupts must be off, or one could take
+   the lock back before we are out. */
+void kernel_lock_release(void)
+{
+	if (!kernel_lock_enabled)
+		return;
+
+	ASSERT(intr_get_level() == INTR_OFF);
+	spinlock_release(&kernel_lock);
+}
+
+/* Returns true if this CPU may run kernel code: it holds the
+   kernel lock, or there is no kernel lock. */
+bool kernel_lock_held(void)
+{
+	return !kernel_lock_enabled || spinlock_held_by_current_cpu(&kernel_lock);
+}
+
+/* IPI_RESCHEDULE handler.  Another CPU queued a thread for us
+   that should run before the current one. */
+static void reschedule_interrupt(struct intr_frame *f UNUSED)
+{
+	intr_yield_on_return();
+}
+
+/* IPI_TICK handler.  The BSP's timer ticked. */
+static void tick_interrupt(struct intr_frame *f UNUSED)
+{
+	thread_tick();
+}
@@ -31,15 +31,32 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "intrinsic.h"
 #include "threads/interrupt.h"
+#include "threads/slab.h"
+#include "threads/smp.h"
 #include "threads/thread.h"
 
-#define MAX_DEPTH 8
+/* Donated priority of a lock or rwlock that nobody waits for. */
+#define NO_DONATION (PRI_MIN - 1)
 
-static bool cond_insert_by_priority(struct list_elem *current, struct list_elem *e2,
-									void *aux UNUSED);
-static bool donor_higher_priority(struct list_elem *e1, struct list_elem *e2, void *aux UNUSED);
-static bool cond_sema_priority(struct list_elem *a, struct list_elem *b, void *aux UNUSED);
+/* Adding these to semaphore.state adjusts value or waiting. */
+#define SEMA_VALUE_ONE ((uint64_t)1)
+#define SEMA_WAITING_ONE ((uint64_t)1 << 32)
+
+/* Set in lock.holder while threads wait for the lock. */
+#define LOCK_WAITERS ((uintptr_t)1)
+
+static bool sema_fast_down(struct semaphore *sema);
+static bool sema_fast_up(struct semaphore *sema);
+static void sema_state_add(struct semaphore *sema, uint64_t delta);
+static void sema_wait(struct semaphore *sema);
+
+static int lock_donated_priority(const struct lock *lock);
+static void lock_update_donation(struct lock *lock);
+static void set_donation(struct thread *t, struct waitq_elem *e, int priority);
+static void refresh_priority(struct thread *t);
+static void rwlock_update_donations(struct rwlock *rw);
 
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
@@ -55,7 +72,8 @@ void sema_init(struct semaphore *sema, unsigned value)
 	ASSERT(sema != NULL);
 
 	sema->value = value;
-	list_init(&sema->waiters);
+	sema->waiting = 0;
+	waitq_init(&sema->waiters);
 }
 
 /* Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -73,12 +91,12 @@ void sema_down(struct semaphore *sema)
 	ASSERT(sema != NULL);
 	ASSERT(!intr_context());
 
+	if (sema_fast_down(sema))
+		return;
+
 	old_level = intr_disable();
-	while (sema->value == 0) {
-		list_push_front(&sema->waiters, &thread_current()->elem);
-		thread_block();
-	}
-	sema->value--;
+	sema_state_add(sema, SEMA_WAITING_ONE);
+	sema_wait(sema);
 	intr_set_level(old_level);
 }
 
@@ -89,20 +107,9 @@ void sema_down(struct semaphore *sema)
    This function may be called from an interrupt handler. */
 bool sema_try_down(struct semaphore *sema)
 {
-	enum intr_level old_level;
-	bool success;
-
 	ASSERT(sema != NULL);
 
-	old_level = intr_disable();
-	if (sema->value > 0) {
-		sema->value--;
-		success = true;
-	} else
-		success = false;
-	intr_set_level(old_level);
-
-	return success;
+	return sema_fast_down(sema);
 }
 
 /* Up or "V" operation on a semaphore.  Increments SEMA's value
@@ -115,17 +122,86 @@ void sema_up(struct semaphore *sema)
 
 	ASSERT(sema != NULL);
 
+	if (sema_fast_up(sema))
+		return;
+
 	old_level = intr_disable();
-	sema->value++;
-	if (!list_empty(&sema->waiters)) {
-		struct list_elem *max_elem = list_max(&sema->waiters, thread_priority_max, NULL);
-		list_remove(max_elem);
-		thread_unblock(list_entry(max_elem, struct thread, elem));
-	}
+	sema_state_add(sema, SEMA_VALUE_ONE);
+	if (!waitq_empty(&sema->waiters))
+		thread_unblock(waitq_pop(&sema->waiters)->thread);
 
 	intr_set_level(old_level);
 }
 
+/* Decrements SEMA's value if it is positive, without touching
+   the interrupt level or the wait list.  Returns true if
+   successful, false if the value was 0. */
+static bool sema_fast_down(struct semaphore *sema)
+{
+	volatile uint64_t *state = &sema->state;
+	uint64_t old = *state;
+
+	while ((uint32_t)old != 0) {
+		uint64_t prev = cmpxchg(state, old, old - SEMA_VALUE_ONE);
+		if (prev == old)
+			return true;
+		old = prev;
+	}
+	return false;
+}
+
+/* Increments SEMA's value if no thread is in the slow path of
+   sema_down(), so that there is nobody to wake up.  Returns true
+   if successful, false if the caller has to take the slow path. */
+static bool sema_fast_up(struct semaphore *sema)
+{
+	volatile uint64_t *state = &sema->state;
+	uint64_t old = *state;
+
+	while ((old >> 32) == 0) {
+		uint64_t prev = cmpxchg(state, old, old + SEMA_VALUE_ONE);
+		if (prev == old)
+			return true;
+		old = prev;
+	}
+	return false;
+}
+
+/* Atomically adds DELTA to SEMA's combined state word. */
+static void sema_state_add(struct semaphore *sema, uint64_t delta)
+{
+	volatile uint64_t *state = &sema->state;
+	uint64_t old = *state;
+	uint64_t prev;
+
+	while ((prev = cmpxchg(state, old, old + delta)) != old)
+		old = prev;
+}
+
+/* Slow path of sema_down().  The current thread must already be
+   counted in SEMA's waiting count, and interrupts must be off.
+   Sleeps until the value is positive, then decrements both the
+   value and the waiting count in one step. */
+static void sema_wait(struct semaphore *sema)
+{
+	volatile uint64_t *state = &sema->state;
+
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	for (;;) {
+		uint64_t old = *state;
+		ASSERT((old >> 32) != 0);
+
+		if ((uint32_t)old != 0) {
+			if (cmpxchg(state, old, old - SEMA_VALUE_ONE - SEMA_WAITING_ONE) == old)
+				return;
+			continue;
+		}
+		waitq_push(&sema->waiters, &thread_current()->wait_elem, thread_current());
+		thread_block();
+	}
+}
+
 static void sema_test_helper(void *sema_);
 
 /* Self-test for semaphores that makes control "ping-pong"
@@ -179,45 +255,58 @@ void lock_init(struct lock *lock)
 	ASSERT(lock != NULL);
 
 	lock->holder = NULL;
-	sema_init(&lock->semaphore, 1);
+	waitq_init(&lock->waiters);
+	lock->donation_elem.queue = NULL;
 }
 
 /* Acquires LOCK, sleeping until it becomes available if
    necessary.  The lock must not already be held by the current
    thread.
 
+   A free lock is taken by a single compare-and-swap of its holder
+   from NULL to the current thread, so the lock is never taken
+   without a holder to donate to.  When it is contended, the
+   current thread marks the holder with LOCK_WAITERS, queues up
+   and donates its priority to the holder, all with interrupts
+   off.  The mark makes the holder's compare-and-swap in
+   lock_release() fail, so it hands the lock over instead of
+   leaving a waiter behind.
+
    This function may sleep, so it must not be called within an
    interrupt handler.  This function may be called with
    interrupts disabled, but interrupts will be turned back on if
    we need to sleep. */
 void lock_acquire(struct lock *lock)
 {
+	volatile uint64_t *word = (volatile uint64_t *)&lock->holder;
+	enum intr_level old_level;
+
 	ASSERT(lock != NULL);
 	ASSERT(!intr_context());
 	ASSERT(!lock_held_by_current_thread(lock));
 
 	struct thread *t = thread_current();
-	if (lock->holder != NULL && lock->holder->priority < t->priority) {
-		enum intr_level old = intr_disable();
-		t->waiting_lock = lock;
-		struct thread *cur = lock->holder;
-
-		int depth = 0;
-		while (cur && depth < MAX_DEPTH) {
-			cur->priority = t->priority;
-			if (!cur->waiting_lock)
+	if (cmpxchg(word, 0, (uint64_t)t) == 0)
+		return;
+
+	old_level = intr_disable();
+	for (;;) {
+		uint64_t old = *word;
+
+		if (old == 0) {
+			if (cmpxchg(word, 0, (uint64_t)t) == 0)
 				break;
-			cur = cur->waiting_lock->holder;
-			depth++;
+		} else if ((old & LOCK_WAITERS) != 0 || cmpxchg(word, old, old | LOCK_WAITERS) == old) {
+			/* lock_release() hands the lock over to us. */
+			t->waiting_lock = lock;
+			waitq_push(&lock->waiters, &t->wait_elem, t);
+			lock_update_donation(lock);
+			thread_block();
+			t->waiting_lock = NULL;
+			break;
 		}
-
-		list_push_front(&lock->holder->donor_list, &t->donor_elem);
-		intr_set_level(old);
 	}
-
-	sema_down(&lock->semaphore);
-	t->waiting_lock = NULL;
-	lock->holder = t;
+	intr_set_level(old_level);
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -228,45 +317,134 @@ void lock_acquire(struct lock *lock)
    interrupt handler. */
 bool lock_try_acquire(struct lock *lock)
 {
-	bool success;
-
 	ASSERT(lock != NULL);
 	ASSERT(!lock_held_by_current_thread(lock));
 
-	success = sema_try_down(&lock->semaphore);
-	if (success)
-		lock->holder = thread_current();
-	return success;
+	return cmpxchg((volatile uint64_t *)&lock->holder, 0, (uint64_t)thread_current()) == 0;
 }
 
 /* Releases LOCK, which must be owned by the current thread.
    This is lock_release function.
 
+   If nobody waits for LOCK, it donates nothing, so the current
+   thread's priority cannot change and the lock is handed back
+   with a single compare-and-swap.  Otherwise the current thread
+   gives up LOCK's donation, which takes O(log n) in the number of
+   locks it holds, and hands LOCK directly to the highest-priority
+   waiter.
+
    An interrupt handler cannot acquire a lock, so it does not
    make sense to try to release a lock within an interrupt
    handler. */
 void lock_release(struct lock *lock)
 {
+	volatile uint64_t *word = (volatile uint64_t *)&lock->holder;
+	enum intr_level old_level;
+
 	ASSERT(lock != NULL);
 	ASSERT(lock_held_by_current_thread(lock));
 
 	struct thread *cur = thread_current();
-	int max_priority = lock->holder->base_priority;
+	if (cmpxchg(word, (uint64_t)cur, 0) == (uint64_t)cur)
+		return;
 
-	struct list_elem *e;
-	for (e = list_begin(&cur->donor_list); e != list_end(&cur->donor_list); e = list_next(e)) {
-		struct thread *t = list_entry(e, struct thread, donor_elem);
-		if (t->waiting_lock == lock) {
-			list_remove(e);
-			continue;
+	/* LOCK_WAITERS is set, and stays set until we hand over. */
+	old_level = intr_disable();
+	set_donation(cur, &lock->donation_elem, NO_DONATION);
+	refresh_priority(cur);
+
+	struct thread *next = waitq_pop(&lock->waiters)->thread;
+	*word = (uint64_t)next | (waitq_empty(&lock->waiters) ? 0 : LOCK_WAITERS);
+	lock_update_donation(lock);
+	thread_unblock(next);
+	intr_set_level(old_level);
+}
+
+/* Returns the thread holding LOCK, or NULL if it is free.  Which
+   thread that is may change at any time unless it is the current
+   thread or interrupts are off. */
+struct thread *lock_holder(const struct lock *lock)
+{
+	return (struct thread *)((uintptr_t)lock->holder & ~LOCK_WAITERS);
+}
+
+/* Returns the priority that the threads waiting for LOCK donate
+   to its holder, or NO_DONATION if there are none. */
+static int lock_donated_priority(const struct lock *lock)
+{
+	struct waitq_elem *top = waitq_front(&lock->waiters);
+
+	return top != NULL ? top->priority : NO_DONATION;
+}
+
+/* Brings the donation that LOCK's waiters make to its holder up
+   to date, and passes any resulting change in the holder's
+   priority along.  Interrupts must be off. */
+static void lock_update_donation(struct lock *lock)
+{
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	struct thread *holder = lock_holder(lock);
+
+	if (thread_mlfqs || holder == NULL)
+		return;
+	set_donation(holder, &lock->donation_elem, lock_donated_priority(lock));
+	refresh_priority(holder);
+}
+
+/* Makes E, one of the locks or rwlocks that T holds, donate
+   PRIORITY to T, or nothing if PRIORITY is NO_DONATION.  Does not
+   recompute T's priority. */
+static void set_donation(struct thread *t, struct waitq_elem *e, int priority)
+{
+	if (priority == NO_DONATION) {
+		if (e->queue != NULL)
+			waitq_remove(e);
+	} else if (e->queue != NULL)
+		waitq_update(e, priority);
+	else
+		waitq_insert(&t->donations, e, priority);
+}
+
+/* Recomputes T's priority as the greater of its base priority and
+   the highest priority donated to it.  If that changes T's
+   priority and T is waiting for a lock, the lock's donation to its
+   holder changes as well, so the holder is recomputed in turn, and
+   so on along the chain until some priority stays the same.  Each
+   step is O(log n), and there is no limit on the chain's length.
+   If T is waiting for an rwlock instead, the chain may fork into
+   the rwlock's readers, so it goes on through
+   rwlock_update_donations(), which recomputes every holder.
+   Interrupts must be off. */
+static void refresh_priority(struct thread *t)
+{
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	if (thread_mlfqs)
+		return;
+	while (t != NULL) {
+		struct waitq_elem *top = waitq_front(&t->donations);
+		int priority = t->base_priority;
+
+		if (top != NULL && top->priority > priority)
+			priority = top->priority;
+		if (priority == t->priority)
+			return;
+
+		/* Also moves T within the queue of the lock it waits for. */
+		thread_update_priority(t, priority);
+
+		if (t->waiting_rwlock != NULL) {
+			rwlock_update_donations(t->waiting_rwlock);
+			return;
 		}
-		if (t->priority > max_priority)
-			max_priority = t->priority;
-	}
-	lock->holder->priority = max_priority;
 
-	lock->holder = NULL;
-	sema_up(&lock->semaphore);
+		struct lock *lock = t->waiting_lock;
+		if (lock == NULL || lock_holder(lock) == NULL)
+			return;
+		t = lock_holder(lock);
+		set_donation(t, &lock->donation_elem, lock_donated_priority(lock));
+	}
 }
 
 /* Returns true if the current thread holds LOCK, false
@@ -276,12 +454,12 @@ bool lock_held_by_current_thread(const struct lock *lock)
 {
 	ASSERT(lock != NULL);
 
-	return lock->holder == thread_current();
+	return lock_holder(lock) == thread_current();
 }
 
-/* One semaphore in a list. */
+/* One semaphore in a condition variable's wait queue. */
 struct semaphore_elem {
-	struct list_elem elem;		/* List element. */
+	struct waitq_elem elem;		/* Wait queue element. */
 	struct semaphore semaphore; /* This semaphore. */
 };
 
@@ -292,7 +470,7 @@ void cond_init(struct condition *cond)
 {
 	ASSERT(cond != NULL);
 
-	list_init(&cond->waiters);
+	waitq_init(&cond->waiters);
 }
 
 /* Atomically releases LOCK and waits for COND to be signaled by
@@ -318,6 +496,8 @@ void cond_init(struct condition *cond)
 void cond_wait(struct condition *cond, struct lock *lock)
 {
 	struct semaphore_elem waiter;
+	struct thread *t = thread_current();
+	enum intr_level old_level;
 
 	ASSERT(cond != NULL);
 	ASSERT(lock != NULL);
@@ -325,9 +505,14 @@ void cond_wait(struct condition *cond, struct lock *lock)
 	ASSERT(lock_held_by_current_thread(lock));
 
 	sema_init(&waiter.semaphore, 0);
-	list_insert_ordered(&cond->waiters, &waiter.elem, cond_insert_by_priority, NULL);
+	old_level = intr_disable();
+	waitq_push(&cond->waiters, &waiter.elem, t);
+	t->cond_elem = &waiter.elem;
+	intr_set_level(old_level);
+
 	lock_release(lock);
 	sema_down(&waiter.semaphore);
+	t->cond_elem = NULL;
 	lock_acquire(lock);
 }
 
@@ -340,14 +525,19 @@ void cond_wait(struct condition *cond, struct lock *lock)
    interrupt handler. */
 void cond_signal(struct condition *cond, struct lock *lock UNUSED)
 {
+	struct waitq_elem *e;
+	enum intr_level old_level;
+
 	ASSERT(cond != NULL);
 	ASSERT(lock != NULL);
 	ASSERT(!intr_context());
 	ASSERT(lock_held_by_current_thread(lock));
 
-	if (!list_empty(&cond->waiters))
-		sema_up(
-			&list_entry(list_pop_front(&cond->waiters), struct semaphore_elem, elem)->semaphore);
+	old_level = intr_disable();
+	e = waitq_pop(&cond->waiters);
+	intr_set_level(old_level);
+	if (e != NULL)
+		sema_up(&waitq_entry(e, struct semaphore_elem, elem)->semaphore);
 }
 
 /* Wakes up all threads, if any, waiting on COND (protected by
@@ -361,25 +551,434 @@ void cond_broadcast(struct condition *cond, struct lock *lock)
 	ASSERT(cond != NULL);
 	ASSERT(lock != NULL);
 
-	while (!list_empty(&cond->waiters))
+	while (!waitq_empty(&cond->waiters))
 		cond_signal(cond, lock);
 }
 
-static bool cond_insert_by_priority(struct list_elem *cur UNUSED, struct list_elem *e,
-									void *aux UNUSED)
+/* Hold records beyond the one built into each thread. */
+static struct kmem_cache *rwlock_hold_slab;
+
+static struct rwlock_hold *rwlock_hold_find(const struct thread *t, const struct rwlock *rw);
+static struct rwlock_hold *rwlock_hold_get(void);
+static void rwlock_hold_attach(struct rwlock_hold *hold, struct rwlock *rw, struct thread *t);
+static void rwlock_hold_detach(struct rwlock_hold *hold);
+static void rwlock_hold_put(struct rwlock_hold *hold);
+static int rwlock_donated_priority(const struct rwlock *rw, const struct thread *holder);
+static void rwlock_grant(struct rwlock *rw);
+
+/* Creates the cache that extra rwlock hold records come from.
+   Must be called after kmem_init() and before any thread holds
+   two rwlocks at once. */
+void synch_init(void)
+{
+	rwlock_hold_slab = kmem_cache_create("rwlock_hold", sizeof(struct rwlock_hold), NULL);
+}
+
+/* Initializes RW as free.  An rwlock may be held either by one
+   writer or by any number of readers at a time.  Like locks,
+   rwlocks are not recursive.  A thread may hold any number of
+   rwlocks: the first uses the hold record built into the thread,
+   and each further one takes a record from a slab cache, which is
+   given back on release. */
+void rwlock_init(struct rwlock *rw)
+{
+	ASSERT(rw != NULL);
+
+	rw->readers = 0;
+	rw->writer = NULL;
+	rw->upgrader = NULL;
+	list_init(&rw->holds);
+	waitq_init(&rw->read_waiters);
+	waitq_init(&rw->write_waiters);
+}
+
+/* Acquires RW for reading, sleeping while a writer holds it or
+   is waiting for it.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void rwlock_acquire_read(struct rwlock *rw)
+{
+	enum intr_level old_level;
+
+	ASSERT(rw != NULL);
+	ASSERT(!intr_context());
+
+	struct thread *t = thread_current();
+	struct rwlock_hold *hold = rwlock_hold_get();
+	old_level = intr_disable();
+	ASSERT(rwlock_hold_find(t, rw) == NULL);
+	rwlock_hold_attach(hold, rw, t);
+	if (rw->writer == NULL && rw->upgrader == NULL && waitq_empty(&rw->write_waiters)) {
+		rw->readers++;
+		hold->held = true;
+	} else {
+		/* rwlock_grant() makes us a reader before waking us. */
+		waitq_push(&rw->read_waiters, &t->wait_elem, t);
+		t->waiting_rwlock = rw;
+		rwlock_update_donations(rw);
+		thread_block();
+		t->waiting_rwlock = NULL;
+		rwlock_update_donations(rw);
+	}
+	intr_set_level(old_level);
+}
+
+/* Acquires RW for writing, sleeping until no other thread holds
+   it.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void rwlock_acquire_write(struct rwlock *rw)
+{
+	enum intr_level old_level;
+
+	ASSERT(rw != NULL);
+	ASSERT(!intr_context());
+
+	struct thread *t = thread_current();
+	struct rwlock_hold *hold = rwlock_hold_get();
+	old_level = intr_disable();
+	ASSERT(rwlock_hold_find(t, rw) == NULL);
+	rwlock_hold_attach(hold, rw, t);
+	if (rw->writer == NULL && rw->readers == 0) {
+		rw->writer = t;
+		hold->held = true;
+	} else {
+		/* rwlock_grant() makes us the writer before waking us. */
+		waitq_push(&rw->write_waiters, &t->wait_elem, t);
+		t->waiting_rwlock = rw;
+		rwlock_update_donations(rw);
+		thread_block();
+		t->waiting_rwlock = NULL;
+		rwlock_update_donations(rw);
+	}
+	intr_set_level(old_level);
+}
+
+/* Releases read access to RW, which the current thread must
+   hold. */
+void rwlock_release_read(struct rwlock *rw)
+{
+	enum intr_level old_level;
+
+	ASSERT(rw != NULL);
+
+	struct thread *t = thread_current();
+	old_level = intr_disable();
+	struct rwlock_hold *hold = rwlock_hold_find(t, rw);
+	ASSERT(hold != NULL && hold->held && rw->writer != t);
+
+	set_donation(t, &hold->donation_elem, NO_DONATION);
+	rwlock_hold_detach(hold);
+	rw->readers--;
+	refresh_priority(t);
+	rwlock_grant(rw);
+	intr_set_level(old_level);
+	rwlock_hold_put(hold);
+}
+
+/* Releases write access to RW, which the current thread must
+   hold. */
+void rwlock_release_write(struct rwlock *rw)
 {
-	struct semaphore_elem *sema_elem = list_entry(e, struct semaphore_elem, elem);
-	if (!list_empty(&sema_elem->semaphore.waiters)) {
-		struct list_elem *elem = list_front(&sema_elem->semaphore.waiters);
-		struct thread *t = list_entry(elem, struct thread, elem);
-		return thread_current()->priority > t->priority;
+	enum intr_level old_level;
+
+	ASSERT(rw != NULL);
+
+	struct thread *t = thread_current();
+	old_level = intr_disable();
+	struct rwlock_hold *hold = rwlock_hold_find(t, rw);
+	ASSERT(hold != NULL && rw->writer == t);
+
+	set_donation(t, &hold->donation_elem, NO_DONATION);
+	rwlock_hold_detach(hold);
+	rw->writer = NULL;
+	refresh_priority(t);
+	rwlock_grant(rw);
+	intr_set_level(old_level);
+	rwlock_hold_put(hold);
+}
+
+/* Turns the current thread's read access to RW into write
+   access, waiting for the other readers to leave.  The upgrade
+   takes precedence over waiting writers.  Only one thread may
+   upgrade at a time: if another reader is already upgrading,
+   returns false at once, and the caller still holds read access
+   (and should release it, since the other upgrader is waiting for
+   it).  Otherwise returns true with RW held for writing. */
+bool rwlock_upgrade(struct rwlock *rw)
+{
+	enum intr_level old_level;
+	bool success = true;
+
+	ASSERT(rw != NULL);
+	ASSERT(!intr_context());
+
+	struct thread *t = thread_current();
+	old_level = intr_disable();
+	struct rwlock_hold *hold = rwlock_hold_find(t, rw);
+	ASSERT(hold != NULL && hold->held && rw->writer != t);
+
+	if (rw->upgrader != NULL)
+		success = false;
+	else if (rw->readers == 1) {
+		rw->readers = 0;
+		rw->writer = t;
+	} else {
+		/* rwlock_grant() makes us the writer before waking us. */
+		rw->upgrader = t;
+		t->waiting_rwlock = rw;
+		rwlock_update_donations(rw);
+		thread_block();
+		t->waiting_rwlock = NULL;
+		rwlock_update_donations(rw);
 	}
-	return !list_empty(&sema_elem->semaphore.waiters);
+	intr_set_level(old_level);
+	return success;
 }
 
-static bool donor_higher_priority(struct list_elem *e1, struct list_elem *e2, void *aux UNUSED)
+/* Turns the current thread's write access to RW into read
+   access, letting waiting readers in too unless a writer is
+   waiting. */
+void rwlock_downgrade(struct rwlock *rw)
 {
-	struct thread *thread1 = list_entry(e1, struct thread, donor_elem);
-	struct thread *thread2 = list_entry(e2, struct thread, donor_elem);
-	return thread1->priority > thread2->priority;
+	enum intr_level old_level;
+
+	ASSERT(rw != NULL);
+
+	struct thread *t = thread_current();
+	old_level = intr_disable();
+	struct rwlock_hold *hold = rwlock_hold_find(t, rw);
+	ASSERT(hold != NULL && rw->writer == t);
+
+	rw->writer = NULL;
+	rw->readers = 1;
+
+	/* With no writer waiting, rwlock_grant() lets every waiting
+	   reader in, so none of them donates to us any longer.  Drop
+	   their donation before waking them, as lock_release() does,
+	   so that a higher-priority reader preempts us right away. */
+	if (waitq_empty(&rw->write_waiters)) {
+		set_donation(t, &hold->donation_elem, NO_DONATION);
+		refresh_priority(t);
+	}
+	rwlock_grant(rw);
+	intr_set_level(old_level);
+}
+
+/* Returns true if the current thread holds RW for reading or
+   writing, false otherwise. */
+bool rwlock_held_by_current_thread(const struct rwlock *rw)
+{
+	enum intr_level old_level;
+	struct rwlock_hold *hold;
+
+	ASSERT(rw != NULL);
+
+	old_level = intr_disable();
+	hold = rwlock_hold_find(thread_current(), rw);
+	intr_set_level(old_level);
+	return hold != NULL && hold->held;
+}
+
+/* Returns T's hold record for RW, or NULL if T neither holds nor
+   waits for RW.  Takes time linear in the number of rwlocks T
+   holds, not in the number of threads holding RW.  Interrupts must
+   be off. */
+static struct rwlock_hold *rwlock_hold_find(const struct thread *t, const struct rwlock *rw)
+{
+	struct list *holds = (struct list *) &t->rwlock_holds;
+	struct list_elem *e;
+
+	for (e = list_begin(holds); e != list_end(holds); e = list_next(e)) {
+		struct rwlock_hold *hold = list_entry(e, struct rwlock_hold, thread_elem);
+		if (hold->rwlock == rw)
+			return hold;
+	}
+	return NULL;
+}
+
+/* Returns an unused hold record for the current thread: the one
+   built into the thread if it is free, otherwise a new one from
+   the slab cache.  Panics if memory is not available.  Called
+   before interrupts are turned off to look at the rwlock, so that
+   an allocation does not lengthen the time they stay off. */
+static struct rwlock_hold *rwlock_hold_get(void)
+{
+	struct thread *t = thread_current();
+	struct rwlock_hold *hold;
+
+	/* Only T itself uses its built-in record. */
+	if (t->rwlock_hold.rwlock == NULL)
+		return &t->rwlock_hold;
+
+	hold = kmem_cache_alloc(rwlock_hold_slab);
+	if (hold == NULL)
+		PANIC("rwlock: out of memory for hold record");
+	return hold;
+}
+
+/* Records that T, which is about to hold or wait for RW, does so
+   through HOLD.  Interrupts must be off. */
+static void rwlock_hold_attach(struct rwlock_hold *hold, struct rwlock *rw, struct thread *t)
+{
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	hold->rwlock = rw;
+	hold->thread = t;
+	hold->held = false;
+	hold->donation_elem.queue = NULL;
+	list_push_back(&rw->holds, &hold->elem);
+	list_push_back(&t->rwlock_holds, &hold->thread_elem);
+}
+
+/* Removes HOLD, which must not donate, from its rwlock's and its
+   thread's records.  Interrupts must be off. */
+static void rwlock_hold_detach(struct rwlock_hold *hold)
+{
+	ASSERT(intr_get_level() == INTR_OFF);
+	ASSERT(hold->donation_elem.queue == NULL);
+
+	list_remove(&hold->elem);
+	list_remove(&hold->thread_elem);
+	hold->rwlock = NULL;
+}
+
+/* Gives back HOLD, which rwlock_hold_detach() has removed, to
+   where rwlock_hold_get() found it.  Called after interrupts are
+   restored, for the same reason. */
+static void rwlock_hold_put(struct rwlock_hold *hold)
+{
+	if (hold != &thread_current()->rwlock_hold)
+		kmem_cache_free(rwlock_hold_slab, hold);
+}
+
+/* Returns the priority that the threads waiting for RW donate
+   to HOLDER, one of the threads holding RW, or NO_DONATION if
+   there are none.  An upgrader does not donate to itself. */
+static int rwlock_donated_priority(const struct rwlock *rw, const struct thread *holder)
+{
+	const struct waitq *queues[] = {&rw->read_waiters, &rw->write_waiters};
+	int priority = NO_DONATION;
+
+	for (int q = 0; q < 2; q++) {
+		struct waitq_elem *top = waitq_front(queues[q]);
+		if (top != NULL && top->priority > priority)
+			priority = top->priority;
+	}
+	if (rw->upgrader != NULL && rw->upgrader != holder && rw->upgrader->priority > priority)
+		priority = rw->upgrader->priority;
+	return priority;
+}
+
+/* Brings the donations that RW's waiters make to the writer or
+   to every reader holding RW up to date, and passes any
+   resulting priority changes along.  Interrupts must be off. */
+static void rwlock_update_donations(struct rwlock *rw)
+{
+	struct rwlock_hold *hold;
+	struct list_elem *e;
+
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	if (thread_mlfqs)
+		return;
+	for (e = list_begin(&rw->holds); e != list_end(&rw->holds); e = list_next(e)) {
+		hold = list_entry(e, struct rwlock_hold, elem);
+		if (!hold->held)
+			continue;
+		set_donation(hold->thread, &hold->donation_elem, rwlock_donated_priority(rw, hold->thread));
+		refresh_priority(hold->thread);
+	}
+}
+
+/* Hands RW to the threads that should run next, if it is free
+   enough: a pending upgrader once it is the only reader, else the
+   highest-priority waiting writer once there are no readers, else
+   every waiting reader if no writer is waiting.  Interrupts must
+   be off. */
+static void rwlock_grant(struct rwlock *rw)
+{
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	if (rw->writer != NULL)
+		return;
+
+	if (rw->upgrader != NULL) {
+		if (rw->readers == 1) {
+			struct thread *t = rw->upgrader;
+			rw->readers = 0;
+			rw->writer = t;
+			rw->upgrader = NULL;
+			thread_unblock(t);
+		}
+		return;
+	}
+
+	if (!waitq_empty(&rw->write_waiters)) {
+		if (rw->readers == 0) {
+			struct thread *t = waitq_pop(&rw->write_waiters)->thread;
+			rw->writer = t;
+			rwlock_hold_find(t, rw)->held = true;
+			thread_unblock(t);
+		}
+		return;
+	}
+
+	while (!waitq_empty(&rw->read_waiters)) {
+		struct thread *t = waitq_pop(&rw->read_waiters)->thread;
+		rw->readers++;
+		rwlock_hold_find(t, rw)->held = true;
+		thread_unblock(t);
+	}
+}
+
+/* Initializes spin lock L as free. */
+void spinlock_init(struct spinlock *l)
+{
+	ASSERT(l != NULL);
+
+	l->locked = 0;
+	l->holder = NULL;
+}
+
+/* Acquires spin lock L, busy-waiting until it is free.  L must
+   not already be held by this CPU. */
+void spinlock_acquire(struct spinlock *l)
+{
+	while (!spinlock_try_acquire(l))
+		while (l->locked)
+			asm volatile("pause");
+}
+
+/* Tries to acquire spin lock L and returns true if successful or
+   false on failure.  Does not wait. */
+bool spinlock_try_acquire(struct spinlock *l)
+{
+	ASSERT(l != NULL);
+	ASSERT(!spinlock_held_by_current_cpu(l));
+
+	if (cmpxchg(&l->locked, 0, 1) != 0)
+		return false;
+	l->holder = this_cpu();
+	return true;
+}
+
+/* Releases spin lock L, which must be held by this CPU. */
+void spinlock_release(struct spinlock *l)
+{
+	ASSERT(spinlock_held_by_current_cpu(l));
+
+	l->holder = NULL;
+	barrier();
+	l->locked = 0;
+}
+
+/* Returns true if this CPU holds spin lock L. */
+bool spinlock_held_by_current_cpu(const struct spinlock *l)
+{
+	ASSERT(l != NULL);
+
+	return l->locked && l->holder == this_cpu();
 }
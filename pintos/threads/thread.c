@@ -14,8 +14,10 @@
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
 #include "threads/palloc.h"
+#include "threads/smp.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
+#include "threads/waitq.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #endif
@@ -29,13 +31,42 @@
    Do not modify this value. */
 #define THREAD_BASIC 0xd42df210
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
-static struct list sleep_list;
+/* Run queue of processes in THREAD_READY state, that is,
+   processes that are ready to run but not actually running.
+   There is one FIFO list per priority level, and bit P of
+   `bitmap' is set iff queues[P] is nonempty, so the highest
+   ready priority is found with a single bit scan.
+
+   Each CPU has a run queue of its own, which holds the ready
+   threads whose `cpu' is that CPU.  A CPU whose queue runs dry
+   takes a thread from another CPU's queue, if it may run it (see
+   is_pinned()). */
+struct run_queue {
+	struct list queues[PRI_MAX + 1];
+	uint64_t bitmap;
+	size_t cnt;			 /* # of threads in the run queue. */
+	size_t unpinned_cnt; /* # of them that may run on any CPU. */
+};
+static struct run_queue run_queues[CPU_MAX];
+
+/* Hierarchical timing wheel of sleeping threads, keyed on
+   wakeup_tick.  The root wheel has one slot per tick for the next
+   WHEEL_ROOT_SIZE ticks; each outer level covers WHEEL_LEVEL_SIZE
+   times the span of the level below it.  Whenever the root wheel
+   wraps, one slot of the next level is cascaded down, so
+   insertion and per-tick expiry are O(1) amortized. */
+#define WHEEL_ROOT_BITS 8
+#define WHEEL_LEVEL_BITS 6
+#define WHEEL_LEVELS 4
+#define WHEEL_ROOT_SIZE (1 << WHEEL_ROOT_BITS)
+#define WHEEL_LEVEL_SIZE (1 << WHEEL_LEVEL_BITS)
+#define WHEEL_SHIFT(LEVEL) (WHEEL_ROOT_BITS + (LEVEL)*WHEEL_LEVEL_BITS)
+#define WHEEL_SPAN ((int64_t)1 << WHEEL_SHIFT(WHEEL_LEVELS))
+
+static struct list wheel_root[WHEEL_ROOT_SIZE];
+static struct list wheel_levels[WHEEL_LEVELS][WHEEL_LEVEL_SIZE];
+static int64_t wheel_tick; /* Next tick to be expired. */
 static struct list all_list;
-/* Idle thread. */
-static struct thread *idle_thread;
 
 /* Initial thread, the thread running init.c:main(). */
 static struct thread *initial_thread;
@@ -47,13 +78,13 @@ static struct lock tid_lock;
 static struct list destruction_req;
 
 /* Statistics. */
-static long long idle_ticks;   /* # of timer ticks spent idle. */
-static long long kernel_ticks; /* # of timer ticks in kernel threads. */
-static long long user_ticks;   /* # of timer ticks in user programs. */
+static long long idle_ticks[CPU_MAX];	 /* # of timer ticks spent idle. */
+static long long kernel_ticks[CPU_MAX]; /* # of timer ticks in kernel threads. */
+static long long user_ticks[CPU_MAX];	 /* # of timer ticks in user programs. */
 
 /* Scheduling. */
-#define TIME_SLICE 4		  /* # of timer ticks to give each thread. */
-static unsigned thread_ticks; /* # of timer ticks since last yield. */
+#define TIME_SLICE 4				/* # of timer ticks to give each thread. */
+static unsigned thread_ticks[CPU_MAX]; /* # of timer ticks since last yield, per CPU. */
 
 /* If false (default), use round-robin scheduler.
    If true, use multi-level feedback queue scheduler.
@@ -69,19 +100,56 @@ static void do_schedule(int status);
 static void schedule(void);
 static tid_t allocate_tid(void);
 
-static bool sleep_list_order(const struct list_elem *e1, const struct list_elem *e2, void *aux);
+static bool is_pinned(struct thread *);
+static bool can_run_on(struct thread *, struct cpu *);
+static struct cpu *select_cpu(struct thread *);
+static struct thread *steal_thread(struct cpu *);
+static bool can_steal(void);
+static void ready_queue_push(struct thread *t);
+static void ready_queue_remove(struct thread *t);
+static int ready_queue_max_priority(struct run_queue *);
+
+static void wheel_insert(struct thread *t);
+static void wheel_cascade(int level, int idx);
+static int wheel_quiet_ticks(int limit);
 
 static fixed_t load_avg;
 
+/* Lazy recent_cpu decay.  mlfqs_epoch counts the once-per-second
+   decays so far, and mlfqs_decay holds the coefficient used by
+   each of the last MLFQS_HISTORY of them.  Only the running and
+   ready threads are decayed every second.  A blocked thread
+   remembers the epoch it was last decayed at and catches up when
+   it is unblocked, or, if it is waiting on a semaphore, lock,
+   rwlock or condition variable, when that wait queue is next
+   popped (see waitq_pop()).
+
+   A thread that missed more than MLFQS_HISTORY decays replays the
+   last MLFQS_HISTORY exactly.  The coefficients of the older ones
+   are gone, so those are applied in closed form as if each had
+   used the oldest coefficient still kept.  That is exact if
+   load_avg held steady over that time and only an approximation
+   otherwise. */
+#define MLFQS_HISTORY 256
+static int64_t mlfqs_epoch;
+static fixed_t mlfqs_decay[MLFQS_HISTORY];
+
+static int mlfqs_calc_priority(struct thread *t);
 static void mlfqs_update_priority(struct thread *t);
 static void mlfqs_update_recent_cpu(struct thread *t);
+static fixed_t mlfqs_pow(fixed_t c, int64_t k);
 static void mlfqs_update_load_avg(void);
-static void mlfqs_update_recent_cpu_all(void);
-static void mlfqs_update_priority_all(void);
+static void mlfqs_update_ready(void);
 
 /* Returns true if T appears to point to a valid thread. */
 #define is_thread(t) ((t) != NULL && (t)->magic == THREAD_MAGIC)
 
+/* Returns true if T is a CPU's idle thread. */
+#define is_idle(t) ((t) == (t)->cpu->idle)
+
+/* The run queue of CPU C. */
+#define run_queue_of(c) (&run_queues[(c)->id])
+
 /* Returns the running thread.
  * Read the CPU's stack pointer `rsp', and then round that
  * down to the start of a page.  Since `struct thread' is
@@ -119,7 +187,13 @@ void thread_init(void)
 
 	/* Init the globla thread context */
 	lock_init(&tid_lock);
-	list_init(&ready_list);
+	for (int i = 0; i < CPU_MAX; i++) {
+		for (int pri = PRI_MIN; pri <= PRI_MAX; pri++)
+			list_init(&run_queues[i].queues[pri]);
+		run_queues[i].bitmap = 0;
+		run_queues[i].cnt = 0;
+		run_queues[i].unpinned_cnt = 0;
+	}
 	list_init(&destruction_req);
 	list_init(&all_list);
 
@@ -129,8 +203,15 @@ void thread_init(void)
 	init_thread(initial_thread, "main", PRI_DEFAULT);
 	initial_thread->status = THREAD_RUNNING;
 	initial_thread->tid = allocate_tid();
-
-	list_init(&sleep_list);
+	initial_thread->cpu = &cpus[0];
+	cpus[0].curr = initial_thread;
+
+	for (int i = 0; i < WHEEL_ROOT_SIZE; i++)
+		list_init(&wheel_root[i]);
+	for (int level = 0; level < WHEEL_LEVELS; level++)
+		for (int i = 0; i < WHEEL_LEVEL_SIZE; i++)
+			list_init(&wheel_levels[level][i]);
+	wheel_tick = 0;
 }
 
 /* Starts preemptive thread scheduling by enabling interrupts.
@@ -145,48 +226,107 @@ void thread_start(void)
 	/* Start preemptive thread scheduling. */
 	intr_enable();
 
-	/* Wait for the idle thread to initialize idle_thread. */
+	/* Wait for the idle thread to initialize cpus[0].idle. */
 	sema_down(&idle_started);
 }
 
+/* Sets up the idle thread of application processor C, which has
+   not been started yet, and returns it.  C starts out running
+   this thread, on its stack, and calls thread_start_ap() once it
+   is ready to schedule (see threads/smp.c). */
+struct thread *thread_init_ap(struct cpu *c)
+{
+	struct thread *t = palloc_get_page(PAL_ASSERT | PAL_ZERO);
+	char name[16];
+
+	snprintf(name, sizeof name, "idle%d", c->id);
+	init_thread(t, name, PRI_MIN);
+	t->tid = allocate_tid();
+	t->status = THREAD_RUNNING;
+	t->cpu = c;
+	c->idle = c->curr = t;
+
+	enum intr_level old_level = intr_disable();
+	list_push_back(&all_list, &t->allelem);
+	intr_set_level(old_level);
+	return t;
+}
+
+/* Runs the idle loop of the application processor that calls
+   it.  Never returns. */
+void thread_start_ap(void)
+{
+	idle(NULL);
+	NOT_REACHED();
+}
+
 /* Called by the timer interrupt handler at each timer tick.
    Thus, this function runs in an external interrupt context. */
 void thread_tick(void)
 {
 	struct thread *t = thread_current();
+	struct cpu *c = t->cpu;
+
+	/* Only the BSP takes timer interrupts.  Pass the tick on to
+	   the other CPUs that have a thread to charge it to, and wake
+	   up the idle ones if there is a thread they could take. */
+	if (c == &cpus[0] && cpu_cnt > 1) {
+		bool steal = can_steal();
+		for (int i = 1; i < cpu_cnt; i++)
+			if (!is_idle(cpus[i].curr))
+				smp_send_ipi(&cpus[i], IPI_TICK);
+			else {
+				idle_ticks[i]++;
+				if (steal)
+					smp_send_ipi(&cpus[i], IPI_RESCHEDULE);
+			}
+	}
 
 	/* Update statistics. */
-	if (t == idle_thread)
-		idle_ticks++;
+	if (is_idle(t))
+		idle_ticks[c->id]++;
 #ifdef USERPROG
 	else if (t->pml4 != NULL)
-		user_ticks++;
+		user_ticks[c->id]++;
 #endif
 	else
-		kernel_ticks++;
+		kernel_ticks[c->id]++;
 
 	if (thread_mlfqs) {
-		if (t != idle_thread)
+		if (!is_idle(t))
 			t->recent_cpu = FP_ADD_MIXED(t->recent_cpu, 1);
 
-		if (timer_ticks() % TIMER_FREQ == 0) {
+		if (c == &cpus[0] && timer_ticks() % TIMER_FREQ == 0) {
 			mlfqs_update_load_avg();
-			mlfqs_update_recent_cpu_all();
+			mlfqs_update_ready();
 		}
 
+		/* Only the running thread's recent_cpu changed since the
+		   last recalculation. */
 		if (timer_ticks() % 4 == 0)
-			mlfqs_update_priority_all();
+			mlfqs_update_priority(t);
 	}
 	/* Enforce preemption. */
-	if (++thread_ticks >= TIME_SLICE)
+	if (++thread_ticks[c->id] >= TIME_SLICE)
 		intr_yield_on_return();
 }
 
 /* Prints thread statistics. */
 void thread_print_stats(void)
 {
-	printf("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n", idle_ticks,
-		   kernel_ticks, user_ticks);
+	long long idle = 0, kernel = 0, user = 0;
+
+	for (int i = 0; i < cpu_cnt; i++) {
+		idle += idle_ticks[i];
+		kernel += kernel_ticks[i];
+		user += user_ticks[i];
+	}
+	printf("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n", idle, kernel,
+		   user);
+	if (cpu_cnt > 1)
+		for (int i = 0; i < cpu_cnt; i++)
+			printf("CPU %d: %lld idle ticks, %lld kernel ticks, %lld user ticks\n", i,
+				   idle_ticks[i], kernel_ticks[i], user_ticks[i]);
 }
 
 /* Creates a new kernel thread named NAME with the given initial
@@ -220,6 +360,7 @@ tid_t thread_create(const char *name, int priority, thread_func *function, void
 	/* Initialize thread. */
 	init_thread(t, name, priority);
 	tid = t->tid = allocate_tid();
+	t->cpu = parent_t->cpu;
 
 	if (thread_mlfqs) {
 		t->nice = parent_t->nice;
@@ -265,6 +406,7 @@ void thread_block(void)
 {
 	ASSERT(!intr_context());
 	ASSERT(intr_get_level() == INTR_OFF);
+
 	thread_current()->status = THREAD_BLOCKED;
 	schedule();
 }
@@ -280,15 +422,26 @@ void thread_block(void)
 void thread_unblock(struct thread *t)
 {
 	enum intr_level old_level;
+	struct cpu *c;
 
 	ASSERT(is_thread(t));
 
 	old_level = intr_disable();
 	ASSERT(t->status == THREAD_BLOCKED);
 	t->status = THREAD_READY;
-	list_push_front(&ready_list, &t->elem);
+	if (thread_mlfqs) {
+		mlfqs_update_recent_cpu(t);
+		waitq_set_priority(t, mlfqs_calc_priority(t));
+	}
+	c = t->cpu = select_cpu(t);
+	ready_queue_push(t);
 	intr_set_level(old_level);
-	if (t->priority > thread_current()->priority) {
+	if (c != this_cpu()) {
+		/* Another CPU is idle or running something less urgent;
+		   have it reschedule. */
+		if (is_idle(c->curr) || t->priority > c->curr->priority)
+			smp_send_ipi(c, IPI_RESCHEDULE);
+	} else if (t->priority > thread_current()->priority) {
 		if (intr_context())
 			intr_yield_on_return();
 		else
@@ -354,15 +507,17 @@ void thread_yield(void)
 	ASSERT(!intr_context());
 
 	old_level = intr_disable();
-	if (curr != idle_thread)
-		list_push_front(&ready_list, &curr->elem);
+	if (thread_mlfqs)
+		waitq_set_priority(curr, mlfqs_calc_priority(curr));
+	if (!is_idle(curr))
+		ready_queue_push(curr);
 	do_schedule(THREAD_READY);
 	intr_set_level(old_level);
 }
 
 /// @brief
 /// 현재 스레드를 지정된 시간까지 재운다.
-/// 스레드는 sleep_list에 추가되고, wakeup_tick이 도달할 때까지 BLOCKED 상태로 전환된다.
+/// 스레드는 타이밍 휠에 추가되고, wakeup_tick이 도달할 때까지 BLOCKED 상태로 전환된다.
 ///
 /// @param wakeup_tick
 /// 스레드가 다시 깨어날 시점의 절대 tick 값 (`timer_ticks() + ticks`)
@@ -372,7 +527,7 @@ void thread_sleep(int64_t wakeup_tick)
 
 	struct thread *cur_thread = thread_current();
 	cur_thread->wakeup_tick = wakeup_tick;
-	list_insert_ordered(&sleep_list, &cur_thread->elem, sleep_list_order, NULL);
+	wheel_insert(cur_thread);
 	thread_block();
 
 	intr_set_level(old_level);
@@ -380,21 +535,35 @@ void thread_sleep(int64_t wakeup_tick)
 
 /// @brief
 /// 현재 시각(ticks)에 도달한 스레드들을 깨워 READY 상태로 전환한다.
-/// (sleep_list의 맨 앞부터 검사하며, wakeup_tick이 아직 안 된 스레드는 남겨둔다.)
+/// (아직 처리하지 않은 tick마다 루트 휠의 슬롯 하나를 비우고,
+///  루트 휠이 한 바퀴 돌 때마다 상위 레벨의 슬롯을 한 칸씩 내려보낸다.)
 void wake_sleeping_threads(int64_t tick)
 {
 	enum intr_level old_level = intr_disable();
-	while (!list_empty(&sleep_list)) {
-		struct thread *cur_thread = list_entry(list_front(&sleep_list), struct thread, elem);
-		if (cur_thread->wakeup_tick > tick)
-			break;
-		list_pop_front(&sleep_list);
-		thread_unblock(cur_thread);
+	while (wheel_tick <= tick) {
+		int idx = wheel_tick & (WHEEL_ROOT_SIZE - 1);
+		struct list *slot = &wheel_root[idx];
+
+		/* 루트 휠이 0번 슬롯으로 돌아오면 상위 레벨을 cascade 한다. */
+		for (int level = 0; idx == 0 && level < WHEEL_LEVELS; level++) {
+			idx = (wheel_tick >> WHEEL_SHIFT(level)) & (WHEEL_LEVEL_SIZE - 1);
+			wheel_cascade(level, idx);
+		}
+
+		while (!list_empty(slot)) {
+			struct thread *cur_thread = list_entry(list_pop_front(slot), struct thread, elem);
+			if (cur_thread->wakeup_tick > wheel_tick)
+				wheel_insert(cur_thread);
+			else
+				thread_unblock(cur_thread);
+		}
+		wheel_tick++;
 	}
 	intr_set_level(old_level);
 }
 
-/* Sets the current thread's priority to NEW_PRIORITY. */
+/* Sets the current thread's priority to NEW_PRIORITY.  While a
+   higher priority is donated to it, it keeps running at that. */
 void thread_set_priority(int new_priority)
 {
 	if (thread_mlfqs)
@@ -402,18 +571,40 @@ void thread_set_priority(int new_priority)
 
 	enum intr_level old_level = intr_disable();
 	struct thread *t = thread_current();
+	struct waitq_elem *top = waitq_front(&t->donations);
+	int priority = new_priority;
+
+	if (top != NULL && top->priority > priority)
+		priority = top->priority;
 	t->base_priority = new_priority;
-	if (list_empty(&thread_current()->donor_list))
-		t->priority = new_priority;
+	waitq_set_priority(t, priority);
 
-	if (!list_empty(&ready_list) &&
-		(new_priority <
-		 list_entry(list_max(&ready_list, thread_priority_max, NULL), struct thread, elem)
-			 ->priority))
+	if (ready_queue_max_priority(run_queue_of(t->cpu)) > t->priority)
 		thread_yield();
 	intr_set_level(old_level);
 }
 
+/* Sets T's effective priority to PRIORITY.  If T is ready, it is
+   moved to the tail of the run queue for its new priority, so
+   donations and MLFQS recalculations keep the queues consistent.
+   If T is on a wait queue, it moves to its new place there too.
+   Does not preempt the running thread. */
+void thread_update_priority(struct thread *t, int priority)
+{
+	enum intr_level old_level = intr_disable();
+
+	ASSERT(PRI_MIN <= priority && priority <= PRI_MAX);
+	if (t->priority != priority) {
+		if (t->status == THREAD_READY) {
+			ready_queue_remove(t);
+			waitq_set_priority(t, priority);
+			ready_queue_push(t);
+		} else
+			waitq_set_priority(t, priority);
+	}
+	intr_set_level(old_level);
+}
+
 /* Returns the current thread's priority. */
 int thread_get_priority(void)
 {
@@ -426,15 +617,12 @@ void thread_set_nice(int nice)
 	ASSERT(nice >= -20 && nice <= 20);
 
 	enum intr_level old_level = intr_disable();
-	thread_current()->nice = nice;
-	mlfqs_update_priority(thread_current());
+	struct thread *t = thread_current();
+	t->nice = nice;
+	mlfqs_update_priority(t);
 
-	if (!list_empty(&ready_list)) {
-		struct thread *max_ready =
-			list_entry(list_max(&ready_list, thread_priority_max, NULL), struct thread, elem);
-		if (thread_current()->priority < max_ready->priority)
-			thread_yield();
-	}
+	if (ready_queue_max_priority(run_queue_of(t->cpu)) > t->priority)
+		thread_yield();
 	intr_set_level(old_level);
 }
 
@@ -467,25 +655,37 @@ int thread_get_recent_cpu(void)
 
 /* Idle thread.  Executes when no other thread is ready to run.
 
-   The idle thread is initially put on the ready list by
+   The BSP's idle thread is initially put on the ready list by
    thread_start().  It will be scheduled once initially, at which
-   point it initializes idle_thread, "up"s the semaphore passed
-   to it to enable thread_start() to continue, and immediately
-   blocks.  After that, the idle thread never appears in the
-   ready list.  It is returned by next_thread_to_run() as a
-   special case when the ready list is empty. */
-static void idle(void *idle_started_ UNUSED)
+   point it becomes its CPU's idle thread, "up"s the semaphore
+   passed to it to enable thread_start() to continue, and
+   immediately blocks.  The other CPUs start out in their idle
+   threads (see thread_start_ap()), and pass a null IDLE_STARTED.
+   After that, an idle thread never appears in the ready list.
+   It is returned by next_thread_to_run() as a special case when
+   the ready list is empty. */
+static void idle(void *idle_started_)
 {
 	struct semaphore *idle_started = idle_started_;
+	struct thread *t = thread_current();
 
-	idle_thread = thread_current();
-	sema_up(idle_started);
+	t->cpu->idle = t;
+	if (idle_started != NULL)
+		sema_up(idle_started);
 
 	for (;;) {
 		/* Let someone else run. */
 		intr_disable();
 		thread_block();
 
+		/* With -tickless, ask the timer not to interrupt us until
+		   the next sleeping thread is due. */
+		timer_idle_enter(wheel_quiet_ticks(TIMER_FREQ));
+
+		/* Let the other CPUs into the kernel while we sleep.  The
+		   interrupt that wakes us takes the kernel lock back. */
+		kernel_lock_release();
+
 		/* Re-enable interrupts and wait for the next one.
 
 		   The `sti' instruction disables interrupts until the
@@ -530,10 +730,13 @@ static void init_thread(struct thread *t, const char *name, int priority)
 
 	t->base_priority = priority;
 	t->waiting_lock = NULL;
-	list_init(&t->donor_list);
+	t->waiting_rwlock = NULL;
+	waitq_init(&t->donations);
+	list_init(&t->rwlock_holds);
 
 	t->nice = 0;
 	t->recent_cpu = FP_CONST(0);
+	t->mlfqs_epoch = mlfqs_epoch;
 	old_level = intr_disable();
 	intr_set_level(old_level);
 
@@ -543,24 +746,166 @@ static void init_thread(struct thread *t, const char *name, int priority)
 }
 
 /* Chooses and returns the next thread to be scheduled.  Should
-   return a thread from the run queue, unless the run queue is
+   return a thread from this CPU's run queue, unless that is
    empty.  (If the running thread can continue running, then it
-   will be in the run queue.)  If the run queue is empty, return
-   idle_thread. */
+   will be in the run queue.)  If it is empty, takes the most
+   urgent thread queued for another CPU instead, and if there is
+   none, returns this CPU's idle thread. */
 static struct thread *next_thread_to_run(void)
 {
-	if (list_empty(&ready_list))
-		return idle_thread;
-	else {
-		struct list_elem *max_elem = list_max(&ready_list, thread_priority_max, NULL);
-		list_remove(max_elem);
-		return list_entry(max_elem, struct thread, elem);
+	struct cpu *c = this_cpu();
+	struct run_queue *rq = run_queue_of(c);
+	int pri = ready_queue_max_priority(rq);
+	struct thread *next;
+
+	if (pri >= 0)
+		next = list_entry(list_front(&rq->queues[pri]), struct thread, elem);
+	else if ((next = steal_thread(c)) == NULL)
+		return c->idle;
+	ready_queue_remove(next);
+	next->cpu = c;
+	return next;
+}
+
+/* Returns the most urgent thread in another CPU's run queue that
+   may run on CPU C, or a null pointer if there is none. */
+static struct thread *steal_thread(struct cpu *c)
+{
+	struct thread *best = NULL;
+
+	for (int i = 0; i < cpu_cnt; i++) {
+		struct run_queue *rq = &run_queues[i];
+		uint64_t bitmap = rq->bitmap;
+
+		if (rq == run_queue_of(c) || (c != &cpus[0] && rq->unpinned_cnt == 0))
+			continue;
+		while (bitmap != 0) {
+			int pri = 63 - __builtin_clzll(bitmap);
+			struct list_elem *e;
+
+			if (best != NULL && pri <= best->priority)
+				break;
+			for (e = list_begin(&rq->queues[pri]); e != list_end(&rq->queues[pri]);
+				 e = list_next(e)) {
+				struct thread *t = list_entry(e, struct thread, elem);
+				if (can_run_on(t, c)) {
+					best = t;
+					break;
+				}
+			}
+			bitmap &= ~(1ULL << pri);
+		}
 	}
+	return best;
+}
+
+/* Returns the priority CPU C is busy at: the higher of its
+   running thread's and its most urgent ready thread's, or -1 if
+   it has nothing to do. */
+static int cpu_priority(struct cpu *c)
+{
+	int running = is_idle(c->curr) ? -1 : c->curr->priority;
+	int ready = ready_queue_max_priority(run_queue_of(c));
+
+	return running > ready ? running : ready;
+}
+
+/* Returns true if T must run on the BSP.  A thread without a
+   user address space never leaves the kernel, so it would hold
+   the kernel lock for as long as it ran (see threads/smp.c); such
+   threads stay on the BSP, which takes the timer interrupts that
+   preempt them.  T's address space only changes while T runs. */
+static bool is_pinned(struct thread *t)
+{
+#ifdef USERPROG
+	return t->pml4 == NULL;
+#else
+	return true;
+#endif
+}
+
+/* Returns true if T may run on CPU C. */
+static bool can_run_on(struct thread *t, struct cpu *c)
+{
+	return c == &cpus[0] || !is_pinned(t);
+}
+
+/* Chooses the CPU to queue T on as it becomes ready: the least
+   busy one T may run on, preferring this CPU on a tie. */
+static struct cpu *select_cpu(struct thread *t)
+{
+	struct cpu *best = can_run_on(t, this_cpu()) ? this_cpu() : &cpus[0];
+	int best_pri = cpu_priority(best);
+
+	for (int i = 0; i < cpu_cnt; i++) {
+		int pri = cpu_priority(&cpus[i]);
+		if (pri < best_pri && can_run_on(t, &cpus[i])) {
+			best = &cpus[i];
+			best_pri = pri;
+		}
+	}
+	return best;
+}
+
+/* Returns true if an idle application processor would find a
+   thread to take with steal_thread(). */
+static bool can_steal(void)
+{
+	for (int i = 0; i < cpu_cnt; i++)
+		if (run_queues[i].unpinned_cnt > 0)
+			return true;
+	return false;
+}
+
+/* Appends T to the run queue of its CPU and current priority. */
+static void ready_queue_push(struct thread *t)
+{
+	struct run_queue *rq = run_queue_of(t->cpu);
+
+	ASSERT(intr_get_level() == INTR_OFF);
+	ASSERT(PRI_MIN <= t->priority && t->priority <= PRI_MAX);
+
+	list_push_back(&rq->queues[t->priority], &t->elem);
+	rq->bitmap |= 1ULL << t->priority;
+	rq->cnt++;
+	if (!is_pinned(t))
+		rq->unpinned_cnt++;
+}
+
+/* Removes T from the run queue of its CPU and current priority. */
+static void ready_queue_remove(struct thread *t)
+{
+	struct run_queue *rq = run_queue_of(t->cpu);
+
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	list_remove(&t->elem);
+	if (list_empty(&rq->queues[t->priority]))
+		rq->bitmap &= ~(1ULL << t->priority);
+	rq->cnt--;
+	if (!is_pinned(t))
+		rq->unpinned_cnt--;
+}
+
+/* Returns the highest priority among the threads in RQ, or -1 if
+   RQ is empty. */
+static int ready_queue_max_priority(struct run_queue *rq)
+{
+	if (rq->bitmap == 0)
+		return -1;
+	return 63 - __builtin_clzll(rq->bitmap);
 }
 
 /* Use iretq to launch the thread */
 void do_iret(struct intr_frame *tf)
 {
+	/* Leaving the kernel, so let the other CPUs in.  Interrupts
+	   stay off until iretq, so that none can retake the lock on
+	   our way out. */
+	if ((tf->cs & 3) == 3) {
+		intr_disable();
+		kernel_lock_release();
+	}
 	__asm __volatile("movq %0, %%rsp\n"
 					 "movq 0(%%rsp),%%r15\n"
 					 "movq 8(%%rsp),%%r14\n"
@@ -677,15 +1022,19 @@ static void schedule(void)
 {
 	struct thread *curr = running_thread();
 	struct thread *next = next_thread_to_run();
+	struct cpu *c = next->cpu;
 
 	ASSERT(intr_get_level() == INTR_OFF);
 	ASSERT(curr->status != THREAD_RUNNING);
 	ASSERT(is_thread(next));
+	ASSERT(c == curr->cpu);
+	ASSERT(kernel_lock_held());
 	/* Mark us as running. */
 	next->status = THREAD_RUNNING;
+	c->curr = next;
 
 	/* Start new time slice. */
-	thread_ticks = 0;
+	thread_ticks[c->id] = 0;
 
 #ifdef USERPROG
 	/* Activate the new address space. */
@@ -725,32 +1074,75 @@ static tid_t allocate_tid(void)
 }
 
 /// @brief
-/// 두 스레드의 wakeup_tick 값을 비교하여 정렬 순서를 결정한다.
-/// (timer_sleep에서 list_insert_ordered()에 사용됨)
+/// 스레드를 wakeup_tick에 맞는 타이밍 휠 슬롯에 넣는다.
+/// 이미 지난 tick이면 다음에 처리될 루트 슬롯에, 휠 전체 범위를 넘으면
+/// 최상위 레벨의 가장 먼 슬롯에 넣고 만료 시점에 다시 넣는다.
 ///
-/// @param e1 첫 번째 리스트 요소의 포인터
-/// @param e2 두 번째 리스트 요소의 포인터
-/// @param aux 추가 인자(사용하지 않음)
-/// @return
-/// e1의 wakeup_tick이 e2보다 작으면 true, 아니면 false
-static bool sleep_list_order(const struct list_elem *e1, const struct list_elem *e2, void *aux)
+/// @param t 잠들 스레드 (인터럽트가 꺼진 상태에서 호출)
+static void wheel_insert(struct thread *t)
 {
-	struct thread *thread1 = list_entry(e1, struct thread, elem);
-	struct thread *thread2 = list_entry(e2, struct thread, elem);
-	return thread1->wakeup_tick < thread2->wakeup_tick;
+	int64_t expires = t->wakeup_tick;
+	int64_t delta = expires - wheel_tick;
+	struct list *slot;
+
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	if (delta < WHEEL_ROOT_SIZE) {
+		if (delta < 0)
+			expires = wheel_tick;
+		slot = &wheel_root[expires & (WHEEL_ROOT_SIZE - 1)];
+	} else {
+		int level = 0;
+		if (delta >= WHEEL_SPAN)
+			expires = wheel_tick + WHEEL_SPAN - 1;
+		while (expires - wheel_tick >= ((int64_t)1 << WHEEL_SHIFT(level + 1)))
+			level++;
+		slot = &wheel_levels[level][(expires >> WHEEL_SHIFT(level)) & (WHEEL_LEVEL_SIZE - 1)];
+	}
+	list_push_back(slot, &t->elem);
 }
 
-bool thread_priority_max(const struct list_elem *e1, const struct list_elem *e2, void *aux)
+/// @brief
+/// 다음 몇 tick 동안 타이밍 휠에 처리할 일이 없는지 확인한다.
+/// (루트 휠이 0번 슬롯으로 돌아오는 tick은 cascade가 필요하므로 일이 있다고 본다.)
+///
+/// @param limit 확인할 최대 tick 수
+/// @return 다음 타이머 인터럽트가 필요한 tick까지 남은 tick 수 (1 이상 LIMIT 이하)
+static int wheel_quiet_ticks(int limit)
 {
-	struct thread *thread1 = list_entry(e1, struct thread, elem);
-	struct thread *thread2 = list_entry(e2, struct thread, elem);
-	return thread1->priority <= thread2->priority;
+	int n;
+
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	for (n = 1; n < limit; n++) {
+		int64_t tick = wheel_tick + n - 1;
+		int idx = tick & (WHEEL_ROOT_SIZE - 1);
+		if (idx == 0 || !list_empty(&wheel_root[idx]))
+			break;
+	}
+	return n;
 }
 
-static void mlfqs_update_priority(struct thread *t)
+/// @brief
+/// 상위 레벨 슬롯 하나의 스레드들을 현재 wheel_tick 기준으로 다시 넣는다.
+/// 남은 시간이 줄었으므로 모두 한 단계 이상 아래 레벨로 내려간다.
+static void wheel_cascade(int level, int idx)
 {
-	if (t == idle_thread)
-		return;
+	struct list *slot = &wheel_levels[level][idx];
+	struct list pending;
+
+	list_init(&pending);
+	while (!list_empty(slot))
+		list_push_back(&pending, list_pop_front(slot));
+	while (!list_empty(&pending))
+		wheel_insert(list_entry(list_pop_front(&pending), struct thread, elem));
+}
+
+/* Returns T's MLFQS priority from its recent_cpu and nice. */
+static int mlfqs_calc_priority(struct thread *t)
+{
+	if (is_idle(t))
+		return t->priority;
 
 	/* priority = PRI_MAX - (recent_cpu / 4) - (nice * 2) */
 	int new_priority = FP_TO_INT_ZERO(
@@ -761,45 +1153,133 @@ static void mlfqs_update_priority(struct thread *t)
 	else if (new_priority < PRI_MIN)
 		new_priority = PRI_MIN;
 
-	t->priority = new_priority;
+	return new_priority;
 }
 
+static void mlfqs_update_priority(struct thread *t)
+{
+	if (is_idle(t))
+		return;
+
+	thread_update_priority(t, mlfqs_calc_priority(t));
+}
+
+/* Applies to T every recent_cpu decay it has missed since it
+   was last brought up to date. */
 static void mlfqs_update_recent_cpu(struct thread *t)
 {
-	if (t == idle_thread)
+	int64_t epoch = t->mlfqs_epoch;
+
+	t->mlfqs_epoch = mlfqs_epoch;
+	if (is_idle(t))
 		return;
 
+	if (mlfqs_epoch - epoch > MLFQS_HISTORY) {
+		/* After K decays by the same coefficient C,
+		   recent_cpu = C^K * recent_cpu + nice * (1 - C^K) / (1 - C). */
+		int64_t k = mlfqs_epoch - MLFQS_HISTORY - epoch;
+		fixed_t c = mlfqs_decay[mlfqs_epoch % MLFQS_HISTORY];
+		fixed_t ck = mlfqs_pow(c, k);
+
+		if (c == FP_CONST(1))
+			t->recent_cpu = FP_ADD_MIXED(t->recent_cpu, k * t->nice);
+		else
+			t->recent_cpu =
+				FP_ADD(FP_MUL(ck, t->recent_cpu),
+					   FP_DIV(FP_MUL_MIXED(FP_SUB(FP_CONST(1), ck), t->nice), FP_SUB(FP_CONST(1), c)));
+		epoch = mlfqs_epoch - MLFQS_HISTORY;
+	}
+
 	/* recent_cpu = (2*load_avg)/(2*load_avg + 1) * recent_cpu + nice */
-	fixed_t coeff = FP_DIV(FP_MUL_MIXED(load_avg, 2), FP_ADD_MIXED(FP_MUL_MIXED(load_avg, 2), 1));
+	for (; epoch < mlfqs_epoch; epoch++)
+		t->recent_cpu =
+			FP_ADD_MIXED(FP_MUL(mlfqs_decay[epoch % MLFQS_HISTORY], t->recent_cpu), t->nice);
+}
+
+/* Returns C raised to the power K, for K >= 0. */
+static fixed_t mlfqs_pow(fixed_t c, int64_t k)
+{
+	fixed_t result = FP_CONST(1);
+
+	for (; k > 0; k >>= 1) {
+		if (k & 1)
+			result = FP_MUL(result, c);
+		c = FP_MUL(c, c);
+	}
+	return result;
+}
+
+/* Returns the number of recent_cpu decays so far.  A wait queue
+   compares it against the epoch it was last keyed at to tell
+   whether its waiters are stale. */
+int64_t thread_mlfqs_epoch(void)
+{
+	return mlfqs_epoch;
+}
 
-	t->recent_cpu = FP_ADD_MIXED(FP_MUL(coeff, t->recent_cpu), t->nice);
+/* Brings blocked thread T up to date with the recent_cpu decays
+   it has missed and recomputes its priority.  Only for wait
+   queues re-keying their waiters, which move T themselves.
+   Interrupts must be off. */
+void thread_mlfqs_catch_up(struct thread *t)
+{
+	ASSERT(intr_get_level() == INTR_OFF);
+	ASSERT(t->status == THREAD_BLOCKED);
+
+	mlfqs_update_recent_cpu(t);
+	t->priority = mlfqs_calc_priority(t);
 }
 
 static void mlfqs_update_load_avg(void)
 {
 	/* load_avg = (59/60)*load_avg + (1/60)*ready_threads */
-	int ready_threads = list_size(&ready_list);
-	if (thread_current() != idle_thread)
-		ready_threads++;
+	int ready_threads = 0;
+	for (int i = 0; i < cpu_cnt; i++) {
+		ready_threads += run_queues[i].cnt;
+		if (!is_idle(cpus[i].curr))
+			ready_threads++;
+	}
 
 	fixed_t term1 = FP_MUL(FP_DIV_MIXED(FP_CONST(59), 60), load_avg);
 	fixed_t term2 = FP_MUL_MIXED(FP_DIV_MIXED(FP_CONST(1), 60), ready_threads);
 	load_avg = FP_ADD(term1, term2);
 }
-static void mlfqs_update_recent_cpu_all(void)
+
+/* Starts a new recent_cpu decay epoch and brings the running
+   threads and every ready thread up to date with it, recomputing
+   their priorities.  Blocked threads catch up later (see
+   mlfqs_epoch), so the cost is proportional to the number of
+   runnable threads, not to the number of threads in the
+   system. */
+static void mlfqs_update_ready(void)
 {
-	struct list_elem *e;
-	for (e = list_begin(&all_list); e != list_end(&all_list); e = list_next(e)) {
-		struct thread *t = list_entry(e, struct thread, allelem);
-		mlfqs_update_recent_cpu(t);
+	struct list requeue;
+
+	mlfqs_decay[mlfqs_epoch % MLFQS_HISTORY] =
+		FP_DIV(FP_MUL_MIXED(load_avg, 2), FP_ADD_MIXED(FP_MUL_MIXED(load_avg, 2), 1));
+	mlfqs_epoch++;
+
+	for (int i = 0; i < cpu_cnt; i++) {
+		mlfqs_update_recent_cpu(cpus[i].curr);
+		mlfqs_update_priority(cpus[i].curr);
 	}
-}
 
-static void mlfqs_update_priority_all(void)
-{
-	struct list_elem *e;
-	for (e = list_begin(&all_list); e != list_end(&all_list); e = list_next(e)) {
-		struct thread *t = list_entry(e, struct thread, allelem);
-		mlfqs_update_priority(t);
+	/* Priorities may change, so take every ready thread off the
+	   run queues, highest priority first, and put it back. */
+	list_init(&requeue);
+	for (int i = 0; i < cpu_cnt; i++) {
+		struct run_queue *rq = &run_queues[i];
+		while (rq->bitmap != 0) {
+			struct list *queue = &rq->queues[ready_queue_max_priority(rq)];
+			struct thread *t = list_entry(list_front(queue), struct thread, elem);
+			ready_queue_remove(t);
+			list_push_back(&requeue, &t->elem);
+		}
+	}
+	while (!list_empty(&requeue)) {
+		struct thread *t = list_entry(list_pop_front(&requeue), struct thread, elem);
+		mlfqs_update_recent_cpu(t);
+		waitq_set_priority(t, mlfqs_calc_priority(t));
+		ready_queue_push(t);
 	}
 }
@@ -0,0 +1,234 @@
+#include "threads/vmalloc.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/init.h"
+#include "threads/mmu.h"
+#include "threads/palloc.h"
+#include "threads/smp.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+#include "intrinsic.h"
+
+/* Virtually contiguous allocator.
+
+   Hands out blocks of the vmalloc region, a range of kernel
+   virtual addresses outside the direct mapping of physical
+   memory.  The region is carved into VMALLOC_UNIT-byte units
+   and a block takes as many units as it needs, plus a small
+   header that records its size.  The pages under a block are
+   mapped one by one from the kernel pool, so they need not be
+   physically contiguous, and a page is shared by every block
+   that overlaps it: it is mapped when the first of them is
+   allocated and freed with the last.
+
+   malloc() sends every request too big for its descriptors
+   here.  Before, those got whole pages of their own, so a
+   3 kB buffer took a page and a 5 kB buffer took two; here the
+   first takes 25 units and the second 41, and a big buffer
+   needs no run of free physical pages. */
+
+/* Allocation unit. */
+#define VMALLOC_UNIT 128
+
+/* Number of units and pages in the region. */
+#define UNIT_CNT (VMALLOC_SIZE / VMALLOC_UNIT)
+#define PAGE_CNT (VMALLOC_SIZE / PGSIZE)
+
+/* Magic number for detecting block corruption. */
+#define VBLOCK_MAGIC 0x7b10c4ed
+
+/* Block header, just before the memory handed out. */
+struct vblock {
+	unsigned magic;	   /* Always set to VBLOCK_MAGIC. */
+	uint32_t unit_cnt; /* Number of units taken. */
+	size_t size;	   /* Size requested, in bytes. */
+};
+
+static struct lock vmalloc_lock; /* Protects everything below. */
+static struct bitmap *used_units; /* Units in use. */
+static uint16_t *page_refs;		  /* Number of blocks on each page. */
+static bool vmalloc_ready;		  /* vmalloc_init() done? */
+
+/* Statistics. */
+static size_t block_cnt;		  /* Blocks in use. */
+static size_t byte_cnt;			  /* Bytes requested by those blocks. */
+static size_t mapped_cnt;		  /* Pages mapped. */
+static size_t mapped_peak;		  /* Most pages ever mapped at once. */
+static size_t rounded_cnt;		  /* Pages the blocks would take in whole pages. */
+static size_t rounded_peak;		  /* Most of those ever at once. */
+
+static bool map_pages(size_t first, size_t last);
+static void unmap_pages(size_t first, size_t last);
+
+/* Sets up the vmalloc region.  Must be called after the kernel
+   page table has been set up. */
+void vmalloc_init(void)
+{
+	size_t bm_size = bitmap_buf_size(UNIT_CNT);
+	size_t bm_pages = DIV_ROUND_UP(bm_size, PGSIZE);
+	size_t ref_pages = DIV_ROUND_UP(PAGE_CNT * sizeof *page_refs, PGSIZE);
+
+	ASSERT(base_pml4 != NULL);
+	ASSERT(PML4(VMALLOC_START) == PML4(KERN_BASE));
+	ASSERT(PML4(VMALLOC_END - 1) == PML4(KERN_BASE));
+
+	lock_init(&vmalloc_lock);
+	used_units = bitmap_create_in_buf(UNIT_CNT, palloc_get_multiple(PAL_ASSERT, bm_pages),
+									  bm_pages * PGSIZE);
+	bitmap_set_all(used_units, false);
+	page_refs = palloc_get_multiple(PAL_ASSERT | PAL_ZERO, ref_pages);
+	vmalloc_ready = true;
+}
+
+/* Obtains and returns a virtually contiguous block of at least
+   SIZE bytes, or a null pointer if the region or the kernel pool
+   is exhausted, or if called before vmalloc_init(). */
+void *vmalloc(size_t size)
+{
+	struct vblock *b;
+	size_t unit_cnt, idx, first, last;
+
+	if (!vmalloc_ready || size == 0 || size > VMALLOC_SIZE)
+		return NULL;
+	unit_cnt = DIV_ROUND_UP(size + sizeof *b, VMALLOC_UNIT);
+
+	lock_acquire(&vmalloc_lock);
+	idx = bitmap_scan_and_flip(used_units, 0, unit_cnt, false);
+	if (idx == BITMAP_ERROR) {
+		lock_release(&vmalloc_lock);
+		return NULL;
+	}
+
+	b = (struct vblock *)(VMALLOC_START + idx * VMALLOC_UNIT);
+	first = pg_no(b) - pg_no(VMALLOC_START);
+	last = pg_no((uint8_t *)b + unit_cnt * VMALLOC_UNIT - 1) - pg_no(VMALLOC_START);
+	if (!map_pages(first, last)) {
+		bitmap_set_multiple(used_units, idx, unit_cnt, false);
+		lock_release(&vmalloc_lock);
+		return NULL;
+	}
+
+	block_cnt++;
+	byte_cnt += size;
+	rounded_cnt += DIV_ROUND_UP(size, PGSIZE);
+	if (rounded_cnt > rounded_peak)
+		rounded_peak = rounded_cnt;
+	lock_release(&vmalloc_lock);
+
+	b->magic = VBLOCK_MAGIC;
+	b->unit_cnt = unit_cnt;
+	b->size = size;
+	return b + 1;
+}
+
+/* Frees block P, which must have been returned by vmalloc(). */
+void vfree(void *p)
+{
+	struct vblock *b = (struct vblock *)p - 1;
+	size_t idx, first, last, size;
+
+	ASSERT(is_vmalloc_vaddr(p));
+	ASSERT(b->magic == VBLOCK_MAGIC);
+
+	size = b->size;
+	idx = ((uint64_t)b - VMALLOC_START) / VMALLOC_UNIT;
+	first = pg_no(b) - pg_no(VMALLOC_START);
+	last = pg_no((uint8_t *)b + b->unit_cnt * VMALLOC_UNIT - 1) - pg_no(VMALLOC_START);
+
+#ifndef NDEBUG
+	/* Clear the block to help detect use-after-free bugs. */
+	memset(p, 0xcc, size);
+#endif
+	b->magic = 0;
+
+	lock_acquire(&vmalloc_lock);
+	ASSERT(bitmap_all(used_units, idx, b->unit_cnt));
+	bitmap_set_multiple(used_units, idx, b->unit_cnt, false);
+	unmap_pages(first, last);
+	block_cnt--;
+	byte_cnt -= size;
+	rounded_cnt -= DIV_ROUND_UP(size, PGSIZE);
+	lock_release(&vmalloc_lock);
+}
+
+/* Returns the size requested for block P, which must have been
+   returned by vmalloc(). */
+size_t vmalloc_size(const void *p)
+{
+	const struct vblock *b = (const struct vblock *)p - 1;
+
+	ASSERT(is_vmalloc_vaddr(p));
+	ASSERT(b->magic == VBLOCK_MAGIC);
+	return b->size;
+}
+
+/* Prints how much memory vmalloc() blocks take, next to what
+   they would take if each was rounded up to whole pages. */
+void vmalloc_print_stats(void)
+{
+	if (!vmalloc_ready)
+		return;
+
+	lock_acquire(&vmalloc_lock);
+	printf("vmalloc: %zu blocks of %zu bytes in %zu pages (peak %zu), "
+		   "%zu pages in whole pages (peak %zu)\n",
+		   block_cnt, byte_cnt, mapped_cnt, mapped_peak, rounded_cnt, rounded_peak);
+	lock_release(&vmalloc_lock);
+}
+
+/* Takes a reference to pages FIRST through LAST of the region,
+   mapping those that had none.  Returns true if successful,
+   false if out of memory, in which case nothing changes. */
+static bool map_pages(size_t first, size_t last)
+{
+	size_t pg;
+
+	ASSERT(lock_held_by_current_thread(&vmalloc_lock));
+
+	for (pg = first; pg <= last; pg++) {
+		if (page_refs[pg]++ == 0) {
+			uint64_t va = VMALLOC_START + pg * PGSIZE;
+			void *kpage = palloc_get_page(0);
+			uint64_t *pte = kpage != NULL ? pml4e_walk(base_pml4, va, 1) : NULL;
+
+			if (pte == NULL) {
+				palloc_free_page(kpage);
+				page_refs[pg]--;
+				if (pg > first)
+					unmap_pages(first, pg - 1);
+				return false;
+			}
+			*pte = vtop(kpage) | PTE_P | PTE_W;
+			if (++mapped_cnt > mapped_peak)
+				mapped_peak = mapped_cnt;
+		}
+	}
+	return true;
+}
+
+/* Drops a reference to pages FIRST through LAST of the region,
+   unmapping and freeing those left with none. */
+static void unmap_pages(size_t first, size_t last)
+{
+	size_t pg;
+
+	ASSERT(lock_held_by_current_thread(&vmalloc_lock));
+
+	for (pg = first; pg <= last; pg++) {
+		ASSERT(page_refs[pg] > 0);
+		if (--page_refs[pg] == 0) {
+			uint64_t va = VMALLOC_START + pg * PGSIZE;
+			uint64_t *pte = pml4e_walk(base_pml4, va, 0);
+
+			ASSERT(pte != NULL && (*pte & PTE_P));
+			palloc_free_page(ptov(PTE_ADDR(*pte)));
+			*pte = 0;
+			invlpg(va);
+			smp_flush_kernel_tlb();
+			mapped_cnt--;
+		}
+	}
+}
@@ -0,0 +1,242 @@
+#include "threads/waitq.h"
+#include <debug.h>
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+
+static bool elem_before(const struct waitq_elem *a, const struct waitq_elem *b);
+static struct waitq_elem *meld(struct waitq_elem *a, struct waitq_elem *b);
+static struct waitq_elem *merge_pairs(struct waitq_elem *first);
+static void detach(struct waitq_elem *e);
+static void rekey(struct waitq *q);
+
+/* Initializes Q as an empty wait queue. */
+void waitq_init(struct waitq *q)
+{
+	ASSERT(q != NULL);
+
+	q->root = NULL;
+	q->next_seq = 0;
+	q->mlfqs_epoch = 0;
+}
+
+/* Returns true if Q has no waiters, false otherwise. */
+bool waitq_empty(const struct waitq *q)
+{
+	ASSERT(q != NULL);
+
+	return q->root == NULL;
+}
+
+/* Adds E, which stands for thread T, to Q at T's current
+   priority. */
+void waitq_push(struct waitq *q, struct waitq_elem *e, struct thread *t)
+{
+	ASSERT(t != NULL);
+
+	e->thread = t;
+	waitq_insert(q, e, t->priority);
+}
+
+/* Adds E to Q with the given PRIORITY, behind every element of
+   the same or higher priority.  E's thread member is left alone,
+   so E need not stand for a thread. */
+void waitq_insert(struct waitq *q, struct waitq_elem *e, int priority)
+{
+	ASSERT(q != NULL && e != NULL);
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	e->child = e->next = e->prev = NULL;
+	e->queue = q;
+	e->priority = priority;
+	e->seq = q->next_seq++;
+	q->root = meld(q->root, e);
+}
+
+/* Returns the waiter that waitq_pop() would remove from Q, or
+   NULL if Q is empty.  Under the MLFQS, waitq_pop() may first
+   re-key Q, so this is only the highest-priority waiter as of
+   the last pop. */
+struct waitq_elem *waitq_front(const struct waitq *q)
+{
+	ASSERT(q != NULL);
+
+	return q->root;
+}
+
+/* Removes and returns the highest-priority waiter in Q, or NULL
+   if Q is empty. */
+struct waitq_elem *waitq_pop(struct waitq *q)
+{
+	struct waitq_elem *e;
+
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	if (thread_mlfqs && q->mlfqs_epoch != thread_mlfqs_epoch())
+		rekey(q);
+
+	e = q->root;
+	if (e != NULL)
+		waitq_remove(e);
+	return e;
+}
+
+/* Removes E from the queue it is on. */
+void waitq_remove(struct waitq_elem *e)
+{
+	ASSERT(e->queue != NULL);
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	detach(e);
+	e->queue = NULL;
+}
+
+/* Changes the priority of E, which must be on a queue, to
+   PRIORITY and moves E to its new place.  E keeps its arrival
+   order, so it goes ahead of the elements of its new priority
+   that arrived after it. */
+void waitq_update(struct waitq_elem *e, int priority)
+{
+	ASSERT(e->queue != NULL);
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	detach(e);
+	e->priority = priority;
+	e->queue->root = meld(e->queue->root, e);
+}
+
+/* Sets T's priority to PRIORITY, moving T to its new place in
+   any wait queue it is on.  Interrupts must be off. */
+void waitq_set_priority(struct thread *t, int priority)
+{
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	t->priority = priority;
+	if (t->wait_elem.queue != NULL)
+		waitq_update(&t->wait_elem, priority);
+	if (t->cond_elem != NULL && t->cond_elem->queue != NULL)
+		waitq_update(t->cond_elem, priority);
+}
+
+/* Takes E out of its queue's heap, leaving E's queue and
+   sequence number alone. */
+static void detach(struct waitq_elem *e)
+{
+	struct waitq *q = e->queue;
+	struct waitq_elem *children = merge_pairs(e->child);
+
+	if (e == q->root)
+		q->root = children;
+	else {
+		/* Cut E's subtree out of its parent's child list. */
+		if (e->prev->child == e)
+			e->prev->child = e->next;
+		else
+			e->prev->next = e->next;
+		if (e->next != NULL)
+			e->next->prev = e->prev;
+		q->root = meld(q->root, children);
+	}
+	e->child = e->next = e->prev = NULL;
+}
+
+/* Brings every waiting thread in Q up to date with the MLFQS
+   recent_cpu decays it has missed and rebuilds Q around the new
+   priorities.  Elements keep their sequence numbers, so waiters
+   of equal priority still leave in arrival order.  Takes time
+   linear in the number of waiters. */
+static void rekey(struct waitq *q)
+{
+	struct waitq_elem *e = q->root;
+	struct waitq_elem *all = NULL;
+
+	/* Flatten the heap into ALL, splicing each element's children
+	   into the sibling list being walked. */
+	while (e != NULL) {
+		struct waitq_elem *next = e->next;
+		if (e->child != NULL) {
+			struct waitq_elem *last = e->child;
+			while (last->next != NULL)
+				last = last->next;
+			last->next = next;
+			next = e->child;
+		}
+		e->child = e->prev = NULL;
+		e->next = all;
+		all = e;
+		e = next;
+	}
+
+	q->root = NULL;
+	while (all != NULL) {
+		e = all;
+		all = e->next;
+		e->next = NULL;
+		if (e->thread != NULL) {
+			thread_mlfqs_catch_up(e->thread);
+			e->priority = e->thread->priority;
+		}
+		q->root = meld(q->root, e);
+	}
+	q->mlfqs_epoch = thread_mlfqs_epoch();
+}
+
+/* Returns true if A should leave its queue before B. */
+static bool elem_before(const struct waitq_elem *a, const struct waitq_elem *b)
+{
+	if (a->priority != b->priority)
+		return a->priority > b->priority;
+	return a->seq < b->seq;
+}
+
+/* Links heaps A and B, either of which may be NULL, and returns
+   the root of the result. */
+static struct waitq_elem *meld(struct waitq_elem *a, struct waitq_elem *b)
+{
+	if (a == NULL)
+		return b;
+	if (b == NULL)
+		return a;
+	if (elem_before(b, a)) {
+		struct waitq_elem *tmp = a;
+		a = b;
+		b = tmp;
+	}
+
+	b->prev = a;
+	b->next = a->child;
+	if (a->child != NULL)
+		a->child->prev = b;
+	a->child = b;
+	return a;
+}
+
+/* Melds the sibling list starting at FIRST into one heap: first
+   in pairs from left to right, then the pairs from right to
+   left.  Returns the new root, or NULL if FIRST is NULL. */
+static struct waitq_elem *merge_pairs(struct waitq_elem *first)
+{
+	struct waitq_elem *pairs = NULL;
+	struct waitq_elem *root = NULL;
+
+	while (first != NULL) {
+		struct waitq_elem *a = first;
+		struct waitq_elem *b = a->next;
+
+		first = b != NULL ? b->next : NULL;
+		a->next = a->prev = NULL;
+		if (b != NULL)
+			b->next = b->prev = NULL;
+
+		a = meld(a, b);
+		a->next = pairs;
+		pairs = a;
+	}
+
+	while (pairs != NULL) {
+		struct waitq_elem *p = pairs;
+		pairs = p->next;
+		p->next = NULL;
+		root = meld(root, p);
+	}
+	return root;
+}
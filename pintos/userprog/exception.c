@@ -9,6 +9,13 @@
 /* Number of page faults processed. */
 static long long page_fault_cnt;
 
+#ifdef VM
+/* Number of page faults resolved by the VM system, and the time
+   spent resolving them, in TSC cycles. */
+static long long vm_fault_cnt;
+static uint64_t vm_fault_cycles;
+#endif
+
 static void kill(struct intr_frame *);
 static void page_fault(struct intr_frame *);
 
@@ -61,6 +68,10 @@ void exception_init(void)
 void exception_print_stats(void)
 {
 	printf("Exception: %lld page faults\n", page_fault_cnt);
+#ifdef VM
+	printf("Exception: %lld faults resolved, %" PRIu64 " cycles each on average\n", vm_fault_cnt,
+		   vm_fault_cnt > 0 ? vm_fault_cycles / vm_fault_cnt : 0);
+#endif
 }
 
 /* Handler for an exception (probably) caused by a user process. */
@@ -138,8 +149,12 @@ static void page_fault(struct intr_frame *f)
 
 #ifdef VM
 	/* For project 3 and later. */
-	if (vm_try_handle_fault(f, fault_addr, user, write, not_present))
+	uint64_t start = rdtsc();
+	if (vm_try_handle_fault(f, fault_addr, user, write, not_present)) {
+		vm_fault_cycles += rdtsc() - start;
+		vm_fault_cnt++;
 		return;
+	}
 #endif
 
 	if (!user) {
@@ -2,6 +2,7 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include "threads/slab.h"
 
 #define DEFAULT_SIZE 64
 
@@ -14,6 +15,9 @@ struct fd_table {
 	struct file **file_list;
 };
 
+/* Cache of file descriptor tables. */
+static struct kmem_cache *fd_table_slab;
+
 static int fd_find_next(struct fd_table *fd_t);
 static bool fd_table_expand(struct fd_table *fd_t);
 
@@ -25,22 +29,21 @@ void init_std_fds()
 		PANIC("malloc failed\n");
 	if (!stdout_entry)
 		PANIC("malloc failed\n");
+	fd_table_slab = kmem_cache_create("fd_table", sizeof(struct fd_table), NULL);
 }
 
 bool fd_init(struct thread *t)
 {
-	t->fd_table = malloc(sizeof(struct fd_table));
-	if (t->fd_table == NULL) {
-		free(t->fd_table);
+	t->fd_table = kmem_cache_alloc(fd_table_slab);
+	if (t->fd_table == NULL)
 		return false;
-	}
 
 	t->fd_table->size = DEFAULT_SIZE;
 	t->fd_table->file_list = calloc(t->fd_table->size, sizeof(struct file *));
 
 	if (t->fd_table->file_list == NULL) {
-		free(t->fd_table->file_list);
-		free(t->fd_table);
+		kmem_cache_free(fd_table_slab, t->fd_table);
+		t->fd_table = NULL;
 		return false;
 	}
 
@@ -131,7 +134,7 @@ void fd_clean(struct thread *t)
 		fd_close(t->fd_table, i);
 	}
 	free(t->fd_table->file_list);
-	free(t->fd_table);
+	kmem_cache_free(fd_table_slab, t->fd_table);
 	t->fd_table = NULL;
 }
 
@@ -1,8 +1,10 @@
 #include "userprog/gdt.h"
 #include <debug.h>
+#include <string.h>
 #include "userprog/tss.h"
 #include "threads/mmu.h"
 #include "threads/palloc.h"
+#include "threads/smp.h"
 #include "threads/vaddr.h"
 #include "intrinsic.h"
 
@@ -19,7 +21,11 @@
  * types of segments are of interest: code, data, and TSS or
  * Task-State Segment descriptors.  The former two types are
  * exactly what they sound like.  The TSS is used primarily for
- * stack switching on interrupts. */
+ * stack switching on interrupts.
+ *
+ * Every CPU has a TSS of its own, and a TSS descriptor may only be
+ * loaded by one CPU, so each CPU also gets its own copy of the
+ * GDT. */
 
 struct segment_desc {
 	unsigned lim_15_0 : 16;
@@ -63,7 +69,7 @@ struct segment_descriptor64 {
 			(unsigned)(lim) >> 28, 0, 1, 0, 1, (unsigned)(base) >> 24                              \
 	}
 
-static struct segment_desc gdt[SEL_CNT] = {
+static const struct segment_desc gdt[SEL_CNT] = {
 	[SEL_NULL >> 3] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
 	[SEL_KCSEG >> 3] = SEG64(0xa, 0x0, 0xffffffff, 0),
 	[SEL_KDSEG >> 3] = SEG64(0x2, 0x0, 0xffffffff, 0),
@@ -74,15 +80,21 @@ static struct segment_desc gdt[SEL_CNT] = {
 	[7] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
 };
 
-struct desc_ptr gdt_ds = {.size = sizeof(gdt) - 1, .address = (uint64_t)gdt};
+/* Each CPU's copy of the GDT, indexed by struct cpu's id. */
+static struct segment_desc cpu_gdts[CPU_MAX][SEL_CNT];
 
-/* Sets up a proper GDT.  The bootstrap loader's GDT didn't
-   include user-mode selectors or a TSS, but we need both now. */
+/* Sets up a proper GDT for this CPU.  The bootstrap loader's GDT
+   didn't include user-mode selectors or a TSS, but we need both
+   now. */
 void gdt_init(void)
 {
 	/* Initialize GDT. */
-	struct segment_descriptor64 *tss_desc = (struct segment_descriptor64 *)&gdt[SEL_TSS >> 3];
+	struct segment_desc *cpu_gdt = cpu_gdts[this_cpu()->id];
+	struct segment_descriptor64 *tss_desc = (struct segment_descriptor64 *)&cpu_gdt[SEL_TSS >> 3];
 	struct task_state *tss = tss_get();
+	struct desc_ptr gdt_ds = {.size = sizeof(gdt) - 1, .address = (uint64_t)cpu_gdt};
+
+	memcpy(cpu_gdt, gdt, sizeof gdt);
 
 	*tss_desc = (struct segment_descriptor64){
 		.lim_15_0 = (uint64_t)(sizeof(struct task_state)) & 0xffff,
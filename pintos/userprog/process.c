@@ -27,6 +27,9 @@
 #include "vm/vm.h"
 #endif
 
+/* Most arguments process_exec() passes to a new program. */
+#define ARGV_MAX 128
+
 struct fork_struct {
 	struct thread *t;
 	struct intr_frame *if_;
@@ -75,6 +78,7 @@ static void initd(void *f_name)
 {
 #ifdef VM
 	supplemental_page_table_init(&thread_current()->spt);
+	thread_current()->memgroup = memgroup_get(memgroup_root());
 #endif
 
 	process_init();
@@ -172,6 +176,11 @@ static void __do_fork(void *aux)
 	memcpy(&if_, parent_if, sizeof(struct intr_frame));
 	if_.R.rax = 0;
 
+#ifdef VM
+	/* The child starts in its parent's memory group. */
+	current->memgroup = memgroup_get(parent->memgroup);
+#endif
+
 	/* 2. Duplicate PT */
 	current->pml4 = pml4_create();
 	if (current->pml4 == NULL)
@@ -208,13 +217,23 @@ error:
 int process_exec(void *f_name)
 {
 	char *file_name;
-	char *argv[128];
+	char **argv;
 	int argc = 0;
 	bool success;
 
+	/* A kernel stack has only what struct thread leaves of its
+	 * page, and the rest of exec goes deep into the page table and
+	 * the allocators, so the argument vector gets a page of its
+	 * own. */
+	argv = palloc_get_page(0);
+	if (argv == NULL) {
+		palloc_free_page(f_name);
+		return -1;
+	}
+
 	// string token
 	char *token, *save_ptr;
-	for (token = strtok_r(f_name, " ", &save_ptr); token != NULL;
+	for (token = strtok_r(f_name, " ", &save_ptr); token != NULL && argc < ARGV_MAX;
 		 token = strtok_r(NULL, " ", &save_ptr)) {
 		argv[argc++] = token;
 	}
@@ -235,6 +254,7 @@ int process_exec(void *f_name)
 	success = load(file_name, argc, argv, &_if);
 
 	/* If load failed, quit. */
+	palloc_free_page(argv);
 	palloc_free_page(f_name);
 	if (!success)
 		return -1;
@@ -286,6 +306,10 @@ void process_exit(void)
 
 	fd_clean(curr);
 	process_cleanup();
+#ifdef VM
+	memgroup_put(curr->memgroup);
+	curr->memgroup = NULL;
+#endif
 	sema_up(&curr->my_entry->wait_sema);
 }
 
@@ -690,12 +714,12 @@ static bool lazy_load_segment(struct page *page, void *aux)
 	int read_result = file_read_at(file, page->frame->kva, page_read_bytes, ofs);
 	lock_release(&file_lock);
 	if (read_result != (int)page_read_bytes) {
-		palloc_free_page(page->frame->kva);
+		kmem_cache_free(vm_load_aux_slab, aux);
 		return false;
 	}
 
 	memset(page->frame->kva + page_read_bytes, 0, PGSIZE - page_read_bytes);
-	free(aux);
+	kmem_cache_free(vm_load_aux_slab, aux);
 
 	return true;
 }
@@ -711,7 +735,7 @@ static bool load_segment(struct file *file, off_t ofs, uint8_t *upage, uint32_t
 		size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
 		size_t page_zero_bytes = PGSIZE - page_read_bytes;
 
-		struct vm_load_aux *file_page_aux = malloc(sizeof(*file_page_aux));
+		struct vm_load_aux *file_page_aux = kmem_cache_alloc(vm_load_aux_slab);
 		*file_page_aux = (struct vm_load_aux){
 			.offset = ofs,
 			.page_read_bytes = page_read_bytes,
@@ -11,6 +11,7 @@
 #include "threads/loader.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/smp.h"
 #include "threads/thread.h"
 #include "user/syscall.h"
 #include "userprog/fd_util.h"
@@ -33,6 +34,7 @@ void syscall_handler(struct intr_frame *);
 #define MSR_STAR 0xc0000081			/* Segment selector msr */
 #define MSR_LSTAR 0xc0000082		/* Long mode SYSCALL target */
 #define MSR_SYSCALL_MASK 0xc0000084 /* Mask for the eflags */
+#define MSR_KERNEL_GS_BASE 0xc0000102 /* %gs base after swapgs */
 
 #define MAX_FILE_NAME_LEN 16
 
@@ -55,8 +57,33 @@ static void syscall_close(int fd);
 static int syscall_dup2(int oldfd, int newfd);
 static void *syscall_mmap(void *addr, size_t length, int writable, int fd, off_t offset);
 static void syscall_munmap(void *addr);
+#ifdef VM
+static bool syscall_memgroup(size_t frame_limit, size_t swap_limit);
+#endif
+
+static void ud_syscall(struct intr_frame *f)
+{
+	if ((f->cs & 3) == 3 && is_user_vaddr((void *)f->rip) && *(uint16_t *)f->rip == 0x0b0f) {
+		f->rip += 2;
+		syscall_handler(f);
+		return;
+	}
+	printf("%s: dying due to #UD\n", thread_name());
+	intr_dump_frame(f);
+	thread_current()->my_entry->exit_status = -1;
+	thread_exit();
+}
 
 void syscall_init(void)
+{
+	register_ud_hack(ud_syscall);
+	syscall_init_ap();
+	lock_init(&file_lock);
+}
+
+/* Sets up the syscall instruction on this CPU.  The MSRs are per
+ * CPU, so each application processor calls this too (threads/smp.c). */
+void syscall_init_ap(void)
 {
 	write_msr(MSR_STAR, ((uint64_t)SEL_UCSEG - 0x10) << 48 | ((uint64_t)SEL_KCSEG) << 32);
 	write_msr(MSR_LSTAR, (uint64_t)syscall_entry);
@@ -65,7 +92,10 @@ void syscall_init(void)
 	 * until the syscall_entry swaps the userland stack to the kernel
 	 * mode stack. Therefore, we masked the FLAG_FL. */
 	write_msr(MSR_SYSCALL_MASK, FLAG_IF | FLAG_TF | FLAG_DF | FLAG_IOPL | FLAG_AC | FLAG_NT);
-	lock_init(&file_lock);
+
+	/* syscall_entry finds this CPU's struct cpu, and through it
+	 * the kernel stack, at %gs after a swapgs. */
+	write_msr(MSR_KERNEL_GS_BASE, (uint64_t)this_cpu());
 }
 
 /* The main system call interface */
@@ -131,6 +161,13 @@ void syscall_handler(struct intr_frame *f)
 		case SYS_MUNMAP:
 			syscall_munmap(arg1);
 			break;
+		case SYS_MEMGROUP:
+#ifdef VM
+			f->R.rax = syscall_memgroup(arg1, arg2);
+#else
+			f->R.rax = -1;
+#endif
+			break;
 	}
 }
 
@@ -369,4 +406,22 @@ static void syscall_munmap(void *addr)
 		return;
 
 	return do_munmap(addr);
-}
\ No newline at end of file
+}
+
+#ifdef VM
+/* Moves the calling process into a new memory group nested in its
+ * current one.  Pages already resident stay charged to the old
+ * group; the process's future frames and its future children are
+ * limited to FRAME_LIMIT frames and SWAP_LIMIT swap slots. */
+static bool syscall_memgroup(size_t frame_limit, size_t swap_limit)
+{
+	struct thread *curr = thread_current();
+	struct memgroup *mg = memgroup_create(curr->memgroup, frame_limit, swap_limit);
+	if (mg == NULL)
+		return false;
+
+	memgroup_put(curr->memgroup);
+	curr->memgroup = mg;
+	return true;
+}
+#endif /* VM */
@@ -4,6 +4,7 @@
 #include "userprog/gdt.h"
 #include "threads/thread.h"
 #include "threads/palloc.h"
+#include "threads/smp.h"
 #include "threads/vaddr.h"
 #include "intrinsic.h"
 
@@ -43,32 +44,33 @@
  *      not in use, so we can always use that.  Thus, when the
  *      scheduler switches threads, it also changes the TSS's
  *      stack pointer to point to the new thread's kernel stack.
- *      (The call is in schedule in thread.c.) */
-
-/* Kernel TSS. */
-struct task_state *tss;
+ *      (The call is in schedule in thread.c.)
+ *
+ *  Each CPU switches threads on its own, so each has a TSS of its
+ *  own, found through its struct cpu. */
 
-/* Initializes the kernel TSS. */
+/* Initializes this CPU's TSS. */
 void tss_init(void)
 {
 	/* Our TSS is never used in a call gate or task gate, so only a
 	 * few fields of it are ever referenced, and those are the only
 	 * ones we initialize. */
-	tss = palloc_get_page(PAL_ASSERT | PAL_ZERO);
+	this_cpu()->tss = palloc_get_page(PAL_ASSERT | PAL_ZERO);
 	tss_update(thread_current());
 }
 
-/* Returns the kernel TSS. */
+/* Returns this CPU's TSS. */
 struct task_state *tss_get(void)
 {
+	struct task_state *tss = this_cpu()->tss;
+
 	ASSERT(tss != NULL);
 	return tss;
 }
 
-/* Sets the ring 0 stack pointer in the TSS to point to the end
- * of the thread stack. */
+/* Sets the ring 0 stack pointer in this CPU's TSS to point to
+ * the end of the thread stack. */
 void tss_update(struct thread *next)
 {
-	ASSERT(tss != NULL);
-	tss->rsp0 = (uint64_t)next + PGSIZE;
+	tss_get()->rsp0 = (uint64_t)next + PGSIZE;
 }
@@ -2,8 +2,13 @@
 
 #include "vm/vm.h"
 #include "devices/disk.h"
+#include "threads/palloc.h"
+#include "threads/slab.h"
 #include "threads/vaddr.h"
+#include "vm/zswap.h"
 #include <bitmap.h>
+#include <stdio.h>
+#include <string.h>
 
 /* DO NOT MODIFY BELOW LINE */
 static struct disk *swap_disk;
@@ -11,7 +16,54 @@ static bool anon_swap_in(struct page *page, void *kva);
 static bool anon_swap_out(struct page *page);
 static void anon_destroy(struct page *page);
 
+/* Sectors in a swap slot, which holds one page. */
+#define SLOT_SECTORS (PGSIZE / DISK_SECTOR_SIZE)
+
+/* Most slots anon_swap_out_cluster() writes in one burst. */
+#define SWAP_RUN_MAX 16
+
+/* Most pages one swap-in reads, counting the faulting page. */
+#define READAHEAD_MAX 8
+
+/* Most pages the swap cache holds. */
+#define SWAP_CACHE_MAX 32
+
+/* Swap cache entry: a copy of a page's swap slot, read ahead of a
+ * fault on the page.  The slot stays allocated until the page is
+ * swapped in, so an entry can be dropped at any time.  Its page is
+ * charged as a frame to the group of the process whose fault read
+ * it, until it is used or dropped. */
+struct swap_cache_entry {
+	struct list_elem elem;	   /* Element in swap_cache. */
+	struct anon_page *owner;   /* Page whose slot this copies. */
+	struct memgroup *memgroup; /* Group charged for KVA. */
+	void *kva;				   /* Copy of the slot's contents. */
+};
+
 static struct bitmap *swap_table;
+static size_t swap_free_cnt;   /* Slots neither in use nor reserved. */
+static struct list swap_cache; /* Swap cache entries, oldest first. */
+static size_t swap_cache_cnt;  /* Number of entries in swap_cache. */
+static struct lock swap_lock;  /* Guards everything above. */
+static struct kmem_cache *swap_cache_slab;
+
+/* Statistics. */
+static long long swap_in_cnt;	 /* Pages read back from swap. */
+static long long swap_out_cnt;	 /* Pages written to swap. */
+static long long swap_run_cnt;	 /* Bursts of consecutive slots written. */
+static long long swap_zero_cnt;	 /* Pages swapped out as all zeros. */
+static long long swap_comp_cnt;	 /* Pages swapped out to zswap. */
+static long long ra_hit_cnt;	 /* Swap-ins served by the swap cache. */
+static long long ra_miss_cnt;	 /* Swap-ins that read the disk. */
+static long long ra_read_cnt;	 /* Pages read ahead into the cache. */
+static long long ra_drop_cnt;	 /* Cache entries dropped unused. */
+
+static bool swapped_out(const struct anon_page *anon_page);
+static bool page_is_zero(const void *kva);
+static void read_slot(size_t slot, void *kva);
+static void release_swap(struct anon_page *anon_page);
+static size_t read_ahead(struct page *page, void *kva);
+static void swap_cache_drop(struct swap_cache_entry *);
 
 /* DO NOT MODIFY this struct */
 static const struct page_operations anon_ops = {
@@ -31,6 +83,11 @@ void vm_anon_init(void)
 		printf("vm_anon_init: cannot create swap bitmap");
 
 	bitmap_set_all(swap_table, false);
+	swap_free_cnt = bitmap_size(swap_table);
+	list_init(&swap_cache);
+	lock_init(&swap_lock);
+	swap_cache_slab = kmem_cache_create("swap_cache", sizeof(struct swap_cache_entry), NULL);
+	zswap_init();
 }
 
 /* Initialize the file mapping */
@@ -41,6 +98,10 @@ bool anon_initializer(struct page *page, enum vm_type type, void *kva)
 
 	struct anon_page *anon_page = &page->anon;
 	anon_page->swap_table_index = BITMAP_ERROR;
+	anon_page->swap_memgroup = NULL;
+	anon_page->cached = NULL;
+	anon_page->zswap = NULL;
+	anon_page->zero = false;
 	return true;
 }
 
@@ -48,62 +109,361 @@ bool anon_initializer(struct page *page, enum vm_type type, void *kva)
 static bool anon_swap_in(struct page *page, void *kva)
 {
 	struct anon_page *anon_page = &page->anon;
-	size_t bitmap_index = anon_page->swap_table_index;
 
-	if (bitmap_index == BITMAP_ERROR)
+	if (!swapped_out(anon_page))
+		return false;
+
+	if (anon_page->zero)
+		memset(kva, 0, PGSIZE);
+	else if (anon_page->zswap != NULL)
+		zswap_load(anon_page->zswap, kva);
+	else {
+		// 미리 읽어 둔 내용이 있으면 디스크를 읽지 않는다
+		lock_acquire(&swap_lock);
+		struct swap_cache_entry *e = anon_page->cached;
+		if (e != NULL) {
+			list_remove(&e->elem);
+			swap_cache_cnt--;
+			anon_page->cached = NULL;
+		}
+		lock_release(&swap_lock);
+
+		if (e != NULL) {
+			memcpy(kva, e->kva, PGSIZE);
+			memgroup_uncharge_frame(e->memgroup);
+			palloc_free_page(e->kva);
+			kmem_cache_free(swap_cache_slab, e);
+			ra_hit_cnt++;
+		} else {
+			read_ahead(page, kva);
+			ra_miss_cnt++;
+		}
+	}
+	swap_in_cnt++;
+	release_swap(anon_page);
+	return true;
+}
+
+/* Reads PAGE's contents from its swap slot into KVA, leaving the
+ * slot in place.  Lets fork() copy a page that is swapped out.
+ * Returns false if PAGE is not swapped out. */
+bool anon_copy_swapped(struct page *page, void *kva)
+{
+	size_t bitmap_index = page->anon.swap_table_index;
+
+	if (!swapped_out(&page->anon))
 		return false;
 
-	disk_sector_t start_disk_sec = bitmap_index * 8;
-	for (int i = 0; i < (PGSIZE / DISK_SECTOR_SIZE); i++) {
-		disk_read(swap_disk, (start_disk_sec + i), kva + (DISK_SECTOR_SIZE * i));
+	if (page->anon.zero) {
+		memset(kva, 0, PGSIZE);
+		return true;
+	}
+	if (page->anon.zswap != NULL) {
+		zswap_load(page->anon.zswap, kva);
+		return true;
 	}
 
-	bitmap_set(swap_table, bitmap_index, false);
-	anon_page->swap_table_index = BITMAP_ERROR;
+	lock_acquire(&swap_lock);
+	bool cached = page->anon.cached != NULL;
+	if (cached)
+		memcpy(kva, page->anon.cached->kva, PGSIZE);
+	lock_release(&swap_lock);
+
+	if (!cached)
+		read_slot(bitmap_index, kva);
 	return true;
 }
 
 /* Swap out the page by writing contents to the swap disk. */
 static bool anon_swap_out(struct page *page)
+{
+	if (!anon_swap_reserve(page))
+		return false;
+
+	anon_swap_out_cluster(&page, 1);
+	return true;
+}
+
+/* Sets aside a swap slot for PAGE, which must be resident, and
+ * charges it to the memory group of PAGE's frame, so that writing
+ * PAGE out with anon_swap_out_cluster() cannot fail.  Returns
+ * false if PAGE already has a slot, or if the group is at its swap
+ * limit or the swap disk is full. */
+bool anon_swap_reserve(struct page *page)
 {
 	struct anon_page *anon_page = &page->anon;
+	struct memgroup *mg = page->frame->memgroup;
+	bool success;
 
-	if (anon_page->swap_table_index != BITMAP_ERROR)
+	if (swapped_out(anon_page))
 		return false;
 
-	size_t bitmap_index = bitmap_scan_and_flip(swap_table, 0, 1, false);
-	if (bitmap_index == BITMAP_ERROR)
+	// 그룹의 swap 한도를 넘으면 내보낼 수 없다
+	if (!memgroup_try_charge_swap(mg))
 		return false;
 
-	disk_sector_t start_disk_sec = bitmap_index * 8;
-	for (int i = 0; i < (PGSIZE / DISK_SECTOR_SIZE); i++) {
-		disk_write(swap_disk, (start_disk_sec + i), page->frame->kva + (DISK_SECTOR_SIZE * i));
+	lock_acquire(&swap_lock);
+	success = swap_free_cnt > 0;
+	if (success)
+		swap_free_cnt--;
+	lock_release(&swap_lock);
+
+	if (!success) {
+		memgroup_uncharge_swap(mg);
+		return false;
+	}
+	anon_page->swap_memgroup = mg;
+	return true;
+}
+
+/* Swaps out the CNT resident anonymous PAGES, whose slots were set
+ * aside by anon_swap_reserve().  A page of all zeros is only noted
+ * as such, and a page that compresses well goes to zswap while it
+ * has room; either way its slot and swap charge are given back.
+ * The rest go to the swap disk, in runs of consecutive slots as
+ * long as the disk has them free, each run in a single burst.
+ * PAGES may be reordered. */
+void anon_swap_out_cluster(struct page *pages[], size_t cnt)
+{
+	struct disk_iovec iov[SWAP_RUN_MAX];
+	size_t disk_cnt = 0;
+
+	for (size_t i = 0; i < cnt; i++) {
+		struct anon_page *anon_page = &pages[i]->anon;
+		void *kva = pages[i]->frame->kva;
+
+		if (page_is_zero(kva)) {
+			anon_page->zero = true;
+			swap_zero_cnt++;
+		} else if ((anon_page->zswap = zswap_store(kva)) != NULL)
+			swap_comp_cnt++;
+		else {
+			pages[disk_cnt++] = pages[i];
+			continue;
+		}
+
+		// 디스크에 쓰지 않으니 잡아 둔 슬롯과 그룹의 swap 과금을 돌려준다
+		lock_acquire(&swap_lock);
+		swap_free_cnt++;
+		lock_release(&swap_lock);
+		memgroup_uncharge_swap(anon_page->swap_memgroup);
+		anon_page->swap_memgroup = NULL;
+		swap_out_cnt++;
+	}
+
+	for (cnt = disk_cnt; cnt > 0;) {
+		size_t run = cnt < SWAP_RUN_MAX ? cnt : SWAP_RUN_MAX;
+		size_t slot;
+
+		// 연속된 빈 슬롯이 모자라면 더 짧은 run으로 나눈다
+		lock_acquire(&swap_lock);
+		while ((slot = bitmap_scan_and_flip_next(swap_table, run, false)) == BITMAP_ERROR) {
+			ASSERT(run > 1);
+			run /= 2;
+		}
+		lock_release(&swap_lock);
+
+		for (size_t i = 0; i < run; i++)
+			iov[i] = (struct disk_iovec){pages[i]->frame->kva, SLOT_SECTORS};
+		disk_writev(swap_disk, slot * SLOT_SECTORS, iov, run);
+
+		// 쓰기가 끝난 뒤에야 슬롯을 알린다. 그 전에 read_ahead()가
+		// 이 슬롯을 읽으면 옛 내용을 캐시에 넣게 된다.
+		lock_acquire(&swap_lock);
+		for (size_t i = 0; i < run; i++)
+			pages[i]->anon.swap_table_index = slot + i;
+		lock_release(&swap_lock);
+
+		swap_out_cnt += run;
+		swap_run_cnt++;
+		pages += run;
+		cnt -= run;
+	}
+}
+
+/* Reads swap slot SLOT into the page at KVA with one disk command. */
+static void read_slot(size_t slot, void *kva)
+{
+	struct disk_iovec iov = {kva, SLOT_SECTORS};
+
+	disk_readv(swap_disk, slot * SLOT_SECTORS, &iov, 1);
+}
+
+/* Reads PAGE, which is swapped out, into KVA.  Pages that follow
+ * PAGE in its process's address space and in consecutive swap
+ * slots, as anon_swap_out_cluster() leaves pages evicted together,
+ * are read along with it in the same disk command and put in the
+ * swap cache.  A neighbour only counts once its slot is published
+ * under swap_lock, which happens after its contents are on disk.
+ * Like the frames fault-around fills, they are only taken while
+ * PAGE's group is under its frame limit.  Returns the number of
+ * pages read ahead. */
+static size_t read_ahead(struct page *page, void *kva)
+{
+	struct disk_iovec iov[READAHEAD_MAX];
+	struct swap_cache_entry *entries[READAHEAD_MAX];
+	struct supplemental_page_table *spt = &page->owner_thread->spt;
+	struct memgroup *mg = page->owner_thread->memgroup;
+	size_t slot = page->anon.swap_table_index;
+	size_t cnt;
+
+	iov[0] = (struct disk_iovec){kva, SLOT_SECTORS};
+	rwlock_acquire_read(&spt->rwlock);
+	for (cnt = 1; cnt < READAHEAD_MAX; cnt++) {
+		struct page *next = spt_find_page_locked(spt, page->va + cnt * PGSIZE);
+		struct swap_cache_entry *e;
+		bool in_slot;
+
+		// 다음 가상 페이지가 다음 슬롯에 있을 때만 이어서 읽는다
+		if (next == NULL || VM_TYPE(next->operations->type) != VM_ANON)
+			break;
+		lock_acquire(&swap_lock);
+		in_slot = (size_t)next->anon.swap_table_index == slot + cnt && next->anon.cached == NULL;
+		lock_release(&swap_lock);
+		if (!in_slot)
+			break;
+
+		if (memgroup_reclaim_target(mg) != NULL)
+			break;
+		e = kmem_cache_alloc(swap_cache_slab);
+		if (e == NULL)
+			break;
+		e->kva = palloc_get_page(PAL_USER);
+		if (e->kva == NULL) {
+			kmem_cache_free(swap_cache_slab, e);
+			break;
+		}
+		e->owner = &next->anon;
+		e->memgroup = mg;
+		memgroup_charge_frame(mg);
+		entries[cnt] = e;
+		iov[cnt] = (struct disk_iovec){e->kva, SLOT_SECTORS};
+	}
+	rwlock_release_read(&spt->rwlock);
+	disk_readv(swap_disk, slot * SLOT_SECTORS, iov, cnt);
+
+	lock_acquire(&swap_lock);
+	for (size_t i = 1; i < cnt; i++) {
+		entries[i]->owner->cached = entries[i];
+		list_push_back(&swap_cache, &entries[i]->elem);
+		swap_cache_cnt++;
 	}
+	while (swap_cache_cnt > SWAP_CACHE_MAX)
+		swap_cache_drop(list_entry(list_front(&swap_cache), struct swap_cache_entry, elem));
+	lock_release(&swap_lock);
+
+	ra_read_cnt += cnt - 1;
+	return cnt - 1;
+}
 
-	anon_page->swap_table_index = bitmap_index;
+/* Frees swap cache entry E, which has not been used. */
+static void swap_cache_drop(struct swap_cache_entry *e)
+{
+	ASSERT(lock_held_by_current_thread(&swap_lock));
+
+	list_remove(&e->elem);
+	swap_cache_cnt--;
+	e->owner->cached = NULL;
+	memgroup_uncharge_frame(e->memgroup);
+	palloc_free_page(e->kva);
+	kmem_cache_free(swap_cache_slab, e);
+	ra_drop_cnt++;
+}
+
+/* Frees the oldest swap cache entry, to make room in the user
+ * pool.  If TARGET is not NULL, only entries charged within that
+ * memory group are considered.  Returns false if there are none. */
+bool anon_swap_cache_shrink(struct memgroup *target)
+{
+	bool shrunk = false;
+
+	lock_acquire(&swap_lock);
+	for (struct list_elem *el = list_begin(&swap_cache); el != list_end(&swap_cache);
+		 el = list_next(el)) {
+		struct swap_cache_entry *e = list_entry(el, struct swap_cache_entry, elem);
+		if (target == NULL || memgroup_contains(target, e->memgroup)) {
+			swap_cache_drop(e);
+			shrunk = true;
+			break;
+		}
+	}
+	lock_release(&swap_lock);
+	return shrunk;
+}
+
+/* Returns true if ANON_PAGE is swapped out: on the swap disk, in
+ * zswap, or noted as all zeros. */
+static bool swapped_out(const struct anon_page *anon_page)
+{
+	return (anon_page->swap_table_index != BITMAP_ERROR || anon_page->zswap != NULL ||
+			anon_page->zero);
+}
+
+/* Returns true if the page at KVA holds only zeros. */
+static bool page_is_zero(const void *kva)
+{
+	const uint64_t *p = kva;
+
+	for (size_t i = 0; i < PGSIZE / sizeof *p; i++)
+		if (p[i] != 0)
+			return false;
 	return true;
 }
 
+/* Gives back whatever holds swapped-out ANON_PAGE's contents: its
+ * swap slot, any swap cache entry and its group's swap charge, or
+ * its zswap entry.  Zero and zswap pages carry no swap charge, as
+ * anon_swap_out_cluster() gives it back with their slots. */
+static void release_swap(struct anon_page *anon_page)
+{
+	if (anon_page->zswap != NULL) {
+		zswap_free(anon_page->zswap);
+		anon_page->zswap = NULL;
+	} else if (anon_page->swap_table_index != BITMAP_ERROR) {
+		lock_acquire(&swap_lock);
+		if (anon_page->cached != NULL)
+			swap_cache_drop(anon_page->cached);
+		bitmap_set(swap_table, anon_page->swap_table_index, false);
+		swap_free_cnt++;
+		anon_page->swap_table_index = BITMAP_ERROR;
+		lock_release(&swap_lock);
+
+		memgroup_uncharge_swap(anon_page->swap_memgroup);
+		anon_page->swap_memgroup = NULL;
+	}
+	anon_page->zero = false;
+}
+
+/* Prints swap statistics. */
+void vm_anon_print_stats(void)
+{
+	printf("Swap: %lld pages in, %lld pages out in %lld runs\n", swap_in_cnt, swap_out_cnt,
+		   swap_run_cnt);
+	printf("Swap: %lld zero pages and %lld compressed pages kept off the disk, "
+		   "saving %lld sector writes\n",
+		   swap_zero_cnt, swap_comp_cnt, (swap_zero_cnt + swap_comp_cnt) * SLOT_SECTORS);
+	zswap_print_stats();
+	printf("Swap readahead: %lld hits, %lld misses, %lld pages read ahead, %lld dropped\n",
+		   ra_hit_cnt, ra_miss_cnt, ra_read_cnt, ra_drop_cnt);
+}
+
 /* Destroy the anonymous page. PAGE will be freed by the caller. */
 static void anon_destroy(struct page *page)
 {
 	struct anon_page *anon_page = &page->anon;
 
-	// swap disk 있으면 해제
-	if (anon_page->swap_table_index != BITMAP_ERROR) {
-		bitmap_set(swap_table, anon_page->swap_table_index, false);
-		anon_page->swap_table_index = BITMAP_ERROR;
-	}
+	// 내보내는 중이면 끝날 때까지 기다린 뒤, 다시 내보내지 않게 고정한다
+	bool resident = vm_pin_frame(page);
 
-	if (page->frame != NULL) {
+	// swap 된 내용이 있으면 해제
+	if (swapped_out(anon_page))
+		release_swap(anon_page);
+
+	if (resident) {
 		// pte에서 매핑 제거
 		pml4_clear_page(thread_current()->pml4, page->va);
 
-		// 물리메모리도 제거
-		palloc_free_page(page->frame->kva);
-
-		// frame 구조체 해제
-		free(page->frame);
-		page->frame = NULL;
+		// 프레임을 놓는다 (공유 중이 아니면 물리메모리와 frame 구조체 해제)
+		vm_release_frame(page);
 	}
 }
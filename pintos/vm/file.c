@@ -3,11 +3,13 @@
 #include "vm/vm.h"
 #include "threads/vaddr.h"
 #include "userprog/syscall.h"
+#include "vm/readahead.h"
 
 static bool file_backed_swap_in(struct page *page, void *kva);
 static bool file_backed_swap_out(struct page *page);
 static void file_backed_destroy(struct page *page);
 static bool lazy_load_file(struct page *page, void *aux);
+static int file_page_read(struct page *page, void *kva);
 
 /* DO NOT MODIFY this struct */
 static const struct page_operations file_ops = {
@@ -17,9 +19,14 @@ static const struct page_operations file_ops = {
 	.type = VM_FILE,
 };
 
+/* Cache of struct mmap_aux. */
+struct kmem_cache *mmap_aux_slab;
+
 /* The initializer of file vm */
 void vm_file_init(void)
 {
+	mmap_aux_slab = kmem_cache_create("mmap_aux", sizeof(struct mmap_aux), NULL);
+	readahead_init();
 }
 
 /* Initialize the file backed page */
@@ -56,13 +63,8 @@ static bool file_backed_swap_in(struct page *page, void *kva)
 	if (file_page->file == NULL)
 		return false;
 
-	struct file *file = file_page->file;
-	off_t ofs = file_page->offset;
 	size_t page_read_bytes = file_page->page_read_bytes;
-
-	lock_acquire(&file_lock);
-	int result = file_read_at(file, page->frame->kva, page_read_bytes, ofs);
-	lock_release(&file_lock);
+	int result = file_page_read(page, kva);
 
 	if (result != file_page->page_read_bytes) {
 		// 파일 쓰기에 실패했다면 OS가 할 수 있는 일은 없다.
@@ -81,7 +83,8 @@ static bool file_backed_swap_out(struct page *page)
 		return false;
 
 	struct file_page *file_page = &page->file;
-	bool is_dirty = pml4_is_dirty(thread_current()->pml4, page->va);
+	uint64_t *pml4 = page->owner_thread->pml4;
+	bool is_dirty = pml4_is_dirty(pml4, page->va);
 	if (is_dirty) {
 		struct file *file = file_page->file;
 		off_t ofs = file_page->offset;
@@ -98,7 +101,7 @@ static bool file_backed_swap_out(struct page *page)
 		}
 	}
 
-	pml4_set_dirty(thread_current()->pml4, page->va, false);
+	pml4_set_dirty(pml4, page->va, false);
 	return true;
 }
 
@@ -106,7 +109,7 @@ static bool file_backed_swap_out(struct page *page)
 static void file_backed_destroy(struct page *page)
 {
 	struct file_page *file_page = &page->file;
-	if (page->frame == NULL)
+	if (!vm_pin_frame(page))
 		return;
 
 	file_backed_swap_out(page);
@@ -114,10 +117,8 @@ static void file_backed_destroy(struct page *page)
 	// pte에서 매핑 제거
 	pml4_clear_page(thread_current()->pml4, page->va);
 
-	// 물리메모리도 해제
-	palloc_free_page(page->frame->kva);
-	free(page->frame);
-	page->frame = NULL;
+	// 프레임 테이블에서 빼고 물리메모리도 해제
+	vm_release_frame(page);
 }
 
 /*
@@ -141,7 +142,7 @@ void *do_mmap(void *addr, size_t length, int writable, struct file *file, off_t
 	while (read_bytes > 0) {
 		size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
 
-		struct mmap_aux *mmap_aux = malloc(sizeof(*mmap_aux));
+		struct mmap_aux *mmap_aux = kmem_cache_alloc(mmap_aux_slab);
 		if (!mmap_aux)
 			return NULL;
 
@@ -155,7 +156,7 @@ void *do_mmap(void *addr, size_t length, int writable, struct file *file, off_t
 
 		if (!vm_alloc_page_with_initializer(VM_FILE, addr_copy, writable, lazy_load_file,
 											mmap_aux)) {
-			free(mmap_aux);
+			kmem_cache_free(mmap_aux_slab, mmap_aux);
 			mmap_aux = NULL;
 			goto error;
 		}
@@ -177,18 +178,11 @@ error:
 
 static bool lazy_load_file(struct page *page, void *aux)
 {
-	struct mmap_aux *mmap_aux = (struct mmap_aux *)aux;
-	struct file *file = mmap_aux->file;
-	off_t ofs = mmap_aux->offset;
-	size_t page_read_bytes = mmap_aux->page_read_bytes;
-
-	lock_acquire(&file_lock);
-	int read_result = file_read_at(file, page->frame->kva, page_read_bytes, ofs);
-	lock_release(&file_lock);
+	int read_result = file_page_read(page, page->frame->kva);
 
 	page->file.page_read_bytes = read_result;
 	memset(page->frame->kva + read_result, 0, PGSIZE - read_result);
-	free(aux);
+	kmem_cache_free(mmap_aux_slab, aux);
 
 	return true;
 }
@@ -216,5 +210,87 @@ void do_munmap(void *addr)
 		spt_remove_page(&thread_current()->spt, page);
 	}
 
+	readahead_cancel(mmap_file);
 	file_close(mmap_file); // TODO: exit 시 file_close
 }
+
+/* Reads file PAGE's contents into KVA, or takes them from the
+ * readahead cache if they were read ahead.  Returns the number of
+ * bytes read from the file. */
+static int file_page_read(struct page *page, void *kva)
+{
+	struct file_page *file_page = &page->file;
+	int result = readahead_take(file_page->file, file_page->offset, kva);
+
+	if (result < 0) {
+		lock_acquire(&file_lock);
+		result = file_read_at(file_page->file, kva, file_page->page_read_bytes,
+							  file_page->offset);
+		lock_release(&file_lock);
+	}
+	return result;
+}
+
+/* Tells readahead that file PAGE was just faulted in, and queues
+ * the pages of PAGE's mapping that it asks to read ahead, leaving
+ * out those that are already in memory.  A fault counts as
+ * sequential if it lands no further past the previous one than
+ * fault-around would have loaded. */
+void file_backed_readahead(struct page *page)
+{
+	struct supplemental_page_table *spt = &thread_current()->spt;
+	struct file_page *file_page = &page->file;
+	off_t gap = (vm_fault_around > 1 ? vm_fault_around : 1) * PGSIZE;
+	off_t ofs[READAHEAD_MAX], start;
+	size_t len[READAHEAD_MAX], n = 0;
+	size_t cnt = readahead_fault(file_page->file, file_page->offset, gap, &start);
+
+	rwlock_acquire_read(&spt->rwlock);
+	for (size_t i = 0; i < cnt; i++) {
+		off_t delta = start + i * PGSIZE - file_page->offset;
+		if (file_page->mmap_index + delta / PGSIZE >= file_page->mmap_length)
+			break;
+
+		struct page *next = spt_find_page_locked(spt, page->va + delta);
+		if (next == NULL || next->frame != NULL)
+			continue;
+
+		// 아직 로드되지 않은 페이지는 aux에, 내보낸 페이지는 file_page에 위치가 있다
+		if (VM_TYPE(next->operations->type) == VM_UNINIT &&
+			VM_TYPE(next->uninit.type) == VM_FILE) {
+			struct mmap_aux *aux = next->uninit.aux;
+			ofs[n] = aux->offset;
+			len[n] = aux->page_read_bytes;
+		} else if (VM_TYPE(next->operations->type) == VM_FILE) {
+			ofs[n] = next->file.offset;
+			len[n] = next->file.page_read_bytes;
+		} else
+			continue;
+		n++;
+	}
+	rwlock_release_read(&spt->rwlock);
+	readahead_submit(file_page->file, ofs, len, n);
+}
+
+/* Stops readahead through the mapping PAGE belongs to, if PAGE is
+ * the mapping's first page, as do_munmap() does.  Called for every
+ * page of an exiting process, so that each mapping it never
+ * unmapped is cancelled once. */
+void file_backed_cancel_readahead(struct page *page)
+{
+	struct file *file;
+
+	if (VM_TYPE(page->operations->type) == VM_FILE) {
+		if (page->file.mmap_index != 0)
+			return;
+		file = page->file.file;
+	} else if (VM_TYPE(page->operations->type) == VM_UNINIT &&
+			   VM_TYPE(page->uninit.type) == VM_FILE) {
+		struct mmap_aux *aux = page->uninit.aux;
+		if (aux->mmap_index != 0)
+			return;
+		file = aux->file;
+	} else
+		return;
+	readahead_cancel(file);
+}
@@ -0,0 +1,170 @@
+/* memgroup.c: Per-process-tree limits on resident frames and swap. */
+
+#include "vm/memgroup.h"
+#include <debug.h>
+#include "threads/malloc.h"
+#include "threads/synch.h"
+
+/* Group of every process that has not asked for its own. */
+static struct memgroup root_group;
+
+/* Protects the counters and reference counts of all groups. */
+static struct lock memgroup_lock;
+
+/* Initializes the root group, which has no limits. */
+void memgroup_init(void)
+{
+	lock_init(&memgroup_lock);
+	root_group = (struct memgroup){
+		.parent = NULL,
+		.refcnt = 1,
+	};
+}
+
+/* Returns the root group. */
+struct memgroup *memgroup_root(void)
+{
+	return &root_group;
+}
+
+/* Creates a new group below PARENT that may keep at most
+ * FRAME_LIMIT frames resident and use at most SWAP_LIMIT swap
+ * slots; 0 means no limit of its own.  The limits of PARENT still
+ * apply.  Returns the new group with one reference held by the
+ * caller, or NULL if memory is exhausted. */
+struct memgroup *memgroup_create(struct memgroup *parent, size_t frame_limit, size_t swap_limit)
+{
+	ASSERT(parent != NULL);
+
+	struct memgroup *mg = malloc(sizeof *mg);
+	if (mg == NULL)
+		return NULL;
+
+	*mg = (struct memgroup){
+		.parent = memgroup_get(parent),
+		.frame_limit = frame_limit,
+		.swap_limit = swap_limit,
+		.refcnt = 1,
+	};
+	return mg;
+}
+
+/* Takes a reference to MG and returns it. */
+struct memgroup *memgroup_get(struct memgroup *mg)
+{
+	ASSERT(mg != NULL);
+
+	lock_acquire(&memgroup_lock);
+	mg->refcnt++;
+	lock_release(&memgroup_lock);
+	return mg;
+}
+
+/* Drops a reference to MG, freeing it once nothing refers to it.
+ * MG may be NULL, for threads that never ran a user process. */
+void memgroup_put(struct memgroup *mg)
+{
+	while (mg != NULL) {
+		struct memgroup *parent = mg->parent;
+
+		lock_acquire(&memgroup_lock);
+		bool last = --mg->refcnt == 0;
+		lock_release(&memgroup_lock);
+		if (!last)
+			break;
+
+		ASSERT(mg != &root_group);
+		ASSERT(mg->frame_cnt == 0 && mg->swap_cnt == 0);
+		free(mg);
+		mg = parent;
+	}
+}
+
+/* Returns true if MG is GROUP or one of its descendants. */
+bool memgroup_contains(const struct memgroup *group, const struct memgroup *mg)
+{
+	for (; mg != NULL; mg = mg->parent)
+		if (mg == group)
+			return true;
+	return false;
+}
+
+/* Returns the innermost group enclosing MG (possibly MG itself)
+ * that is at its frame limit, or NULL if MG may be charged another
+ * frame.  A new frame for MG must then be reclaimed from inside
+ * the returned group. */
+struct memgroup *memgroup_reclaim_target(struct memgroup *mg)
+{
+	struct memgroup *target = NULL;
+
+	lock_acquire(&memgroup_lock);
+	for (; mg != NULL; mg = mg->parent)
+		if (mg->frame_limit != 0 && mg->frame_cnt >= mg->frame_limit) {
+			target = mg;
+			break;
+		}
+	lock_release(&memgroup_lock);
+	return target;
+}
+
+/* Charges one resident frame to MG and all its ancestors. */
+void memgroup_charge_frame(struct memgroup *mg)
+{
+	ASSERT(mg != NULL);
+
+	lock_acquire(&memgroup_lock);
+	mg->refcnt++;
+	for (struct memgroup *g = mg; g != NULL; g = g->parent)
+		g->frame_cnt++;
+	lock_release(&memgroup_lock);
+}
+
+/* Undoes memgroup_charge_frame(MG). */
+void memgroup_uncharge_frame(struct memgroup *mg)
+{
+	ASSERT(mg != NULL);
+
+	lock_acquire(&memgroup_lock);
+	for (struct memgroup *g = mg; g != NULL; g = g->parent) {
+		ASSERT(g->frame_cnt > 0);
+		g->frame_cnt--;
+	}
+	lock_release(&memgroup_lock);
+	memgroup_put(mg);
+}
+
+/* Charges one swap slot to MG and all its ancestors, unless that
+ * would put any of them over its swap limit.  Returns true if
+ * successful, false otherwise. */
+bool memgroup_try_charge_swap(struct memgroup *mg)
+{
+	struct memgroup *g;
+
+	ASSERT(mg != NULL);
+
+	lock_acquire(&memgroup_lock);
+	for (g = mg; g != NULL; g = g->parent)
+		if (g->swap_limit != 0 && g->swap_cnt >= g->swap_limit) {
+			lock_release(&memgroup_lock);
+			return false;
+		}
+	mg->refcnt++;
+	for (g = mg; g != NULL; g = g->parent)
+		g->swap_cnt++;
+	lock_release(&memgroup_lock);
+	return true;
+}
+
+/* Undoes a successful memgroup_try_charge_swap(MG). */
+void memgroup_uncharge_swap(struct memgroup *mg)
+{
+	ASSERT(mg != NULL);
+
+	lock_acquire(&memgroup_lock);
+	for (struct memgroup *g = mg; g != NULL; g = g->parent) {
+		ASSERT(g->swap_cnt > 0);
+		g->swap_cnt--;
+	}
+	lock_release(&memgroup_lock);
+	memgroup_put(mg);
+}
@@ -0,0 +1,371 @@
+/* readahead.c: Asynchronous readahead for sequentially faulting mmaps. */
+
+#include "vm/readahead.h"
+#include <debug.h>
+#include <list.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "filesys/inode.h"
+#include "threads/palloc.h"
+#include "threads/slab.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/syscall.h"
+#include "vm/memgroup.h"
+
+/* Most pages read ahead and not yet faulted in.  Older ones are
+ * dropped first. */
+#define READAHEAD_CACHE_MAX 64
+
+/* Mappings whose access pattern is tracked at once.  The least
+ * recently faulted one makes room for a new one. */
+#define STREAM_CNT 8
+
+/* Access pattern of one file. */
+struct stream {
+	struct inode *inode; /* File's inode, or NULL if the slot is free. */
+	off_t last;		   /* Offset of the last fault. */
+	off_t ra_end;	   /* End of what has been read ahead. */
+	size_t window;	   /* Next window in pages, or 0 if not sequential. */
+	uint64_t stamp;	   /* When the last fault came, for replacement. */
+};
+
+/* Pages for the readahead thread to read. */
+struct request {
+	struct list_elem elem;		/* Element in queue. */
+	struct file *file;			/* File to read. */
+	struct memgroup *memgroup;	/* Group of the process that faulted. */
+	size_t cnt;					/* Pages to read. */
+	off_t ofs[READAHEAD_MAX];	/* Offset of each page. */
+	size_t len[READAHEAD_MAX];	/* Bytes in each page. */
+};
+
+/* A page read ahead. */
+struct cache_entry {
+	struct list_elem elem; /* Element in cache. */
+	struct inode *inode;   /* Inode read from. */
+	off_t ofs;			   /* Offset read from. */
+	uint64_t gen;		   /* INODE's write generation when read. */
+	int len;			   /* Bytes read; the rest is zeros. */
+	struct memgroup *memgroup; /* Group charged for KVA. */
+	void *kva;			   /* Page holding the contents. */
+};
+
+/* RA_LOCK guards everything below. */
+static struct lock ra_lock;
+static struct condition queue_cond; /* Signaled when QUEUE grows. */
+static struct condition idle_cond;	/* Signaled when BUSY_FILE clears. */
+static struct list queue;			/* Pending requests, oldest first. */
+static struct file *busy_file;		/* File the thread is reading. */
+static struct list cache;			/* Pages read ahead, oldest first. */
+static size_t cache_cnt;			/* Number of entries in CACHE. */
+static struct stream streams[STREAM_CNT];
+static uint64_t stream_clock;
+
+static struct kmem_cache *request_slab;
+static struct kmem_cache *entry_slab;
+
+/* Statistics. */
+static long long window_cnt;  /* Windows submitted. */
+static long long read_cnt;	  /* Pages read ahead. */
+static long long hit_cnt;	  /* Loads served from the cache. */
+static long long miss_cnt;	  /* Loads that had to read the file. */
+static long long drop_cnt;	  /* Pages read ahead but never used. */
+static long long stale_cnt;	  /* Pages found written since read ahead. */
+
+static void readahead_thread(void *aux);
+static struct stream *stream_get(struct inode *inode);
+static struct cache_entry *cache_find(struct inode *inode, off_t ofs);
+static void cache_drop(struct cache_entry *e);
+
+/* Initializes readahead and starts its thread.  Must be called
+ * after thread_start(). */
+void readahead_init(void)
+{
+	lock_init(&ra_lock);
+	cond_init(&queue_cond);
+	cond_init(&idle_cond);
+	list_init(&queue);
+	list_init(&cache);
+	request_slab = kmem_cache_create("readahead_req", sizeof(struct request), NULL);
+	entry_slab = kmem_cache_create("readahead_cache", sizeof(struct cache_entry), NULL);
+
+	thread_create("readahead", PRI_DEFAULT, readahead_thread, NULL);
+}
+
+/* Records a fault at offset OFS of a mapping of FILE.  The fault
+ * continues a sequential pattern if it comes after the previous
+ * one, by no more than GAP bytes.  Returns the number of pages to
+ * read ahead, starting at *START, or 0 if it is not time to. */
+size_t readahead_fault(struct file *file, off_t ofs, off_t gap, off_t *start)
+{
+	struct inode *inode = file_get_inode(file);
+	size_t cnt = 0;
+
+	lock_acquire(&ra_lock);
+	struct stream *s = stream_get(inode);
+	bool sequential = s->inode == inode && ofs > s->last && ofs - s->last <= gap;
+
+	if (s->inode != inode)
+		*s = (struct stream){.inode = inode};
+	s->last = ofs;
+	s->stamp = ++stream_clock;
+
+	if (!sequential)
+		s->window = 0;
+	else {
+		if (s->window == 0)
+			s->window = READAHEAD_MIN;
+		if (s->ra_end <= ofs)
+			s->ra_end = ofs + PGSIZE;
+
+		// 읽어 둔 범위의 절반에 들어서면 다음 창을 미리 읽는다
+		if (s->ra_end - ofs <= (off_t)(s->window / 2 * PGSIZE)) {
+			*start = s->ra_end;
+			cnt = s->window;
+			s->ra_end += cnt * PGSIZE;
+			if (s->window < READAHEAD_MAX)
+				s->window *= 2;
+		}
+	}
+	lock_release(&ra_lock);
+	return cnt;
+}
+
+/* Queues the CNT pages of FILE at offsets OFS, each LEN bytes
+ * long, to be read ahead. */
+void readahead_submit(struct file *file, const off_t ofs[], const size_t len[], size_t cnt)
+{
+	ASSERT(cnt <= READAHEAD_MAX);
+
+	if (cnt == 0)
+		return;
+
+	struct request *r = kmem_cache_alloc(request_slab);
+	if (r == NULL)
+		return;
+	r->file = file;
+	r->memgroup = memgroup_get(thread_current()->memgroup);
+	r->cnt = cnt;
+	memcpy(r->ofs, ofs, cnt * sizeof *ofs);
+	memcpy(r->len, len, cnt * sizeof *len);
+
+	lock_acquire(&ra_lock);
+	list_push_back(&queue, &r->elem);
+	cond_signal(&queue_cond, &ra_lock);
+	window_cnt++;
+	lock_release(&ra_lock);
+}
+
+/* If the page of FILE at offset OFS was read ahead and the file
+ * has not been written since, copies it to KVA, drops it from the
+ * cache and returns the number of bytes that were read from the
+ * file.  Otherwise returns -1. */
+int readahead_take(struct file *file, off_t ofs, void *kva)
+{
+	struct inode *inode = file_get_inode(file);
+	struct cache_entry *e;
+	int len = -1;
+
+	lock_acquire(&ra_lock);
+	e = cache_find(inode, ofs);
+	if (e != NULL && e->gen != inode_write_gen(inode)) {
+		// 미리 읽은 뒤에 파일이 바뀌었으면 버리고 다시 읽는다
+		cache_drop(e);
+		stale_cnt++;
+		e = NULL;
+	}
+	if (e != NULL) {
+		list_remove(&e->elem);
+		cache_cnt--;
+		hit_cnt++;
+	} else
+		miss_cnt++;
+	lock_release(&ra_lock);
+
+	if (e != NULL) {
+		memcpy(kva, e->kva, PGSIZE);
+		len = e->len;
+		memgroup_uncharge_frame(e->memgroup);
+		palloc_free_page(e->kva);
+		kmem_cache_free(entry_slab, e);
+	}
+	return len;
+}
+
+/* Stops all readahead through FILE, whose mapping is going away,
+ * and drops what was read ahead of its inode.  FILE may be closed
+ * once this returns. */
+void readahead_cancel(struct file *file)
+{
+	struct inode *inode = file_get_inode(file);
+	struct list_elem *e, *next;
+
+	lock_acquire(&ra_lock);
+	for (e = list_begin(&queue); e != list_end(&queue); e = next) {
+		struct request *r = list_entry(e, struct request, elem);
+		next = list_next(e);
+		if (r->file == file) {
+			list_remove(e);
+			memgroup_put(r->memgroup);
+			kmem_cache_free(request_slab, r);
+		}
+	}
+	while (busy_file == file)
+		cond_wait(&idle_cond, &ra_lock);
+
+	for (e = list_begin(&cache); e != list_end(&cache); e = next) {
+		struct cache_entry *c = list_entry(e, struct cache_entry, elem);
+		next = list_next(e);
+		if (c->inode == inode)
+			cache_drop(c);
+	}
+	for (size_t i = 0; i < STREAM_CNT; i++)
+		if (streams[i].inode == inode)
+			streams[i] = (struct stream){.inode = NULL};
+	lock_release(&ra_lock);
+}
+
+/* Frees the oldest page read ahead, to make room for a frame.  If
+ * TARGET is not NULL, only pages charged within that memory group
+ * are considered.  Returns true if a page was freed. */
+bool readahead_shrink(struct memgroup *target)
+{
+	bool shrunk = false;
+
+	lock_acquire(&ra_lock);
+	for (struct list_elem *el = list_begin(&cache); el != list_end(&cache);
+		 el = list_next(el)) {
+		struct cache_entry *e = list_entry(el, struct cache_entry, elem);
+		if (target == NULL || memgroup_contains(target, e->memgroup)) {
+			cache_drop(e);
+			shrunk = true;
+			break;
+		}
+	}
+	lock_release(&ra_lock);
+	return shrunk;
+}
+
+/* Prints readahead statistics. */
+void readahead_print_stats(void)
+{
+	printf("Mmap readahead: %lld windows, %lld pages read ahead, %lld hits, %lld misses, "
+		   "%lld dropped (%lld stale)\n",
+		   window_cnt, read_cnt, hit_cnt, miss_cnt, drop_cnt, stale_cnt);
+}
+
+/* Reads the pages of queued requests into the cache.  Runs as its
+ * own thread, so that a faulting process need not wait for them.
+ * Each page is charged as a frame to the group of the process whose
+ * fault asked for it, and like the pages anonymous swap-ins read
+ * ahead, only taken while that group is under its frame limit. */
+static void readahead_thread(void *aux UNUSED)
+{
+	for (;;) {
+		struct request *r;
+
+		lock_acquire(&ra_lock);
+		while (list_empty(&queue))
+			cond_wait(&queue_cond, &ra_lock);
+		r = list_entry(list_pop_front(&queue), struct request, elem);
+		busy_file = r->file;
+		lock_release(&ra_lock);
+
+		struct inode *inode = file_get_inode(r->file);
+
+		for (size_t i = 0; i < r->cnt; i++) {
+			// 프레임을 뺏어 가면서까지 미리 읽지는 않는다
+			if (memgroup_reclaim_target(r->memgroup) != NULL)
+				break;
+			void *kva = palloc_get_page(PAL_USER);
+			struct cache_entry *e = kmem_cache_alloc(entry_slab);
+			if (kva == NULL || e == NULL) {
+				if (kva != NULL)
+					palloc_free_page(kva);
+				if (e != NULL)
+					kmem_cache_free(entry_slab, e);
+				break;
+			}
+
+			// 쓰기는 file_lock을 잡고 하므로 세대 번호가 읽은 내용과 맞는다
+			lock_acquire(&file_lock);
+			int len = file_read_at(r->file, kva, r->len[i], r->ofs[i]);
+			memset(kva + len, 0, PGSIZE - len);
+			*e = (struct cache_entry){
+				.inode = inode,
+				.ofs = r->ofs[i],
+				.gen = inode_write_gen(inode),
+				.len = len,
+				.memgroup = r->memgroup,
+				.kva = kva,
+			};
+			lock_release(&file_lock);
+			memgroup_charge_frame(r->memgroup);
+
+			lock_acquire(&ra_lock);
+			struct cache_entry *old = cache_find(inode, r->ofs[i]);
+			if (old != NULL)
+				cache_drop(old);
+			list_push_back(&cache, &e->elem);
+			cache_cnt++;
+			read_cnt++;
+			while (cache_cnt > READAHEAD_CACHE_MAX)
+				cache_drop(list_entry(list_front(&cache), struct cache_entry, elem));
+			lock_release(&ra_lock);
+		}
+
+		lock_acquire(&ra_lock);
+		busy_file = NULL;
+		cond_broadcast(&idle_cond, &ra_lock);
+		lock_release(&ra_lock);
+		memgroup_put(r->memgroup);
+		kmem_cache_free(request_slab, r);
+	}
+}
+
+/* Returns INODE's stream, or the slot to start tracking it in. */
+static struct stream *stream_get(struct inode *inode)
+{
+	struct stream *victim = &streams[0];
+
+	ASSERT(lock_held_by_current_thread(&ra_lock));
+
+	for (size_t i = 0; i < STREAM_CNT; i++) {
+		if (streams[i].inode == inode)
+			return &streams[i];
+		if (streams[i].stamp < victim->stamp)
+			victim = &streams[i];
+	}
+	return victim;
+}
+
+/* Returns the cache entry for INODE at offset OFS, or NULL. */
+static struct cache_entry *cache_find(struct inode *inode, off_t ofs)
+{
+	struct list_elem *e;
+
+	ASSERT(lock_held_by_current_thread(&ra_lock));
+
+	for (e = list_begin(&cache); e != list_end(&cache); e = list_next(e)) {
+		struct cache_entry *c = list_entry(e, struct cache_entry, elem);
+		if (c->inode == inode && c->ofs == ofs)
+			return c;
+	}
+	return NULL;
+}
+
+/* Frees cache entry E, which was never used. */
+static void cache_drop(struct cache_entry *e)
+{
+	ASSERT(lock_held_by_current_thread(&ra_lock));
+
+	list_remove(&e->elem);
+	cache_cnt--;
+	drop_cnt++;
+	memgroup_uncharge_frame(e->memgroup);
+	palloc_free_page(e->kva);
+	kmem_cache_free(entry_slab, e);
+}
@@ -3,3 +3,6 @@ vm_SRC += vm/uninit.c     # Uninitialized page
 vm_SRC += vm/anon.c       # Anonymous page
 vm_SRC += vm/file.c       # File mapped page
 vm_SRC += vm/inspect.c    # Testing utility
+vm_SRC += vm/memgroup.c   # Memory groups
+vm_SRC += vm/zswap.c      # Compressed swap pool
+vm_SRC += vm/readahead.c  # Mmap readahead
@@ -60,6 +60,10 @@ static void uninit_destroy(struct page *page)
 {
 	struct uninit_page *uninit UNUSED = &page->uninit;
 
-	free(uninit->aux);
+	/* Only segment and mmap pages are given an aux. */
+	if (uninit->type & VM_LOAD_MARKER)
+		kmem_cache_free(vm_load_aux_slab, uninit->aux);
+	else if (VM_TYPE(uninit->type) == VM_FILE)
+		kmem_cache_free(mmap_aux_slab, uninit->aux);
 	uninit->aux = NULL;
 }
@@ -1,17 +1,78 @@
 /* vm.c: Generic interface for virtual memory objects. */
 
 #include "vm/vm.h"
+#include "threads/init.h"
 #include "threads/malloc.h"
 #include "threads/mmu.h"
+#include "threads/slab.h"
 #include "threads/vaddr.h"
 #include "vm/inspect.h"
+#include "vm/readahead.h"
+#include "intrinsic.h"
+#include <stdio.h>
 #include <string.h>
 
 /* Initializes the virtual memory subsystem by invoking each subsystem's
  * intialize codes. */
 
+/* Frame table.  FRAME_LIST is treated as a ring that the clock
+ * hand sweeps; CLOCK_HAND is the next frame to consider for
+ * eviction, or NULL if the table is empty.
+ *
+ * Under VM_EVICT_2Q, frames first go on A1IN_LIST, a FIFO that is
+ * kept to about a quarter of the frame table, and only move to the
+ * clock ring (2Q's "Am") when their page faults back in soon after
+ * being evicted from A1IN_LIST.  A page that is touched once, as in
+ * a sequential scan, thus passes through A1IN_LIST without pushing
+ * the working set out of the ring.  2Q's A1out ghost list is kept
+ * implicitly: each page evicted from A1IN_LIST records the value of
+ * A1OUT_SEQ, and the page is a ghost for as long as fewer than
+ * A1OUT_SIZE() evictions have followed it. */
 static struct list frame_list;
+static struct list_elem *clock_hand;
+static struct list a1in_list;
+static size_t frame_cnt;
+static uint64_t a1out_seq;
 static struct lock frame_table_lock;
+static struct condition evict_cond; /* Signaled when an eviction ends. */
+
+#define A1IN_SIZE() (frame_cnt / 4)
+#define A1OUT_SIZE() (frame_cnt / 2)
+
+/* Most frames one call to vm_evict_frame() evicts. */
+#define EVICT_BATCH 16
+
+/* Most neighbours fault_around() looks up per hold of the SPT lock. */
+#define FAULT_AROUND_BATCH 16
+
+/* Replacement policy, set with -evict=clock|2q. */
+enum vm_evict_policy vm_evict_policy = VM_EVICT_CLOCK;
+
+/* Number of sweeps of the clock hand a frame must go unreferenced
+ * before it is evicted.  1 is plain second chance; larger values
+ * keep idle pages resident for longer.  Set with -clock-age=N. */
+unsigned vm_clock_age = 1;
+
+/* Size, in pages, of the aligned window around a faulting page of
+ * a lazily loaded executable or mmap that is loaded along with it.
+ * 1, the default, turns fault-around off, so that every page is
+ * loaded only when it is first touched.  Set with -fault-around=N. */
+unsigned vm_fault_around = 1;
+
+/* Statistics. */
+static long long evict_cnt;		 /* Frames evicted. */
+static long long clock_step_cnt; /* Frames the clock hand passed over. */
+static long long a1in_evict_cnt; /* Frames evicted from A1in. */
+static long long ghost_hit_cnt;	 /* Faults on pages in A1out. */
+static long long cow_share_cnt;	 /* Frames shared by fork(). */
+static long long cow_copy_cnt;	 /* Shared frames copied on write. */
+static long long fault_cnt;		 /* Faults that loaded a page. */
+static long long around_cnt;	 /* Pages loaded around a fault. */
+
+/* Object caches for the VM system's bookkeeping. */
+static struct kmem_cache *page_slab;
+static struct kmem_cache *frame_slab;
+struct kmem_cache *vm_load_aux_slab;
 
 void vm_init(void)
 {
@@ -23,7 +84,14 @@ void vm_init(void)
 	register_inspect_intr();
 	/* DO NOT MODIFY UPPER LINES. */
 	list_init(&frame_list);
+	clock_hand = NULL;
+	list_init(&a1in_list);
 	lock_init(&frame_table_lock);
+	cond_init(&evict_cond);
+	memgroup_init();
+	page_slab = kmem_cache_create("page", sizeof(struct page), NULL);
+	frame_slab = kmem_cache_create("frame", sizeof(struct frame), NULL);
+	vm_load_aux_slab = kmem_cache_create("vm_load_aux", sizeof(struct vm_load_aux), NULL);
 }
 
 /* Get the type of the page. This function is useful if you want to know the
@@ -41,9 +109,12 @@ enum vm_type page_get_type(struct page *page)
 }
 
 /* Helpers */
-static struct frame *vm_get_victim(void);
+static struct frame *vm_get_victim(struct memgroup *target);
 static bool vm_do_claim_page(struct page *page);
-static struct frame *vm_evict_frame(void);
+static bool vm_map_frame(struct page *page, struct frame *frame);
+static struct file *page_backing_file(struct page *page);
+static void fault_around(struct page *page, struct file *file);
+static struct frame *vm_evict_frame(struct memgroup *target);
 
 /* Create the pending page object with initializer. If you want to create a
  * page, do not create it directly and make it through this function or
@@ -62,7 +133,7 @@ bool vm_alloc_page_with_initializer(enum vm_type type, void *upage, bool writabl
 		return false;
 
 	// 2. struct page
-	struct page *page = malloc(sizeof(struct page));
+	struct page *page = kmem_cache_alloc(page_slab);
 	if (page == NULL)
 		return false;
 
@@ -83,6 +154,7 @@ bool vm_alloc_page_with_initializer(enum vm_type type, void *upage, bool writabl
 	uninit_new(page, upage, init, type, aux, initializer);
 	page->writable = writable;
 	page->owner_thread = thread_current();
+	page->ghost_seq = 0;
 
 	if (!spt_insert_page(spt, page))
 		goto err;
@@ -90,21 +162,38 @@ bool vm_alloc_page_with_initializer(enum vm_type type, void *upage, bool writabl
 	return true;
 
 err:
-	free(page);
+	kmem_cache_free(page_slab, page);
 	return false;
 }
 
 // spt에서 va로 페이지를 찾아 반환하는 함수
 struct page *spt_find_page(struct supplemental_page_table *spt, void *va)
 {
-	if (va == NULL || hash_empty(&spt->spt_hash))
+	if (va == NULL)
+		return NULL;
+
+	// 조회끼리는 동시에 진행할 수 있다
+	rwlock_acquire_read(&spt->rwlock);
+	struct page *page = spt_find_page_locked(spt, va);
+	rwlock_release_read(&spt->rwlock);
+	return page;
+}
+
+/* Like spt_find_page(), for a caller that already holds SPT's
+ * rwlock.  Lets a loop over a faulting page's neighbours take the
+ * lock once instead of once per lookup. */
+struct page *spt_find_page_locked(struct supplemental_page_table *spt, void *va)
+{
+	ASSERT(rwlock_held_by_current_thread(&spt->rwlock));
+
+	if (va == NULL)
 		return NULL;
 
 	// 1. 페이지 경계로 va를 내린다
 	struct page dummy_page;
 	dummy_page.va = pg_round_down(va);
 
-	// 2. 해시 테이블에서 검색한다.
+	// 2. 해시 테이블에서 검색한다
 	struct hash_elem *find_elem = hash_find(&spt->spt_hash, &dummy_page.spt_hash_elem);
 
 	// 3. 찾았으면 page구조체를 반환한다.
@@ -119,65 +208,412 @@ bool spt_insert_page(struct supplemental_page_table *spt, struct page *page)
 {
 	if (spt == NULL || page == NULL)
 		return false;
-	return hash_insert(&spt->spt_hash, &page->spt_hash_elem) == NULL;
+
+	rwlock_acquire_write(&spt->rwlock);
+	bool success = hash_insert(&spt->spt_hash, &page->spt_hash_elem) == NULL;
+	rwlock_release_write(&spt->rwlock);
+	return success;
 }
 
 void spt_remove_page(struct supplemental_page_table *spt, struct page *page)
 {
 	if (spt == NULL || page == NULL)
 		return false;
+	rwlock_acquire_write(&spt->rwlock);
 	hash_delete(&spt->spt_hash, &page->spt_hash_elem);
+	rwlock_release_write(&spt->rwlock);
 	vm_dealloc_page(page);
 }
 
-/* Get the struct frame, that will be evicted. */
-static struct frame *vm_get_victim(void)
+/* Returns the frame after E in the frame table, wrapping around
+ * to the first frame at the end. */
+static struct list_elem *clock_next(struct list_elem *e)
+{
+	e = list_next(e);
+	return e != list_end(&frame_list) ? e : list_begin(&frame_list);
+}
+
+/* Adds FRAME, which holds FRAME->PAGE, to the frame table.  Under
+ * clock, or under 2Q if the page is a ghost in A1out, it goes on
+ * the ring just behind the clock hand, so that it is the last
+ * frame the hand reaches.  Otherwise it goes to the back of A1in. */
+static void frame_table_insert(struct frame *frame)
+{
+	struct page *page = frame->page;
+
+	ASSERT(lock_held_by_current_thread(&frame_table_lock));
+
+	frame->age = 0;
+	frame_cnt++;
+	frame->in_a1in = false;
+	if (vm_evict_policy == VM_EVICT_2Q) {
+		if (page->ghost_seq == 0 || a1out_seq - page->ghost_seq >= A1OUT_SIZE()) {
+			frame->in_a1in = true;
+			list_push_back(&a1in_list, &frame->frame_elem);
+			return;
+		}
+		ghost_hit_cnt++;
+		page->ghost_seq = 0;
+	}
+
+	if (clock_hand == NULL) {
+		list_push_back(&frame_list, &frame->frame_elem);
+		clock_hand = &frame->frame_elem;
+	} else
+		list_insert(clock_hand, &frame->frame_elem);
+}
+
+/* Removes FRAME from the frame table, moving the clock hand off
+ * it first. */
+static void frame_table_remove(struct frame *frame)
+{
+	ASSERT(lock_held_by_current_thread(&frame_table_lock));
+
+	frame_cnt--;
+	if (frame->in_a1in) {
+		list_remove(&frame->frame_elem);
+		return;
+	}
+	if (clock_hand == &frame->frame_elem)
+		clock_hand = clock_next(clock_hand);
+	list_remove(&frame->frame_elem);
+	if (list_empty(&frame_list))
+		clock_hand = NULL;
+}
+
+/* Returns true if more than one page maps FRAME copy-on-write.
+ * Shared frames are never evicted: that would take unmapping and
+ * swapping in every sharer at once. */
+static bool frame_is_shared(struct frame *frame)
+{
+	return !list_empty(&frame->sharers);
+}
+
+/* Takes PAGE off the pages sharing FRAME.  If PAGE was the one
+ * FRAME->PAGE names, the next sharer takes its place. */
+static void frame_unshare(struct frame *frame, struct page *page)
+{
+	ASSERT(lock_held_by_current_thread(&frame_table_lock));
+	ASSERT(frame_is_shared(frame));
+
+	if (frame->page == page)
+		frame->page = list_entry(list_pop_front(&frame->sharers), struct page, share_elem);
+	else
+		list_remove(&page->share_elem);
+}
+
+/* Returns true if FRAME was referenced since the clock hand last
+ * passed it, and clears its accessed bits.  The kernel reaches
+ * user frames through their kernel virtual addresses too (e.g.
+ * when copying a page for fork()), so the alias counts as well. */
+static bool frame_test_and_clear_accessed(struct frame *frame)
+{
+	struct page *page = frame->page;
+	uint64_t *pml4 = page->owner_thread->pml4;
+	bool user = pml4_is_accessed(pml4, page->va);
+	bool kernel = pml4_is_accessed(base_pml4, frame->kva);
+
+	if (user)
+		pml4_set_accessed(pml4, page->va, false);
+	if (kernel) {
+		/* Every address space shares the kernel's page tables,
+		 * so the stale TLB entry is ours whatever pml4 is live. */
+		pml4_set_accessed(base_pml4, frame->kva, false);
+		invlpg((uint64_t)frame->kva);
+	}
+	return user || kernel;
+}
+
+/* Returns true if FRAME's page can be written out, setting aside
+ * a swap slot for it if it is anonymous.  An uninitialized page
+ * cannot.  Frames whose contents are still being read in are kept
+ * out by vm_map_frame() pinning them. */
+static bool frame_reserve_evict(struct frame *frame)
 {
-	struct frame *victim = list_entry(list_pop_front(&frame_list), struct frame, frame_elem);
-	return victim;
+	switch (VM_TYPE(frame->page->operations->type)) {
+		case VM_ANON:
+			return anon_swap_reserve(frame->page);
+		case VM_FILE:
+			return true;
+		default:
+			return false;
+	}
+}
+
+/* Sweeps the clock hand over the ring, giving every referenced
+ * frame another chance and aging the rest.  The first frame in
+ * TARGET (or any group, if TARGET is NULL) that has gone
+ * VM_CLOCK_AGE sweeps unreferenced and can be swapped out is taken
+ * off the table and returned.  Returns NULL if there is none. */
+static struct frame *clock_victim(struct memgroup *target)
+{
+	size_t steps = list_size(&frame_list) * (vm_clock_age + 1);
+
+	ASSERT(lock_held_by_current_thread(&frame_table_lock));
+
+	for (; clock_hand != NULL && steps > 0; steps--) {
+		struct frame *frame = list_entry(clock_hand, struct frame, frame_elem);
+		clock_hand = clock_next(clock_hand);
+		clock_step_cnt++;
+
+		// 다른 그룹의 프레임과 공유 중인 프레임은 나이도 먹이지 않고 지나간다
+		if (frame_is_shared(frame) || frame->pinned)
+			continue;
+		if (target != NULL && !memgroup_contains(target, frame->memgroup))
+			continue;
+		if (frame_test_and_clear_accessed(frame)) {
+			frame->age = 0;
+			continue;
+		}
+		if (frame->age < vm_clock_age)
+			frame->age++;
+		// swap 한도에 걸리면 건너뛴다
+		if (frame->age >= vm_clock_age && frame_reserve_evict(frame)) {
+			frame_table_remove(frame);
+			return frame;
+		}
+	}
+	return NULL;
+}
+
+/* Takes the oldest frame in A1in that is in TARGET (or any group,
+ * if TARGET is NULL) and can be swapped out off the table, makes
+ * its page a ghost in A1out, and returns it.  Returns NULL if
+ * there is none.  Accessed bits are ignored here: 2Q counts the
+ * references a page gets while on A1in as one. */
+static struct frame *a1in_victim(struct memgroup *target)
+{
+	struct list_elem *e;
+
+	for (e = list_begin(&a1in_list); e != list_end(&a1in_list); e = list_next(e)) {
+		struct frame *frame = list_entry(e, struct frame, frame_elem);
+
+		if (frame_is_shared(frame) || frame->pinned)
+			continue;
+		if (target != NULL && !memgroup_contains(target, frame->memgroup))
+			continue;
+		if (frame_reserve_evict(frame)) {
+			frame_table_remove(frame);
+			frame->page->ghost_seq = ++a1out_seq;
+			a1in_evict_cnt++;
+			return frame;
+		}
+	}
+	return NULL;
+}
+
+/* Get the struct frame, that will be evicted.
+ * Under 2Q, A1in gives up a frame while it is over its share of
+ * the table, and the clock ring does otherwise; each stands in for
+ * the other when it has nothing to give.
+ * TARGET이 NULL이 아니면 그 메모리 그룹 안의 프레임만 고려한다.
+ * 내보낼 수 있는 프레임이 없으면 NULL을 반환한다. */
+static struct frame *vm_get_victim(struct memgroup *target)
+{
+	struct frame *victim;
+
+	ASSERT(lock_held_by_current_thread(&frame_table_lock));
+
+	if (vm_evict_policy == VM_EVICT_CLOCK)
+		return clock_victim(target);
+
+	if (list_size(&a1in_list) > A1IN_SIZE()) {
+		victim = a1in_victim(target);
+		return victim != NULL ? victim : clock_victim(target);
+	}
+	victim = clock_victim(target);
+	return victim != NULL ? victim : a1in_victim(target);
 }
 
 /* Evict one page and return the corresponding frame.
- * Return NULL on error.*/
-static struct frame *vm_evict_frame(void)
+ * Evicting one frame at a time would cost a disk command per page
+ * and another eviction on the very next fault, so up to EVICT_BATCH
+ * victims are taken at once.  Their anonymous pages go to swap
+ * together in runs of consecutive slots.  The first frame is
+ * returned and the rest go back to the page allocator.
+ * The victims are written out without holding frame_table_lock.
+ * Until they are, they stay marked as evicting, and anyone else
+ * who needs one of their pages waits on evict_cond.
+ * TARGET이 NULL이 아니면 그 메모리 그룹 안의 프레임만 내보낸다.
+ * 내보낼 수 있는 프레임이 없으면 NULL을 반환한다. */
+static struct frame *vm_evict_frame(struct memgroup *target)
 {
+	struct frame *victims[EVICT_BATCH];
+	struct page *anon_pages[EVICT_BATCH];
+	size_t cnt = 0, anon_cnt = 0;
+	size_t i;
+
 	lock_acquire(&frame_table_lock);
-	struct frame *victim = vm_get_victim();
-	struct page *page = victim->page;
+	while (cnt < EVICT_BATCH && (victims[cnt] = vm_get_victim(target)) != NULL)
+		victims[cnt++]->evicting = true;
 
-	swap_out(page);
+	// 내보내는 도중에 페이지가 바뀌지 않도록 매핑부터 끊는다
+	for (i = 0; i < cnt; i++) {
+		struct page *page = victims[i]->page;
+		pml4_clear_page(page->owner_thread->pml4, page->va);
+	}
+	lock_release(&frame_table_lock);
 
-	pml4_clear_page(page->owner_thread->pml4, page->va);
-	page->frame = NULL;
-	victim->page = NULL;
+	for (i = 0; i < cnt; i++) {
+		struct page *page = victims[i]->page;
+		if (VM_TYPE(page->operations->type) == VM_ANON)
+			anon_pages[anon_cnt++] = page;
+		else
+			swap_out(page);
+	}
+	anon_swap_out_cluster(anon_pages, anon_cnt);
+
+	lock_acquire(&frame_table_lock);
+	for (i = 0; i < cnt; i++) {
+		struct frame *victim = victims[i];
+		victim->page->frame = NULL;
+		victim->page = NULL;
+		victim->evicting = false;
+		memgroup_uncharge_frame(victim->memgroup);
+		victim->memgroup = NULL;
+		evict_cnt++;
+	}
+	if (cnt > 0)
+		cond_broadcast(&evict_cond, &frame_table_lock);
 	lock_release(&frame_table_lock);
-	return victim;
+
+	for (i = 1; i < cnt; i++) {
+		palloc_free_page(victims[i]->kva);
+		kmem_cache_free(frame_slab, victims[i]);
+	}
+	return cnt > 0 ? victims[0] : NULL;
 }
 
-/* palloc()으로 프레임을 획득한다. 사용가능한 페이지가 없으면 페이지를 제거한다.
- * 이 함수는 항상 유효한 주소를 반환한다. 즉, 유저풀 메모리가 가득 차있으면
- * 메모리 공간을 확보하기 위해 프레임을 제거한다. */
-static struct frame *vm_get_frame(void)
+/* 비어 있는 유저 페이지로 과금되지 않은 프레임을 만든다.
+ * 남은 페이지가 없으면 NULL을 반환한다. */
+static struct frame *vm_alloc_frame(void)
 {
-
 	void *kva = palloc_get_page(PAL_USER | PAL_ZERO);
 	if (kva == NULL)
-		return vm_evict_frame();
+		return NULL;
 
 	// frame 구조체를 생성한다
-	struct frame *frame = malloc(sizeof(*frame));
+	struct frame *frame = kmem_cache_alloc(frame_slab);
 	if (frame == NULL)
-		PANIC("(vm_get_frame)");
+		PANIC("(vm_alloc_frame)");
 
 	*frame = (struct frame){
 		.page = NULL,
 		.kva = kva,
 	};
+	list_init(&frame->sharers);
+	return frame;
+}
+
+/* palloc()으로 프레임을 획득해 메모리 그룹 MG에 과금한다.
+ * MG(또는 그 상위 그룹)가 프레임 한도에 도달했으면 그 그룹 안에서,
+ * 유저풀 메모리가 가득 차 있으면 전체에서 프레임을 제거해 공간을 확보한다.
+ * 미리 읽어 둔 캐시 페이지도 그룹에 과금되어 있으므로 먼저 비운다.
+ * 내보낼 프레임이 없으면 NULL을 반환한다. */
+static struct frame *vm_get_frame(struct memgroup *mg)
+{
+	struct memgroup *target = memgroup_reclaim_target(mg);
+	struct frame *frame = NULL;
+
+	while (target != NULL && (anon_swap_cache_shrink(target) || readahead_shrink(target)))
+		target = memgroup_reclaim_target(mg);
+	if (target == NULL) {
+		frame = vm_alloc_frame();
+		// 미리 읽어 둔 swap 캐시를 먼저 비워 본다
+		while (frame == NULL && (anon_swap_cache_shrink(NULL) || readahead_shrink(NULL)))
+			frame = vm_alloc_frame();
+	}
+	if (frame == NULL) {
+		frame = vm_evict_frame(target);
+		if (frame == NULL)
+			return NULL;
+		memset(frame->kva, 0, PGSIZE);
+	}
+
+	frame->memgroup = mg;
+	memgroup_charge_frame(mg);
 
 	ASSERT(frame->page == NULL);
 	return frame;
 }
 
+/* 프레임 테이블에 없는 FRAME의 메모리 그룹 과금을 되돌린 뒤 해제한다. */
+static void vm_free_frame(struct frame *frame)
+{
+	memgroup_uncharge_frame(frame->memgroup);
+	palloc_free_page(frame->kva);
+	kmem_cache_free(frame_slab, frame);
+}
+
+/* Waits until PAGE is not being evicted.  Afterwards PAGE either
+ * has a frame in the frame table or none at all. */
+static void wait_for_eviction(struct page *page)
+{
+	ASSERT(lock_held_by_current_thread(&frame_table_lock));
+
+	while (page->frame != NULL && page->frame->evicting)
+		cond_wait(&evict_cond, &frame_table_lock);
+}
+
+/* Keeps PAGE's frame from being evicted until vm_release_frame(),
+ * so that PAGE can be torn down without its contents moving under
+ * it.  Waits for an eviction already under way to finish first.
+ * Returns false if PAGE has no frame by then. */
+bool vm_pin_frame(struct page *page)
+{
+	bool resident;
+
+	lock_acquire(&frame_table_lock);
+	wait_for_eviction(page);
+	resident = page->frame != NULL;
+	if (resident)
+		page->frame->pinned = true;
+	lock_release(&frame_table_lock);
+	return resident;
+}
+
+/* Detaches PAGE from its frame.  The frame leaves the frame table
+ * and is freed, unless other pages still share it.  Does nothing
+ * if PAGE turns out to have been evicted in the meantime. */
+void vm_release_frame(struct page *page)
+{
+	struct frame *frame;
+
+	lock_acquire(&frame_table_lock);
+	wait_for_eviction(page);
+	frame = page->frame;
+	if (frame == NULL) {
+		lock_release(&frame_table_lock);
+		return;
+	}
+	page->frame = NULL;
+	if (frame_is_shared(frame)) {
+		frame_unshare(frame, page);
+		frame = NULL;
+	} else {
+		frame_table_remove(frame);
+		frame->pinned = false;
+	}
+	lock_release(&frame_table_lock);
+
+	if (frame != NULL)
+		vm_free_frame(frame);
+}
+
+/* Prints eviction and swap statistics. */
+void vm_print_stats(void)
+{
+	printf("Eviction: %lld frames evicted, %lld clock hand steps\n", evict_cnt, clock_step_cnt);
+	printf("COW: %lld frames shared, %lld copied on write\n", cow_share_cnt, cow_copy_cnt);
+	printf("Faults: %lld pages loaded on fault, %lld more loaded around them\n", fault_cnt,
+		   around_cnt);
+	readahead_print_stats();
+	if (vm_evict_policy == VM_EVICT_2Q)
+		printf("2Q: %lld frames evicted from A1in, %lld ghost hits\n", a1in_evict_cnt,
+			   ghost_hit_cnt);
+	vm_anon_print_stats();
+}
+
 /* Growing the stack. */
 static bool vm_stack_growth(void *addr)
 {
@@ -191,9 +627,51 @@ static bool vm_stack_growth(void *addr)
 	return true;
 }
 
-/* Handle the fault on write_protected page */
-static bool vm_handle_wp(struct page *page UNUSED)
+/* Handle the fault on write_protected page.
+ * PAGE is writable but mapped read-only, because fork() left its
+ * frame shared copy-on-write.  If the frame is still shared, PAGE
+ * gets a private copy of it; otherwise PAGE is its only user and
+ * just gets write access back. */
+static bool vm_handle_wp(struct page *page)
 {
+	uint64_t *pml4 = thread_current()->pml4;
+	struct frame *copy = NULL;
+
+	for (;;) {
+		lock_acquire(&frame_table_lock);
+		struct frame *frame = page->frame;
+
+		// 그 사이 내보내졌으면 다시 접근할 때 not-present fault로 들어온다
+		if (frame == NULL || !frame_is_shared(frame)) {
+			if (frame != NULL)
+				pml4_set_writable(pml4, page->va, true);
+			lock_release(&frame_table_lock);
+			if (copy != NULL)
+				vm_free_frame(copy);
+			return true;
+		}
+
+		if (copy != NULL) {
+			memcpy(copy->kva, frame->kva, PGSIZE);
+			frame_unshare(frame, page);
+			copy->page = page;
+			page->frame = copy;
+			frame_table_insert(copy);
+			// 공유 프레임을 가리키던 읽기 전용 PTE가 TLB에 남지 않게
+			// 먼저 매핑을 지워 invlpg 한 뒤 새 프레임을 설치한다
+			pml4_clear_page(pml4, page->va);
+			bool success = pml4_set_page(pml4, page->va, copy->kva, true);
+			cow_copy_cnt++;
+			lock_release(&frame_table_lock);
+			return success;
+		}
+		lock_release(&frame_table_lock);
+
+		// 프레임을 얻는 동안 잠금을 놓으므로 공유 상태를 다시 확인한다
+		copy = vm_get_frame(page->owner_thread->memgroup);
+		if (copy == NULL)
+			return false;
+	}
 }
 
 /* Return true on success */
@@ -216,8 +694,23 @@ bool vm_try_handle_fault(struct intr_frame *f, void *addr, bool user, bool write
 			thread_exit(); // 쓰기 불가능한 페이지에 쓰기 시도
 
 		// 페이지가 물리 메모리에 없는 경우 -> 프레임 할당 및 로드
-		if (not_present)
-			return vm_do_claim_page(page);
+		if (not_present) {
+			// 실행 파일/mmap 페이지면 주변 페이지도 함께 읽는다
+			struct file *file = page_backing_file(page);
+
+			if (!vm_do_claim_page(page))
+				return false;
+			fault_cnt++;
+			if (file != NULL && vm_fault_around > 1)
+				fault_around(page, file);
+			if (page_get_type(page) == VM_FILE)
+				file_backed_readahead(page);
+			return true;
+		}
+
+		// 쓰기 가능한 페이지에 대한 보호 fault -> copy-on-write
+		if (write)
+			return vm_handle_wp(page);
 
 		// 다른 종류의 fault (이론상 발생하지 않아야 함)
 		return false;
@@ -243,7 +736,7 @@ bool vm_try_handle_fault(struct intr_frame *f, void *addr, bool user, bool write
 void vm_dealloc_page(struct page *page)
 {
 	destroy(page);
-	free(page);
+	kmem_cache_free(page_slab, page);
 }
 
 /* Claim the page that allocate on VA. */
@@ -264,23 +757,113 @@ bool vm_claim_page(void *va)
 // 물레프레임 할당하여 페이지와 프레임을 연결한다
 static bool vm_do_claim_page(struct page *page)
 {
-	// 1. 물리 프레임을 할당한다 (프레임에 의미있는 데이터는 없는 상태)
-	struct frame *frame = vm_get_frame();
+	// 내보내는 중인 페이지는 다 쓰일 때까지 기다렸다가 swap에서 읽는다
 	lock_acquire(&frame_table_lock);
-	list_push_back(&frame_list, &frame->frame_elem);
+	wait_for_eviction(page);
 	lock_release(&frame_table_lock);
 
-	// 2. 페이지와 프레임을 서로 연결한다
+	// 1. 물리 프레임을 할당한다 (프레임에 의미있는 데이터는 없는 상태)
+	struct frame *frame = vm_get_frame(page->owner_thread->memgroup);
+	if (frame == NULL)
+		return false;
+
+	return vm_map_frame(page, frame);
+}
+
+// 페이지를 FRAME에 연결해 매핑하고 내용을 채운다
+static bool vm_map_frame(struct page *page, struct frame *frame)
+{
+	// 2. 페이지와 프레임을 서로 연결한 뒤 프레임 테이블에 넣는다
+	// 내용을 다 채울 때까지는 고정해 두어 내보내지지 않게 한다.
+	// 초기화 함수가 page->operations를 바꾼 뒤에도 읽기가 이어지기 때문이다.
 	frame->page = page;
 	page->frame = frame;
+	frame->pinned = true;
+	lock_acquire(&frame_table_lock);
+	frame_table_insert(frame);
+	lock_release(&frame_table_lock);
 
 	// 3. pte 생성
 	bool success = pml4_set_page(thread_current()->pml4, page->va, frame->kva, page->writable);
-	if (!success)
-		return false;
 
 	// 4. 페이지 초기화 (uninit_initialize)
-	return swap_in(page, frame->kva);
+	if (success)
+		success = swap_in(page, frame->kva);
+
+	lock_acquire(&frame_table_lock);
+	frame->pinned = false;
+	lock_release(&frame_table_lock);
+	return success;
+}
+
+/* Returns the file that PAGE is still waiting to be loaded from,
+ * if PAGE is an unloaded page of an executable segment or of an
+ * mmap, or NULL otherwise.  A segment page with no bytes to read,
+ * such as one of .bss, is anonymous memory and has no file. */
+static struct file *page_backing_file(struct page *page)
+{
+	if (VM_TYPE(page->operations->type) != VM_UNINIT)
+		return NULL;
+	if (page->uninit.type & VM_LOAD_MARKER) {
+		struct vm_load_aux *aux = page->uninit.aux;
+		return aux->page_read_bytes > 0 ? page->owner_thread->current_file : NULL;
+	}
+	if (VM_TYPE(page->uninit.type) == VM_FILE)
+		return ((struct mmap_aux *)page->uninit.aux)->file;
+	return NULL;
+}
+
+/* Loads the pages in the vm_fault_around-page aligned window around
+ * PAGE, which was just loaded from FILE, that are still waiting to
+ * be loaded from FILE, so that a process running through its code
+ * or an mmap takes one fault per window instead of one per page.
+ * Neighbours only get free frames: nothing is evicted for them.
+ * Loading one writes its frame through the kernel alias, so its
+ * accessed bits are cleared afterwards; that way the clock takes it
+ * on its first pass if the process never touches it. */
+static void fault_around(struct page *page, struct file *file)
+{
+	struct thread *curr = thread_current();
+	uint8_t *start = (uint8_t *)page->va - pg_no(page->va) % vm_fault_around * PGSIZE;
+
+	for (unsigned base = 0; base < vm_fault_around; base += FAULT_AROUND_BATCH) {
+		struct page *batch[FAULT_AROUND_BATCH];
+		size_t cnt = 0;
+
+		// 이웃 페이지는 spt 락을 한 번만 잡고 찾는다. 로드하는 동안에는
+		// 락을 놓아 둔다.
+		rwlock_acquire_read(&curr->spt.rwlock);
+		for (unsigned i = base; i < vm_fault_around && i < base + FAULT_AROUND_BATCH; i++) {
+			struct page *np = spt_find_page_locked(&curr->spt, start + i * PGSIZE);
+			if (np != NULL && np != page && page_backing_file(np) == file)
+				batch[cnt++] = np;
+		}
+		rwlock_release_read(&curr->spt.rwlock);
+
+		for (size_t i = 0; i < cnt; i++) {
+			struct page *np = batch[i];
+			struct frame *frame;
+
+			if (memgroup_reclaim_target(curr->memgroup) != NULL ||
+				(frame = vm_alloc_frame()) == NULL)
+				return;
+			frame->memgroup = curr->memgroup;
+			memgroup_charge_frame(curr->memgroup);
+
+			// 읽기에 실패하면 되돌려서, 실제로 접근할 때 fault가 처리하게 한다
+			if (!vm_map_frame(np, frame)) {
+				pml4_clear_page(curr->pml4, np->va);
+				vm_release_frame(np);
+				return;
+			}
+			// 그새 내보내졌을 수 있으므로 락을 잡고 아직 NP의 프레임인지 확인한다
+			lock_acquire(&frame_table_lock);
+			if (np->frame == frame && !frame->evicting)
+				frame_test_and_clear_accessed(frame);
+			lock_release(&frame_table_lock);
+			around_cnt++;
+		}
+	}
 }
 
 // spt helpers
@@ -288,8 +871,10 @@ static uint64_t spt_hash_func(const struct hash_elem *elem, void *aux UNUSED);
 static uint64_t spt_hash_func(const struct hash_elem *elem, void *aux UNUSED);
 static bool spt_hash_less_func(const struct hash_elem *elem_a, const struct hash_elem *elem_b,
 							   void *aux UNUSED);
+static void cancel_readahead(struct hash_elem *elem, void *aux UNUSED);
 static void remove_page_from_spt(struct hash_elem *elem, void *aux UNUSED);
 static void copy_page_from_spt(struct hash_elem *elem, void *aux);
+static bool share_frame(struct page *dst, struct page *src);
 
 // 해시테이블을 초기화하는 함수
 void supplemental_page_table_init(struct supplemental_page_table *spt)
@@ -298,6 +883,7 @@ void supplemental_page_table_init(struct supplemental_page_table *spt)
 		PANIC("(supplemental_page_table_init) spt NULL!");
 	if (!hash_init(&spt->spt_hash, spt_hash_func, spt_hash_less_func, NULL))
 		PANIC("(supplemental_page_table_init) hash init FAIL!");
+	rwlock_init(&spt->rwlock);
 }
 
 /* Copy supplemental page table from src to dst */
@@ -309,10 +895,14 @@ bool supplemental_page_table_copy(struct supplemental_page_table *dst,
 		return false;
 
 	// 1. dst를 비운다
+	rwlock_acquire_write(&dst->rwlock);
 	hash_clear(&dst->spt_hash, remove_page_from_spt);
+	rwlock_release_write(&dst->rwlock);
 
 	// 2. 순회를 하며 copy_page_from_spt 호출
+	rwlock_acquire_read(&src->rwlock);
 	hash_apply(&src->spt_hash, copy_page_from_spt);
+	rwlock_release_read(&src->rwlock);
 
 	return true;
 }
@@ -321,7 +911,11 @@ void supplemental_page_table_kill(struct supplemental_page_table *spt)
 {
 	if (spt == NULL)
 		PANIC("(supplemental_page_table_kill) spt null poiter!");
+	rwlock_acquire_write(&spt->rwlock);
+	// munmap 없이 끝나는 mmap도 미리 읽기를 멈추고 캐시를 비운다
+	hash_apply(&spt->spt_hash, cancel_readahead);
 	hash_destroy(&spt->spt_hash, remove_page_from_spt);
+	rwlock_release_write(&spt->rwlock);
 }
 
 // va로 해시키를 만들어서 반환하는 함수
@@ -341,6 +935,12 @@ static bool spt_hash_less_func(const struct hash_elem *elem_a, const struct hash
 	return page_a->va < page_b->va;
 }
 
+// page가 mmap의 첫 페이지이면 그 매핑의 미리 읽기를 취소한다
+static void cancel_readahead(struct hash_elem *elem, void *aux UNUSED)
+{
+	file_backed_cancel_readahead(hash_entry(elem, struct page, spt_hash_elem));
+}
+
 // spt에서 해당 page를 삭제합니다
 // writeback을 위해 VM_FILE은 swap_out함수를 호출합니다.
 static void remove_page_from_spt(struct hash_elem *elem, void *aux UNUSED)
@@ -362,14 +962,16 @@ static void copy_page_from_spt(struct hash_elem *elem, void *aux)
 		case VM_UNINIT:
 			enum vm_type type = page_get_type(src_page);
 			if (src_page->uninit.type & VM_LOAD_MARKER) {
-				struct vm_load_aux *dst_aux = malloc(sizeof(*dst_aux));
+				struct vm_load_aux *dst_aux = kmem_cache_alloc(vm_load_aux_slab);
 				memcpy(dst_aux, src_page->uninit.aux, sizeof(*dst_aux));
-				vm_alloc_page_with_initializer(type, va, writable, src_page->uninit.init, dst_aux);
+				/* Keep VM_LOAD_MARKER, which tells whose aux this is. */
+				vm_alloc_page_with_initializer(src_page->uninit.type, va, writable,
+											   src_page->uninit.init, dst_aux);
 				return;
 			}
 
 			if (type == VM_FILE) {
-				struct mmap_aux *dst_aux = malloc(sizeof(*dst_aux));
+				struct mmap_aux *dst_aux = kmem_cache_alloc(mmap_aux_slab);
 				memcpy(dst_aux, src_page->uninit.aux, sizeof(*dst_aux));
 				vm_alloc_page_with_initializer(type, va, writable, src_page->uninit.init, dst_aux);
 				return;
@@ -378,9 +980,18 @@ static void copy_page_from_spt(struct hash_elem *elem, void *aux)
 		case VM_FILE:
 			vm_alloc_page_with_initializer(VM_FILE, va, writable, NULL, &src_page->file);
 			break;
-		case VM_ANON:
-			vm_alloc_page_with_initializer(VM_ANON, va, writable, NULL, &src_page->anon);
-			break;
+		case VM_ANON: {
+			if (!vm_alloc_page_with_initializer(VM_ANON, va, writable, NULL, NULL))
+				return;
+			struct page *dst_page = spt_find_page(&thread_current()->spt, va);
+			if (share_frame(dst_page, src_page))
+				return;
+
+			// 부모 페이지가 swap 되어 있으면 swap 슬롯에서 바로 복사한다
+			if (vm_do_claim_page(dst_page))
+				anon_copy_swapped(src_page, dst_page->frame->kva);
+			return;
+		}
 	}
 
 	// 자식 페이지 찾기
@@ -395,4 +1006,29 @@ static void copy_page_from_spt(struct hash_elem *elem, void *aux)
 
 	// 물리 메모리 복사
 	memcpy(dst_page->frame->kva, src_page->frame->kva, PGSIZE);
-}
\ No newline at end of file
+}
+
+/* Makes DST, a fresh anonymous page of the current process, share
+ * the frame of SRC, its parent's resident page, copy-on-write.
+ * Both are mapped read-only until one of them writes.  Returns
+ * false, leaving DST alone, if SRC has no frame. */
+static bool share_frame(struct page *dst, struct page *src)
+{
+	struct frame *frame;
+	bool success = false;
+
+	lock_acquire(&frame_table_lock);
+	wait_for_eviction(src);
+	frame = src->frame;
+	// 익명 페이지 초기화는 KVA를 건드리지 않는다
+	if (frame != NULL && swap_in(dst, frame->kva) &&
+		pml4_set_page(thread_current()->pml4, dst->va, frame->kva, false)) {
+		pml4_set_writable(src->owner_thread->pml4, src->va, false);
+		dst->frame = frame;
+		list_push_back(&frame->sharers, &dst->share_elem);
+		cow_share_cnt++;
+		success = true;
+	}
+	lock_release(&frame_table_lock);
+	return success;
+}
@@ -0,0 +1,101 @@
+/* zswap.c: Compressed pool of swapped-out pages in kernel memory. */
+
+#include "vm/zswap.h"
+#include <debug.h>
+#include <lz.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Largest compressed page worth keeping.  Anything bigger saves
+ * too little memory to pay for the decompression. */
+#define ZSWAP_MAX_LEN (PGSIZE * 3 / 4)
+
+/* A compressed page. */
+struct zswap_entry {
+	uint16_t len;	 /* Bytes of DATA in use. */
+	uint8_t data[]; /* Compressed contents. */
+};
+
+/* Most kB of compressed pages the pool holds.  0, the default,
+ * turns zswap off, so that every evicted page goes to the swap
+ * disk.  Set with -zswap=KB. */
+size_t zswap_max_kb = 0;
+
+static size_t pool_bytes;  /* Compressed bytes held in the pool. */
+static struct lock zswap_lock; /* Guards pool_bytes and the buffers. */
+
+/* Scratch memory for lz_compress(), and its output. */
+static uint8_t work[LZ_WORK_SIZE];
+static uint8_t buffer[ZSWAP_MAX_LEN];
+
+/* Statistics. */
+static long long store_cnt;	 /* Pages stored. */
+static long long reject_cnt; /* Pages that compressed too little. */
+static long long full_cnt;	 /* Pages turned away by a full pool. */
+static long long orig_bytes; /* Bytes of the pages stored. */
+static long long comp_bytes; /* Bytes they were compressed to. */
+
+/* Initializes the pool. */
+void zswap_init(void)
+{
+	lock_init(&zswap_lock);
+}
+
+/* Compresses PAGE into the pool.  Returns the new entry, or a null
+ * pointer if PAGE does not compress to ZSWAP_MAX_LEN bytes or less
+ * or the pool has no room for it, in which case it belongs on the
+ * swap disk instead. */
+struct zswap_entry *zswap_store(const void *page)
+{
+	struct zswap_entry *e = NULL;
+	size_t len;
+
+	if (zswap_max_kb == 0)
+		return NULL;
+
+	lock_acquire(&zswap_lock);
+	len = lz_compress(page, PGSIZE, buffer, sizeof buffer, work);
+	if (len == 0)
+		reject_cnt++;
+	else if (pool_bytes + len > zswap_max_kb * 1024)
+		full_cnt++;
+	else if ((e = malloc(sizeof *e + len)) != NULL) {
+		e->len = len;
+		memcpy(e->data, buffer, len);
+		pool_bytes += len;
+		store_cnt++;
+		orig_bytes += PGSIZE;
+		comp_bytes += len;
+	}
+	lock_release(&zswap_lock);
+	return e;
+}
+
+/* Decompresses E into PAGE.  E stays in the pool. */
+void zswap_load(const struct zswap_entry *e, void *page)
+{
+	if (!lz_decompress(e->data, e->len, page, PGSIZE))
+		PANIC("zswap: corrupt compressed page");
+}
+
+/* Removes E from the pool and frees it. */
+void zswap_free(struct zswap_entry *e)
+{
+	lock_acquire(&zswap_lock);
+	pool_bytes -= e->len;
+	lock_release(&zswap_lock);
+	free(e);
+}
+
+/* Prints pool statistics. */
+void zswap_print_stats(void)
+{
+	printf("Zswap: %lld pages stored in %lld kB (%lld%% of original), "
+		   "%lld incompressible, %lld turned away by a full pool\n",
+		   store_cnt, comp_bytes / 1024, orig_bytes ? comp_bytes * 100 / orig_bytes : 0,
+		   reject_cnt, full_cnt);
+}